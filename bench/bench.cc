@@ -0,0 +1,502 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/cpp/maven-version.h"
+#include "c-maven-utils/cpp/version-set.h"
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/metadata.h"
+#include "c-maven-utils/serialize.h"
+#include "c-maven-utils/version-cache.h"
+
+namespace {
+
+// Allocations made by the library, counted through the allocator hooks
+std::atomic<size_t> allocs(0);
+
+void* countingAlloc(void *, size_t size) {
+    ++allocs;
+    return malloc(size);
+}
+
+void countingFree(void *, void *ptr, size_t) {
+    free(ptr);
+}
+
+enum Shape {
+    kCorpus,            // The checked-in corpus of real versions
+    kDeepNesting,       // Many `-` separated items, each a new sublist
+    kLongQualifier,     // Hundreds of bytes of qualifier
+    kManyComponents,    // Dozens of `.` separated numbers
+};
+
+const char *shapeNames[] = {
+    "corpus", "deep-nesting", "long-qualifier", "many-components",
+};
+
+std::vector<std::string> corpus;
+
+// Adversarial inputs; seeded so every run sees the same strings
+std::vector<std::string> synthetic(Shape shape, size_t n) {
+    std::mt19937 rng(shape);
+    auto number = [&]() { return std::to_string(rng() % 100); };
+    auto word = [&](size_t len) {
+        std::string ret;
+        for (size_t i = 0; i < len; ++i) {
+            ret += "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"[
+                rng() % 52];
+        }
+        return ret;
+    };
+
+    std::vector<std::string> ret;
+    for (size_t i = 0; i < n; ++i) {
+        std::string version = number();
+        switch (shape) {
+        case kDeepNesting:
+            for (size_t depth = 16 + rng() % 48; depth; --depth) {
+                version += "-" + (rng() % 2 ? number() : word(1 + rng() % 6));
+            }
+            break;
+        case kLongQualifier:
+            version += "." + number() + "-" + word(100 + rng() % 300);
+            break;
+        case kManyComponents:
+            for (size_t count = 32 + rng() % 96; count; --count) {
+                version += "." + number();
+            }
+            break;
+        case kCorpus:
+            break;
+        }
+        ret.push_back(version);
+    }
+    return ret;
+}
+
+const std::vector<std::string>& inputs(int shape) {
+    static std::vector<std::string> shapes[] = {
+        corpus,
+        synthetic(kDeepNesting, 1000),
+        synthetic(kLongQualifier, 1000),
+        synthetic(kManyComponents, 1000),
+    };
+    return shapes[shape];
+}
+
+// Times every kInterval-th operation, to report latency percentiles
+class Latency {
+public:
+    static const size_t kInterval = 16;
+
+    template <typename F>
+    void measure(size_t i, F const& op) {
+        if (i % kInterval) {
+            op();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        op();
+        samples_.push_back(std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    void report(benchmark::State& state) {
+        if (samples_.empty()) {
+            return;
+        }
+        std::sort(samples_.begin(), samples_.end());
+        state.counters["p50_ns"] = samples_[samples_.size() / 2];
+        state.counters["p99_ns"] = samples_[samples_.size() * 99 / 100];
+    }
+
+private:
+    std::vector<double> samples_;
+};
+
+// Sets throughput and per-operation allocation counters
+void report(benchmark::State& state, size_t ops, size_t start_allocs) {
+    state.SetItemsProcessed(ops);
+    state.counters["allocs/op"] = ops
+        ? static_cast<double>(allocs - start_allocs) / ops : 0;
+    state.SetLabel(shapeNames[state.range(0)]);
+}
+
+std::vector<struct maven_version*> parseAll(
+        std::vector<std::string> const& strs) {
+    std::vector<struct maven_version*> ret;
+    for (auto const& str : strs) {
+        ret.push_back(mv_parse_n(str.data(), str.size()));
+    }
+    return ret;
+}
+
+void freeAll(std::vector<struct maven_version*> const& versions) {
+    for (auto *version : versions) {
+        mv_free(version);
+    }
+}
+
+void BM_Parse(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    std::vector<struct maven_version*> versions(strs.size());
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        for (size_t i = 0; i < strs.size(); ++i) {
+            latency.measure(i, [&]() {
+                versions[i] = mv_parse_n(strs[i].data(), strs[i].size());
+            });
+        }
+        ops += strs.size();
+
+        state.PauseTiming();
+        freeAll(versions);
+        state.ResumeTiming();
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+}
+
+void BM_Free(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        state.PauseTiming();
+        size_t free_allocs = allocs;
+        auto versions = parseAll(strs);
+        // Include the comparable form, as a version that was compared has it
+        for (size_t i = 1; i < versions.size(); ++i) {
+            mv_compare(versions[i - 1], versions[i]);
+        }
+        allocs = free_allocs;
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < versions.size(); ++i) {
+            latency.measure(i, [&]() { mv_free(versions[i]); });
+        }
+        ops += versions.size();
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+}
+
+void BM_Compare(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    auto versions = parseAll(strs);
+    size_t n = versions.size();
+
+    // Build every comparable form before measuring
+    for (size_t i = 0; i < n; ++i) {
+        mv_compare(versions[i], versions[(i + 1) % n]);
+    }
+
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            latency.measure(i, [&]() {
+                benchmark::DoNotOptimize(
+                    mv_compare(versions[i], versions[(i + 1) % n]));
+            });
+        }
+        ops += n;
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+    freeAll(versions);
+}
+
+void BM_CompareStr(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    size_t n = strs.size();
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            latency.measure(i, [&]() {
+                benchmark::DoNotOptimize(mv_compare_str(strs[i].c_str(),
+                    strs[(i + 1) % n].c_str()));
+            });
+        }
+        ops += n;
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+}
+
+// Reads the inputs from one maven-metadata.xml document
+void BM_Metadata(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    std::string doc = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<metadata>\n  <groupId>org.example</groupId>\n"
+        "  <artifactId>example</artifactId>\n  <versioning>\n"
+        "    <versions>\n";
+    for (auto const& str : strs) {
+        doc += "      <version>" + str + "</version>\n";
+    }
+    doc += "    </versions>\n  </versioning>\n</metadata>\n";
+
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        struct mv_metadata_parser parser;
+        struct mv_metadata_entry entry;
+        mv_metadata_init(&parser, doc.data(), doc.size());
+        for (size_t i = 0; ; ++i) {
+            int more;
+            latency.measure(i, [&]() {
+                more = mv_metadata_next(&parser, &entry);
+            });
+            if (!more) {
+                break;
+            }
+            benchmark::DoNotOptimize(entry.value);
+        }
+        ops += strs.size();
+    }
+    report(state, ops, start_allocs);
+    state.SetBytesProcessed(state.iterations() * doc.size());
+    latency.report(state);
+}
+
+// Serializes the inputs into one 8-byte aligned table of records
+std::vector<uint64_t> serializeAll(std::vector<std::string> const& strs,
+        std::vector<size_t> *sizes = nullptr) {
+    std::vector<uint64_t> table;
+    auto versions = parseAll(strs);
+    for (auto *version : versions) {
+        size_t size = mv_serialize(version, nullptr, 0);
+        size_t offset = table.size();
+        table.resize(offset + size / 8);
+        mv_serialize(version, &table[offset], size);
+        if (sizes) {
+            sizes->push_back(size);
+        }
+    }
+    freeAll(versions);
+    return table;
+}
+
+// Loading serialized versions, to set against BM_Parse
+void BM_Deserialize(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    std::vector<size_t> sizes;
+    auto table = serializeAll(strs, &sizes);
+    std::vector<struct maven_version*> versions(strs.size());
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        auto const *cur = reinterpret_cast<const char*>(table.data());
+        auto const *end = cur + table.size() * 8;
+        for (size_t i = 0; i < versions.size(); ++i) {
+            latency.measure(i, [&]() {
+                versions[i] = mv_deserialize(cur, end - cur);
+                cur += sizes[i];
+            });
+        }
+        ops += versions.size();
+
+        state.PauseTiming();
+        freeAll(versions);
+        state.ResumeTiming();
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+}
+
+// Viewing a table in place and comparing neighbours
+void BM_ViewCompare(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    auto table = serializeAll(strs);
+    std::vector<struct mv_version_view> views(strs.size());
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        auto const *cur = reinterpret_cast<const char*>(table.data());
+        auto const *end = cur + table.size() * 8;
+        for (size_t i = 0; i < views.size(); ++i) {
+            latency.measure(i, [&]() {
+                cur += mv_view_init(&views[i], cur, end - cur);
+                if (i > 0) {
+                    benchmark::DoNotOptimize(
+                        mv_view_compare(&views[i - 1], &views[i]));
+                }
+            });
+        }
+        ops += views.size();
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+}
+
+// Sorts a shuffled copy of the inputs; one op is one element sorted
+void BM_SortCpp(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    std::vector<mvn::Version> versions;
+    for (auto const& str : strs) {
+        versions.emplace_back(str);
+    }
+    std::shuffle(versions.begin(), versions.end(), std::mt19937(42));
+    std::vector<mvn::Version> sorted(versions);
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        state.PauseTiming();
+        sorted = versions;
+        state.ResumeTiming();
+
+        std::sort(sorted.begin(), sorted.end());
+        ops += sorted.size();
+    }
+    report(state, ops, start_allocs);
+}
+
+// Looks up every input in a set of all of them
+template <typename Set>
+void BM_SetLookup(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    std::vector<mvn::Version> versions(strs.begin(), strs.end());
+    Set set(versions.begin(), versions.end());
+    std::shuffle(versions.begin(), versions.end(), std::mt19937(42));
+
+    size_t ops = 0;
+    size_t found = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        for (auto const& v : versions) {
+            found += set.find(v) != set.end();
+        }
+        ops += versions.size();
+    }
+    benchmark::DoNotOptimize(found);
+    report(state, ops, start_allocs);
+}
+
+void BM_CacheParse(benchmark::State& state) {
+    auto const& strs = inputs(state.range(0));
+    // Room for every input even though shards fill unevenly, so all but
+    // the first pass hit
+    auto *cache = mv_cache_create(2 * strs.size());
+    Latency latency;
+    size_t ops = 0;
+    size_t start_allocs = allocs;
+    for (auto _ : state) {
+        for (size_t i = 0; i < strs.size(); ++i) {
+            latency.measure(i, [&]() {
+                mv_free(mv_cache_parse_n(cache, strs[i].data(),
+                    strs[i].size()));
+            });
+        }
+        ops += strs.size();
+    }
+    report(state, ops, start_allocs);
+    latency.report(state);
+
+    struct mv_cache_stats stats;
+    mv_cache_stats(cache, &stats);
+    state.counters["hit_rate"] = stats.hits + stats.misses
+        ? static_cast<double>(stats.hits) / (stats.hits + stats.misses) : 0;
+    mv_cache_free(cache);
+}
+
+// Every thread looks up the whole corpus in one shared cache
+void BM_CacheParseThreads(benchmark::State& state) {
+    static struct maven_version_cache *cache = mv_cache_create(
+        2 * corpus.size());
+    size_t ops = 0;
+    for (auto _ : state) {
+        for (auto const& str : corpus) {
+            mv_free(mv_cache_parse_n(cache, str.data(), str.size()));
+        }
+        ops += corpus.size();
+    }
+    state.SetItemsProcessed(ops);
+}
+
+void shapes(benchmark::internal::Benchmark *b) {
+    for (int shape = kCorpus; shape <= kManyComponents; ++shape) {
+        b->Arg(shape);
+    }
+}
+
+BENCHMARK(BM_Parse)->Apply(shapes);
+BENCHMARK(BM_Free)->Apply(shapes);
+BENCHMARK(BM_Compare)->Apply(shapes);
+BENCHMARK(BM_CompareStr)->Apply(shapes);
+BENCHMARK(BM_Metadata)->Apply(shapes);
+BENCHMARK(BM_Deserialize)->Apply(shapes);
+BENCHMARK(BM_ViewCompare)->Apply(shapes);
+BENCHMARK(BM_SortCpp)->Apply(shapes);
+BENCHMARK_TEMPLATE(BM_SetLookup, mvn::VersionSet)->Apply(shapes);
+BENCHMARK_TEMPLATE(BM_SetLookup, std::set<mvn::Version>)->Apply(shapes);
+BENCHMARK(BM_CacheParse)->Apply(shapes);
+BENCHMARK(BM_CacheParseThreads)->ThreadRange(1, 32)->UseRealTime();
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (argc > 2) {
+        fprintf(stderr, "Usage: bench [benchmark options] [corpus]\n");
+        return 1;
+    }
+
+    const char *path = argc == 2 ? argv[1] : MV_BENCH_CORPUS;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) {
+            corpus.push_back(line);
+        }
+    }
+    if (corpus.empty()) {
+        fprintf(stderr, "No versions in corpus %s\n", path);
+        return 1;
+    }
+
+    struct mv_allocator allocator = { countingAlloc, countingFree, nullptr };
+    mv_set_allocator(&allocator);
+
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
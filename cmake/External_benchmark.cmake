@@ -0,0 +1,16 @@
+set(_source "${CMAKE_SOURCE_DIR}/third_party/benchmark")
+set(_build "${CMAKE_CURRENT_BINARY_DIR}/benchmark")
+
+ExternalProject_Add(benchmark_ext
+    SOURCE_DIR ${_source}
+    BINARY_DIR ${_build}
+    CMAKE_ARGS
+        -DCMAKE_BUILD_TYPE=Release
+        -DBENCHMARK_ENABLE_TESTING=OFF
+        -DBENCHMARK_ENABLE_INSTALL=OFF
+    # Linked from its build tree, like gtest
+    INSTALL_COMMAND ""
+)
+
+include_directories("${_source}/include")
+link_directories("${_build}/src")
@@ -0,0 +1,128 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+
+static void* default_alloc(void *ctx, size_t size) {
+    (void) ctx;
+    return malloc(size);
+}
+
+static void default_free(void *ctx, void *ptr, size_t size) {
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+struct mv_allocator mv_internal_allocator = {
+    default_alloc,
+    default_free,
+    NULL
+};
+
+void mv_set_allocator(const struct mv_allocator *allocator) {
+    if (allocator) {
+        mv_internal_allocator = *allocator;
+    } else {
+        mv_internal_allocator.alloc = default_alloc;
+        mv_internal_allocator.free = default_free;
+        mv_internal_allocator.ctx = NULL;
+    }
+}
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+};
+
+/* Enough for every structure the library places in an arena */
+#define kArenaAlignment sizeof(void*)
+#define kMaxChunkSize (1 << 20)
+
+static size_t align_up(size_t size) {
+    return (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+void mv_internal_arena_init(struct arena *arena,
+        const struct mv_allocator *parent, size_t chunk_size) {
+    arena->parent = parent;
+    arena->chunks = NULL;
+    arena->cur = arena->end = NULL;
+    arena->chunk_size = chunk_size;
+}
+
+void* mv_internal_arena_alloc(struct arena *arena, size_t size) {
+    size = align_up(size);
+
+    if ((size_t) (arena->end - arena->cur) < size) {
+        size_t header = align_up(sizeof(struct arena_chunk));
+        size_t chunk_size = arena->chunk_size;
+        if (chunk_size < size + header) {
+            chunk_size = size + header;
+        }
+
+        struct arena_chunk *chunk = (struct arena_chunk*) mv_internal_alloc(
+            arena->parent, chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        chunk->size = chunk_size;
+        arena->chunks = chunk;
+        arena->cur = (char*) chunk + header;
+        arena->end = (char*) chunk + chunk_size;
+
+        /* Grow geometrically so large batches need few chunks */
+        if (arena->chunk_size < kMaxChunkSize) {
+            arena->chunk_size *= 2;
+        }
+    }
+
+    void *ret = arena->cur;
+    arena->cur += size;
+    return ret;
+}
+
+void mv_internal_arena_release(struct arena *arena) {
+    while (arena->chunks) {
+        struct arena_chunk *next = arena->chunks->next;
+        mv_internal_free(arena->parent, arena->chunks, arena->chunks->size);
+        arena->chunks = next;
+    }
+    arena->cur = arena->end = NULL;
+}
+
+static void* arena_alloc(void *ctx, size_t size) {
+    return mv_internal_arena_alloc((struct arena*) ctx, size);
+}
+
+static void arena_free(void *ctx, void *ptr, size_t size) {
+    /* Released with the arena */
+    (void) ctx;
+    (void) ptr;
+    (void) size;
+}
+
+struct mv_allocator mv_internal_arena_allocator(struct arena *arena) {
+    struct mv_allocator ret = { arena_alloc, arena_free, arena };
+    return ret;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#include "c-maven-utils/maven-version.h"
+
+/* The allocator installed with `mv_set_allocator` */
+extern struct mv_allocator mv_internal_allocator;
+
+static inline void* mv_internal_alloc(const struct mv_allocator *allocator,
+        size_t size) {
+    return allocator->alloc(allocator->ctx, size);
+}
+
+static inline void mv_internal_free(const struct mv_allocator *allocator,
+        void *ptr, size_t size) {
+    allocator->free(allocator->ctx, ptr, size);
+}
+
+struct arena_chunk;
+
+/*
+ * A bump-pointer arena. Individual allocations are never released; the
+ * whole arena is released at once. Chunks come from `parent`.
+ */
+struct arena {
+    const struct mv_allocator *parent;
+    struct arena_chunk *chunks;
+    char *cur;
+    char *end;
+    size_t chunk_size;
+};
+
+void mv_internal_arena_init(struct arena *arena,
+    const struct mv_allocator *parent, size_t chunk_size);
+void* mv_internal_arena_alloc(struct arena *arena, size_t size);
+void mv_internal_arena_release(struct arena *arena);
+
+/* An allocator that allocates from `arena` and ignores frees. */
+struct mv_allocator mv_internal_arena_allocator(struct arena *arena);
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,50 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BYTE_ORDER_H_
+#define BYTE_ORDER_H_
+
+#include <stdint.h>
+
+/* Little-endian fields of serialized records, at any alignment */
+
+static inline void mv_internal_put_u32(unsigned char *buf, uint32_t value) {
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+}
+
+static inline void mv_internal_put_u64(unsigned char *buf, uint64_t value) {
+    mv_internal_put_u32(buf, (uint32_t) value);
+    mv_internal_put_u32(buf + 4, (uint32_t) (value >> 32));
+}
+
+static inline uint32_t mv_internal_get_u32(const unsigned char *buf) {
+    return buf[0] | (uint32_t) buf[1] << 8 | (uint32_t) buf[2] << 16
+        | (uint32_t) buf[3] << 24;
+}
+
+static inline uint64_t mv_internal_get_u64(const unsigned char *buf) {
+    return mv_internal_get_u32(buf)
+        | (uint64_t) mv_internal_get_u32(buf + 4) << 32;
+}
+
+#endif /* BYTE_ORDER_H_ */
@@ -0,0 +1,167 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Version catalogs.
+ *
+ * A catalog file lists the published versions of many artifacts
+ * ("groupId:artifactId"). Each artifact's versions are stored with their
+ * keys, in ascending sort-key order (see `mv_sort_key`), so a reader maps
+ * the file and answers queries by binary search without parsing or
+ * allocating. Queries follow key order, which differs from `mv_compare` only
+ * where Maven is not transitive. The mapping is read-only and shared,
+ * through the page cache, by every process that opens the same file.
+ */
+
+struct maven_catalog;
+struct maven_catalog_builder;
+
+/**
+ * Create a builder, which collects versions in memory until they are
+ * written out.
+ *
+ * Callers must free the returned resource with `mv_catalog_builder_free`.
+ *
+ * @return the builder, or NULL if memory could not be allocated
+ */
+struct maven_catalog_builder* mv_catalog_builder_create(void);
+
+/** Release a builder. */
+void mv_catalog_builder_free(struct maven_catalog_builder *builder);
+
+/**
+ * Add a version of an artifact. Adding the same string twice has no effect;
+ * distinct strings of equal versions ("1.0", "1.0.0") are both kept.
+ *
+ * @return 1, or 0 if memory could not be allocated
+ */
+int mv_catalog_builder_add(struct maven_catalog_builder *builder,
+    const char *artifact, size_t artifact_len, const char *version,
+    size_t len);
+
+/**
+ * Write the catalog to `path`. It is written to a temporary file next to
+ * `path` first and then renamed, so readers never see a partial catalog.
+ *
+ * @return 1, or 0 with errno set if the file could not be written
+ */
+int mv_catalog_builder_write(struct maven_catalog_builder *builder,
+    const char *path);
+
+/**
+ * Map a catalog file. Its header is checked here; everything else is
+ * bounds-checked as it is read, so a corrupt file can give wrong answers
+ * but never causes reads outside of the mapping.
+ *
+ * Callers must free the returned resource with `mv_catalog_close`.
+ *
+ * @return the catalog, or NULL with errno set if the file cannot be mapped
+ *         or is not a catalog
+ */
+struct maven_catalog* mv_catalog_open(const char *path);
+
+/** Unmap a catalog. Artifacts and strings read from it become invalid. */
+void mv_catalog_close(struct maven_catalog *catalog);
+
+/** @return the number of artifacts in the catalog. */
+size_t mv_catalog_size(const struct maven_catalog *catalog);
+
+/** The versions of one artifact, filled in by `mv_catalog_find`. */
+struct mv_catalog_artifact {
+    const char *name; /* NUL-terminated, in the mapping */
+    size_t len;
+    size_t count;     /* Number of versions */
+
+    /* Internal */
+    const struct maven_catalog *catalog;
+    uint64_t first;
+};
+
+/**
+ * Look up an artifact by name, in O(log n) comparisons.
+ *
+ * @return 1, or 0 if the artifact is not in the catalog
+ */
+int mv_catalog_find(const struct maven_catalog *catalog, const char *name,
+    size_t len, struct mv_catalog_artifact *artifact);
+
+/**
+ * Read the `i`th artifact, in byte order of their names, to walk the whole
+ * catalog.
+ *
+ * @return 1, or 0 if there is no such artifact
+ */
+int mv_catalog_artifact_at(const struct maven_catalog *catalog, size_t i,
+    struct mv_catalog_artifact *artifact);
+
+/**
+ * Read the `i`th version of an artifact, in ascending order.
+ *
+ * @return the NUL-terminated version string, in the mapping, or NULL if
+ *         there is no such version
+ */
+const char* mv_catalog_version(const struct mv_catalog_artifact *artifact,
+    size_t i, size_t *len);
+
+/** @return the latest version of an artifact, or NULL if it has none */
+const char* mv_catalog_latest(const struct mv_catalog_artifact *artifact,
+    size_t *len);
+
+/**
+ * Find where `version` falls among the versions of an artifact: the index
+ * of the first version that is not older than it. Like every query, this
+ * allocates nothing unless the sort key of `version` exceeds 256 bytes.
+ *
+ * @return the index, which is `artifact->count` if every version is older,
+ *         or (size_t) -1 with errno set to ENOMEM if the key of `version`
+ *         could not be allocated
+ */
+size_t mv_catalog_lower_bound(const struct mv_catalog_artifact *artifact,
+    const char *version, size_t len);
+
+/**
+ * Like `mv_catalog_lower_bound`, for the first version newer than `version`;
+ * `mv_catalog_version` then reads the next version after it.
+ */
+size_t mv_catalog_upper_bound(const struct mv_catalog_artifact *artifact,
+    const char *version, size_t len);
+
+/**
+ * @return 1 if a version equal to `version` is listed, 0 if not, or -1 with
+ *         errno set to ENOMEM if the key of `version` could not be allocated
+ */
+int mv_catalog_contains(const struct mv_catalog_artifact *artifact,
+    const char *version, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CATALOG_H_ */
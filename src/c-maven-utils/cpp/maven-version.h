@@ -21,41 +21,285 @@
 #ifndef CPP_MAVEN_VERSION_H_
 #define CPP_MAVEN_VERSION_H_
 
-#include <memory>
+#if __cplusplus < 201703L
+#error "The C++ bindings require C++17"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#if defined(__cpp_impl_three_way_comparison)
+#include <compare>
+#endif
 
 #include "c-maven-utils/maven-version.h"
 
 namespace mvn {
 
+namespace detail {
+
+// Serves the allocations made while parsing a short version from the stack
+class ScratchAllocator {
+public:
+    ScratchAllocator() : used_(0), allocator_{ alloc, release, this } { }
+    ScratchAllocator(ScratchAllocator const&) = delete;
+    ScratchAllocator& operator=(ScratchAllocator const&) = delete;
+
+    struct mv_allocator const* get() const { return &allocator_; }
+
+private:
+    static void* alloc(void *ctx, size_t size) {
+        auto *self = static_cast<ScratchAllocator*>(ctx);
+        size_t align = alignof(std::max_align_t);
+        size = (size + align - 1) & ~(align - 1);
+        if (size <= sizeof(self->buf_) - self->used_) {
+            void *ret = self->buf_ + self->used_;
+            self->used_ += size;
+            return ret;
+        }
+        return malloc(size);
+    }
+
+    static void release(void *ctx, void *ptr, size_t) {
+        auto *self = static_cast<ScratchAllocator*>(ctx);
+        std::less<const void*> less;
+        if (less(ptr, self->buf_) || !less(ptr, self->buf_ + sizeof(buf_))) {
+            free(ptr);
+        }
+    }
+
+    alignas(std::max_align_t) char buf_[512];
+    size_t used_;
+    struct mv_allocator allocator_;
+};
+
+} // detail namespace
+
+/**
+ * A Maven version with value semantics.
+ *
+ * A version holds its sort key (see `mv_sort_key`) followed by the string it
+ * was parsed from, inline when they are short and in one heap block
+ * otherwise. Comparisons and hashing only touch the key; the components are
+ * parsed again when they are asked for.
+ *
+ * Versions order by their keys, which is `mv_compare` order but for the few
+ * mixes of separators on which Maven is not transitive; unlike `mv_compare`,
+ * it is a strict weak ordering and so safe to sort with.
+ */
 class Version {
 public:
-    explicit Version(std::string const& version);
-    bool operator<(Version const& o) const;
-    bool operator==(Version const& o) const;
-    std::string const& original() const { return orig_; }
-
-    struct Deleter {
-        void operator()(struct maven_version *v) const {
-            mv_free(v);
+    /**
+     * @throws std::length_error if the version and its key do not fit in
+     *         4 GiB
+     */
+    explicit Version(std::string_view version);
+    Version(Version const& o);
+    Version(Version&& o) noexcept;
+    Version& operator=(Version const& o);
+    Version& operator=(Version&& o) noexcept;
+    ~Version();
+
+    /**
+     * The string this version was parsed from. This was a `std::string
+     * const&` before versions were stored compactly; use `c_str` for a
+     * NUL-terminated string.
+     */
+    std::string_view original() const noexcept {
+        return std::string_view(data() + keySize_, size_);
+    }
+
+    /** Like `original`, NUL-terminated. */
+    const char* c_str() const noexcept { return data() + keySize_; }
+
+    /** The sort key, as bytes. */
+    std::string_view key() const noexcept {
+        return std::string_view(data(), keySize_);
+    }
+
+    /** @return the component, or -1 if it is not set */
+    int major() const { return parsed(mv_major); }
+    int minor() const { return parsed(mv_minor); }
+    int incremental() const { return parsed(mv_incremental); }
+    int build() const { return parsed(mv_build); }
+
+    /** @return the qualifier, or the empty string */
+    std::string qualifier() const {
+        return parsed([](struct maven_version *v) {
+            return std::string(mv_qualifier(v));
+        });
+    }
+
+    /** The canonical form; see `mv_canonical`. */
+    std::string canonical() const {
+        return parsed([](struct maven_version *v) {
+            std::string ret(mv_canonical(v, nullptr, 0), '\0');
+            mv_canonical(v, &ret[0], ret.size() + 1);
+            return ret;
+        });
+    }
+
+    /** Whether this is a release; see `mv_is_release`. */
+    bool isRelease() const { return parsed(mv_is_release) != 0; }
+
+    friend bool operator==(Version const& a, Version const& b) noexcept {
+        return a.key() == b.key();
+    }
+
+#if defined(__cpp_impl_three_way_comparison)
+    friend std::weak_ordering operator<=>(Version const& a,
+            Version const& b) noexcept {
+        int cmp = a.key().compare(b.key());
+        return cmp < 0 ? std::weak_ordering::less
+            : cmp > 0 ? std::weak_ordering::greater
+            : std::weak_ordering::equivalent;
+    }
+#else
+    friend bool operator!=(Version const& a, Version const& b) noexcept {
+        return !(a == b);
+    }
+    friend bool operator<(Version const& a, Version const& b) noexcept {
+        return a.key() < b.key();
+    }
+    friend bool operator>(Version const& a, Version const& b) noexcept {
+        return b < a;
+    }
+    friend bool operator<=(Version const& a, Version const& b) noexcept {
+        return !(b < a);
+    }
+    friend bool operator>=(Version const& a, Version const& b) noexcept {
+        return !(a < b);
+    }
+#endif
+
+private:
+    // Sized so that a version fills one 64-byte cache line
+    static constexpr size_t kInlineSize = 56;
+
+    bool isInline() const noexcept {
+        return size_t(keySize_) + size_ + 1 <= kInlineSize;
+    }
+    const char* data() const noexcept { return isInline() ? inline_ : heap_; }
+    void reset() noexcept;
+
+    template <typename F>
+    auto parsed(F const& f) const -> decltype(f(nullptr)) {
+        detail::ScratchAllocator allocator;
+        struct maven_version *v = mv_parse_with(c_str(), size_,
+            allocator.get());
+        if (!v) {
+            throw std::bad_alloc();
         }
+        auto ret = f(v);
+        mv_free(v);
+        return ret;
+    }
+
+    uint32_t size_;
+    uint32_t keySize_;
+    union {
+        char inline_[kInlineSize];
+        char *heap_;
     };
-private:
-    std::shared_ptr<struct maven_version> version_;
-    std::string orig_;
 };
 
-Version::Version(std::string const& version)
-    : version_(mv_parse(version.c_str()), Deleter()), orig_(version) { }
+inline Version::Version(std::string_view version)
+        : size_(static_cast<uint32_t>(version.size())), keySize_(0) {
+    // The key, the string and a NUL are all indexed by 32 bits
+    if (version.size() >= UINT32_MAX) {
+        throw std::length_error("version too long");
+    }
+    unsigned char key[128];
+    size_t keySize = mv_sort_key_n(version.data(), version.size(), key,
+        sizeof(key));
+    if (!keySize) {
+        throw std::bad_alloc();
+    }
+    if (keySize >= UINT32_MAX - version.size()) {
+        throw std::length_error("version too long");
+    }
+    keySize_ = static_cast<uint32_t>(keySize);
+
+    char *buf = inline_;
+    if (!isInline()) {
+        buf = heap_ = new char[keySize_ + size_ + 1];
+    }
+    if (keySize <= sizeof(key)) {
+        memcpy(buf, key, keySize);
+    } else {
+        mv_sort_key_n(version.data(), version.size(),
+            reinterpret_cast<unsigned char*>(buf), keySize);
+    }
+    memcpy(buf + keySize_, version.data(), size_);
+    buf[keySize_ + size_] = '\0';
+}
+
+inline Version::Version(Version const& o)
+        : size_(o.size_), keySize_(o.keySize_) {
+    if (isInline()) {
+        memcpy(inline_, o.inline_, kInlineSize);
+    } else {
+        heap_ = new char[keySize_ + size_ + 1];
+        memcpy(heap_, o.heap_, keySize_ + size_ + 1);
+    }
+}
 
-bool Version::operator<(Version const& o) const {
-    return mv_compare(version_.get(), o.version_.get()) < 0;
+inline Version::Version(Version&& o) noexcept
+        : size_(o.size_), keySize_(o.keySize_) {
+    memcpy(inline_, o.inline_, kInlineSize);
+    o.reset();
 }
 
-bool Version::operator==(Version const& o) const {
-    return mv_compare(version_.get(), o.version_.get()) == 0;
+inline Version& Version::operator=(Version const& o) {
+    if (this != &o) {
+        *this = Version(o);
+    }
+    return *this;
+}
+
+inline Version& Version::operator=(Version&& o) noexcept {
+    if (this != &o) {
+        if (!isInline()) {
+            delete[] heap_;
+        }
+        size_ = o.size_;
+        keySize_ = o.keySize_;
+        memcpy(inline_, o.inline_, kInlineSize);
+        o.reset();
+    }
+    return *this;
+}
+
+inline Version::~Version() {
+    if (!isInline()) {
+        delete[] heap_;
+    }
+}
+
+// Leaves a moved-from version empty, without a heap block
+inline void Version::reset() noexcept {
+    size_ = keySize_ = 0;
+    inline_[0] = '\0';
 }
 
 } // mvn namespace
 
+namespace std {
+
+template <>
+struct hash<mvn::Version> {
+    size_t operator()(mvn::Version const& v) const noexcept {
+        return hash<string_view>()(v.key());
+    }
+};
+
+} // std namespace
+
 #endif // CPP_MAVEN_VERSION_H_
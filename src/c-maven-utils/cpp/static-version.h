@@ -0,0 +1,475 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CPP_STATIC_VERSION_H_
+#define CPP_STATIC_VERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "c-maven-utils/cpp/maven-version.h"
+
+#if defined(__cpp_consteval)
+#define MVN_CONSTEVAL consteval
+#else
+#define MVN_CONSTEVAL constexpr
+#endif
+
+namespace mvn {
+
+namespace detail {
+
+/*
+ * A constexpr port of the parser and sort key encoder in
+ * comparable-version.c; the two must produce identical keys.
+ */
+
+// Longest literal accepted, and the room for its key
+constexpr size_t kMaxLiteral = 128;
+constexpr size_t kMaxKey = 512;
+
+// Every character contributes at most two items
+constexpr size_t kMaxItems = 2 * kMaxLiteral + 1;
+
+constexpr size_t kMaxInlineDigits = 18;
+
+enum : unsigned char {
+    kKeyQualifier = 0x10,
+    kKeyReleaseBeforeNegative = 0x15,
+    kKeyListNegative = 0x18,
+    kKeyZeroBeforeNegative = 0x19,
+    kKeyEnd = 0x20,
+    kKeyReleaseBeforePositive = 0x25,
+    kKeyServicePack = 0x26,
+    kKeyUnknownQualifier = 0x27,
+    kKeyListPositive = 0x28,
+    kKeyZeroBeforePositive = 0x29,
+    kKeyInteger = 0x2a,
+    kKeyBigInteger = 0x2b,
+};
+
+enum ItemType { kIntegerItem, kBigIntegerItem, kStringItem, kListItem };
+
+enum {
+    kAlphaRank,
+    kBetaRank,
+    kMilestoneRank,
+    kRcRank,
+    kSnapshotRank,
+    kReleaseRank,
+    kServicePackRank,
+    kUnknownRank,
+};
+
+struct Qualifier {
+    std::string_view name;
+    int rank;
+    bool beforeDigit; // Only an alias when a digit follows
+};
+
+constexpr Qualifier kQualifiers[] = {
+    { "alpha", kAlphaRank, false },
+    { "beta", kBetaRank, false },
+    { "milestone", kMilestoneRank, false },
+    { "rc", kRcRank, false },
+    { "cr", kRcRank, false },
+    { "snapshot", kSnapshotRank, false },
+    { "ga", kReleaseRank, false },
+    { "final", kReleaseRank, false },
+    { "sp", kServicePackRank, false },
+    { "a", kAlphaRank, true },
+    { "b", kBetaRank, true },
+    { "m", kMilestoneRank, true },
+};
+
+constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+constexpr bool isSeparator(char c) { return c == '.' || c == '-'; }
+constexpr char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+constexpr int qualifierRank(std::string_view str, bool followedByDigit) {
+    if (str.empty()) {
+        return kReleaseRank;
+    }
+    for (auto const& q : kQualifiers) {
+        if (q.name.size() != str.size()
+                || (q.beforeDigit && !followedByDigit)) {
+            continue;
+        }
+        size_t i = 0;
+        while (i < str.size() && lower(str[i]) == q.name[i]) {
+            ++i;
+        }
+        if (i == str.size()) {
+            return q.rank;
+        }
+    }
+    return kUnknownRank;
+}
+
+// Strings and digits refer back into the version being parsed
+struct Item {
+    int type = kListItem;
+    int64_t integer = 0;
+    int rank = 0;
+    size_t offset = 0;
+    size_t size = 0;
+    size_t count = 0; // Children of a list, which follow it
+};
+
+class Builder {
+public:
+    constexpr explicit Builder(std::string_view version) : version_(version) {
+        if (version.size() > kMaxLiteral) {
+            throw std::length_error("version literal too long");
+        }
+        parse();
+        normalize();
+    }
+
+    constexpr size_t encode(char *key) const {
+        Writer w{ key, 0 };
+        size_t depth = 0;
+        size_t list = 0;
+        bool more = true;
+
+        // Only the last child can be a list, so descend iteratively
+        while (more) {
+            more = false;
+            size_t next = 0; // Index of the next non-null child
+            int nextSign = 1;
+            size_t sublist = 0;
+            for (size_t i = 0; i < items_[list].count; ++i) {
+                size_t child = list + 1 + i;
+                int s = sign(child);
+                if (s == 0) {
+                    if (next <= i) {
+                        for (next = i + 1; next < items_[list].count; ++next) {
+                            nextSign = sign(list + 1 + next);
+                            if (nextSign != 0) {
+                                break;
+                            }
+                        }
+                    }
+                    s = nextSign;
+                }
+                putItem(w, items_[child], s);
+                if (items_[child].type == kListItem) {
+                    sublist = child;
+                    more = true;
+                }
+            }
+            ++depth;
+            list = sublist;
+        }
+
+        while (depth--) {
+            w.put(kKeyEnd);
+        }
+        return w.size;
+    }
+
+private:
+    struct Writer {
+        char *key;
+        size_t size;
+
+        constexpr void put(unsigned c) {
+            if (size == kMaxKey) {
+                throw std::length_error("version literal too long");
+            }
+            key[size++] = static_cast<char>(c & 0xff);
+        }
+    };
+
+    constexpr Item& add(int type) {
+        Item& item = items_[n_++];
+        item.type = type;
+        ++items_[list_].count;
+        return item;
+    }
+
+    constexpr void addList() {
+        add(kListItem);
+        list_ = n_ - 1;
+    }
+
+    constexpr void addNumber(size_t start, size_t end) {
+        while (start < end && version_[start] == '0') {
+            ++start;
+        }
+        if (end - start <= kMaxInlineDigits) {
+            Item& item = add(kIntegerItem);
+            for (size_t i = start; i < end; ++i) {
+                item.integer = item.integer * 10 + (version_[i] - '0');
+            }
+            return;
+        }
+        Item& item = add(kBigIntegerItem);
+        item.offset = start;
+        item.size = end - start;
+    }
+
+    constexpr void addString(size_t start, size_t end, bool followedByDigit) {
+        Item& item = add(kStringItem);
+        item.rank = qualifierRank(version_.substr(start, end - start),
+            followedByDigit);
+        item.offset = start;
+        item.size = end - start;
+    }
+
+    constexpr void parseItem(size_t start, size_t end) {
+        if (isDigit(version_[start])) {
+            addNumber(start, end);
+        } else {
+            addString(start, end, false);
+        }
+    }
+
+    constexpr void parse() {
+        n_ = 1;
+        size_t start = 0;
+        for (size_t i = 0; i < version_.size(); ++i) {
+            char cur = version_[i];
+            bool separator = isSeparator(cur);
+            if (!separator && (i == 0 || isSeparator(version_[i - 1])
+                    || isDigit(cur) == isDigit(version_[i - 1]))) {
+                continue;
+            }
+
+            if (separator) {
+                if (i == start) {
+                    add(kIntegerItem);
+                } else {
+                    parseItem(start, i);
+                }
+                start = i + 1;
+                if (cur == '-') {
+                    addList();
+                }
+            } else if (isDigit(version_[start])) {
+                addNumber(start, i);
+                start = i;
+                addList();
+            } else {
+                addString(start, i, true);
+                start = i;
+                addList();
+            }
+        }
+        if (start < version_.size()) {
+            parseItem(start, version_.size());
+        }
+    }
+
+    constexpr bool isNull(Item const& item) const {
+        switch (item.type) {
+        case kIntegerItem:
+            return item.integer == 0;
+        case kStringItem:
+            return item.rank == kReleaseRank;
+        case kListItem:
+            return item.count == 0;
+        }
+        return false;
+    }
+
+    constexpr void remove(size_t index) {
+        for (size_t i = index; i + 1 < n_; ++i) {
+            items_[i] = items_[i + 1];
+        }
+        --n_;
+    }
+
+    constexpr void normalize() {
+        // Sublists follow their parents, so this visits the innermost first
+        for (size_t list = n_; list > 0; --list) {
+            if (items_[list - 1].type != kListItem) {
+                continue;
+            }
+            for (size_t i = items_[list - 1].count; i > 0; --i) {
+                size_t child = list - 1 + i;
+                if (isNull(items_[child])) {
+                    remove(child);
+                    --items_[list - 1].count;
+                } else if (items_[child].type != kListItem) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // How the item compares with a missing one
+    constexpr int sign(size_t index) const {
+        Item const& item = items_[index];
+        switch (item.type) {
+        case kIntegerItem:
+            return item.integer != 0;
+        case kBigIntegerItem:
+            return 1;
+        case kStringItem:
+            return item.rank < kReleaseRank ? -1 : item.rank > kReleaseRank;
+        case kListItem:
+            for (size_t i = 0; i < item.count; ++i) {
+                if (int s = sign(index + 1 + i)) {
+                    return s;
+                }
+            }
+            return 0;
+        }
+        return 0;
+    }
+
+    constexpr void putItem(Writer& w, Item const& item, int sign) const {
+        switch (item.type) {
+        case kIntegerItem:
+            if (item.integer == 0) {
+                w.put(sign < 0 ? kKeyZeroBeforeNegative
+                    : kKeyZeroBeforePositive);
+                break;
+            }
+            w.put(kKeyInteger);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                w.put(static_cast<unsigned>(
+                    static_cast<uint64_t>(item.integer) >> shift));
+            }
+            break;
+        case kBigIntegerItem:
+            w.put(kKeyBigInteger);
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                w.put(static_cast<unsigned>(item.size >> shift));
+            }
+            for (size_t i = 0; i < item.size; ++i) {
+                w.put(static_cast<unsigned char>(version_[item.offset + i]));
+            }
+            break;
+        case kStringItem:
+            if (item.rank == kReleaseRank) {
+                w.put(sign < 0 ? kKeyReleaseBeforeNegative
+                    : kKeyReleaseBeforePositive);
+            } else if (item.rank == kServicePackRank) {
+                w.put(kKeyServicePack);
+            } else if (item.rank == kUnknownRank) {
+                w.put(kKeyUnknownQualifier);
+                for (size_t i = 0; i < item.size; ++i) {
+                    w.put(static_cast<unsigned char>(
+                        lower(version_[item.offset + i])));
+                }
+                w.put('\0');
+            } else {
+                w.put(kKeyQualifier + item.rank);
+            }
+            break;
+        case kListItem:
+            w.put(sign < 0 ? kKeyListNegative : kKeyListPositive);
+            break;
+        }
+    }
+
+    std::string_view version_;
+    Item items_[kMaxItems] = {};
+    size_t n_ = 0;
+    size_t list_ = 0; // The list being appended to
+};
+
+} // detail namespace
+
+/**
+ * A version whose sort key is computed at compile time, for comparing
+ * runtime versions against fixed ones without parsing them:
+ *
+ *     using namespace mvn::literals;
+ *     if (v < "3.6.0"_mvn) { ... }
+ *
+ * Static versions order exactly like `mvn::Version`. The key is stored inline,
+ * so literals are limited to 128 characters and 512 bytes of key; longer ones
+ * throw `std::length_error`, which fails compilation of a constant expression.
+ */
+class StaticVersion {
+public:
+    constexpr explicit StaticVersion(std::string_view version)
+        : size_(detail::Builder(version).encode(key_)) { }
+
+    constexpr std::string_view key() const noexcept {
+        return std::string_view(key_, size_);
+    }
+
+private:
+    char key_[detail::kMaxKey] = {};
+    size_t size_;
+};
+
+namespace literals {
+
+MVN_CONSTEVAL StaticVersion operator""_mvn(const char *str, size_t len) {
+    return StaticVersion(std::string_view(str, len));
+}
+
+} // literals namespace
+
+#if defined(__cpp_impl_three_way_comparison)
+#define MVN_KEY_COMPARISONS(A, B, CONSTEXPR) \
+    inline CONSTEXPR bool operator==(A const& a, B const& b) noexcept { \
+        return a.key() == b.key(); \
+    } \
+    inline CONSTEXPR std::weak_ordering operator<=>(A const& a, \
+            B const& b) noexcept { \
+        int cmp = a.key().compare(b.key()); \
+        return cmp < 0 ? std::weak_ordering::less \
+            : cmp > 0 ? std::weak_ordering::greater \
+            : std::weak_ordering::equivalent; \
+    }
+#else
+#define MVN_KEY_COMPARISONS(A, B, CONSTEXPR) \
+    inline CONSTEXPR bool operator==(A const& a, B const& b) noexcept { \
+        return a.key() == b.key(); \
+    } \
+    inline CONSTEXPR bool operator!=(A const& a, B const& b) noexcept { \
+        return a.key() != b.key(); \
+    } \
+    inline CONSTEXPR bool operator<(A const& a, B const& b) noexcept { \
+        return a.key() < b.key(); \
+    } \
+    inline CONSTEXPR bool operator>(A const& a, B const& b) noexcept { \
+        return a.key() > b.key(); \
+    } \
+    inline CONSTEXPR bool operator<=(A const& a, B const& b) noexcept { \
+        return a.key() <= b.key(); \
+    } \
+    inline CONSTEXPR bool operator>=(A const& a, B const& b) noexcept { \
+        return a.key() >= b.key(); \
+    }
+#endif
+
+// Runtime versions do not have constexpr keys
+MVN_KEY_COMPARISONS(StaticVersion, StaticVersion, constexpr)
+MVN_KEY_COMPARISONS(Version, StaticVersion, )
+#if !defined(__cpp_impl_three_way_comparison)
+MVN_KEY_COMPARISONS(StaticVersion, Version, )
+#endif
+
+#undef MVN_KEY_COMPARISONS
+
+} // mvn namespace
+
+#endif // CPP_STATIC_VERSION_H_
@@ -0,0 +1,207 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CPP_VERSION_SET_H_
+#define CPP_VERSION_SET_H_
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "c-maven-utils/cpp/maven-version.h"
+#include "c-maven-utils/maven-range.h"
+
+namespace mvn {
+
+/**
+ * An ordered set of versions, stored as a sorted array.
+ *
+ * Versions carry their sort keys, so a lookup is a binary search over
+ * contiguous memory that compares bytes, with no per-element allocation.
+ * Equal versions (e.g., "1.0" and "1") are kept once. Building a set in bulk
+ * is O(n log n); `insert` and `erase` are O(n).
+ */
+class VersionSet {
+public:
+    using value_type = Version;
+    using size_type = std::size_t;
+    using const_iterator = std::vector<Version>::const_iterator;
+    using iterator = const_iterator;
+
+    /** A run of versions, [first, second). */
+    using Run = std::pair<const_iterator, const_iterator>;
+
+    VersionSet() = default;
+
+    /** Sorts `versions`, keeping the first of any that are equal. */
+    explicit VersionSet(std::vector<Version> versions);
+
+    /** Builds a set from anything a version can be constructed from. */
+    template <typename InputIt>
+    VersionSet(InputIt first, InputIt last)
+        : VersionSet(std::vector<Version>(first, last)) { }
+
+    VersionSet(std::initializer_list<std::string_view> versions)
+        : VersionSet(versions.begin(), versions.end()) { }
+
+    const_iterator begin() const noexcept { return versions_.begin(); }
+    const_iterator end() const noexcept { return versions_.end(); }
+    size_type size() const noexcept { return versions_.size(); }
+    bool empty() const noexcept { return versions_.empty(); }
+
+    const_iterator lower_bound(Version const& v) const {
+        return std::lower_bound(begin(), end(), v);
+    }
+    const_iterator upper_bound(Version const& v) const {
+        return std::upper_bound(begin(), end(), v);
+    }
+    const_iterator find(Version const& v) const {
+        auto it = lower_bound(v);
+        return it != end() && *it == v ? it : end();
+    }
+    bool contains(Version const& v) const { return find(v) != end(); }
+
+    /** @return the new version and true, or the equal one and false */
+    std::pair<const_iterator, bool> insert(Version v);
+
+    /** @return whether a version equal to `v` was removed */
+    bool erase(Version const& v);
+
+    /** @return the highest version, or `end()` if the set is empty */
+    const_iterator latest() const { return empty() ? end() : end() - 1; }
+
+    /** @return the highest release (see `Version::isRelease`), or `end()` */
+    const_iterator latestRelease() const;
+
+    /**
+     * The versions a range contains, as one ascending run per interval of the
+     * range; a plain recommendation contains them all.
+     */
+    std::vector<Run> within(struct maven_range const *range) const;
+
+    /**
+     * Like `within`, for a range specification.
+     *
+     * @throws std::invalid_argument if `spec` is not a valid range
+     */
+    std::vector<Run> within(std::string_view spec) const;
+
+private:
+    // The first version above `bound`, or at it too if `inclusive`
+    const_iterator above(struct maven_version const *bound,
+        bool inclusive) const;
+
+    std::vector<Version> versions_;
+};
+
+inline VersionSet::VersionSet(std::vector<Version> versions)
+        : versions_(std::move(versions)) {
+    std::stable_sort(versions_.begin(), versions_.end());
+    versions_.erase(std::unique(versions_.begin(), versions_.end()),
+        versions_.end());
+}
+
+inline std::pair<VersionSet::const_iterator, bool> VersionSet::insert(
+        Version v) {
+    auto it = lower_bound(v);
+    if (it != end() && *it == v) {
+        return std::make_pair(it, false);
+    }
+    return std::make_pair(versions_.insert(it, std::move(v)), true);
+}
+
+inline bool VersionSet::erase(Version const& v) {
+    auto it = find(v);
+    if (it == end()) {
+        return false;
+    }
+    versions_.erase(it);
+    return true;
+}
+
+inline VersionSet::const_iterator VersionSet::latestRelease() const {
+    for (auto it = end(); it != begin(); ) {
+        if ((--it)->isRelease()) {
+            return it;
+        }
+    }
+    return end();
+}
+
+inline VersionSet::const_iterator VersionSet::above(
+        struct maven_version const *bound, bool inclusive) const {
+    unsigned char buf[128];
+    size_t size = mv_sort_key(bound, buf, sizeof(buf));
+    if (!size) {
+        throw std::bad_alloc();
+    }
+    std::string heap;
+    std::string_view key(reinterpret_cast<char*>(buf), size);
+    if (size > sizeof(buf)) {
+        heap.resize(size);
+        mv_sort_key(bound, reinterpret_cast<unsigned char*>(&heap[0]), size);
+        key = heap;
+    }
+
+    if (inclusive) {
+        return std::lower_bound(begin(), end(), key,
+            [](Version const& v, std::string_view k) { return v.key() < k; });
+    }
+    return std::upper_bound(begin(), end(), key,
+        [](std::string_view k, Version const& v) { return k < v.key(); });
+}
+
+inline std::vector<VersionSet::Run> VersionSet::within(
+        struct maven_range const *range) const {
+    std::vector<Run> ret;
+    for (size_t i = 0; i < mv_range_count(range); ++i) {
+        auto *lower = mv_range_lower(range, i);
+        auto *upper = mv_range_upper(range, i);
+        auto first = lower
+            ? above(lower, mv_range_lower_inclusive(range, i)) : begin();
+        auto last = upper
+            ? above(upper, !mv_range_upper_inclusive(range, i)) : end();
+        if (first < last) {
+            ret.emplace_back(first, last);
+        }
+    }
+    return ret;
+}
+
+inline std::vector<VersionSet::Run> VersionSet::within(
+        std::string_view spec) const {
+    std::string str(spec);
+    std::unique_ptr<struct maven_range, void (*)(struct maven_range*)> range(
+        mv_range_parse(str.c_str()), mv_range_free);
+    if (!range) {
+        throw std::invalid_argument("invalid version range: " + str);
+    }
+    return within(range.get());
+}
+
+} // mvn namespace
+
+#endif // CPP_VERSION_SET_H_
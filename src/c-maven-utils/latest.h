@@ -0,0 +1,104 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LATEST_H_
+#define LATEST_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Latest versions per artifact.
+ *
+ * An aggregation takes (artifact, version) pairs one at a time and keeps
+ * only the newest version of each artifact, overall and among its releases
+ * and snapshots (see `mv_is_release` and `mv_is_snapshot`). Versions are
+ * compared by their sort keys, without being parsed, and the memory used
+ * depends only on the artifacts and the lengths of their newest versions.
+ * Of versions that compare equal, the first one added is kept.
+ *
+ * An aggregation is not thread-safe, but several can be filled in parallel
+ * (from parts of the same input, say) and then merged.
+ */
+
+struct maven_latest;
+
+/** The newest versions of an artifact, filled in by `mv_latest_at`. */
+struct mv_latest_entry {
+    const char *artifact;  /* NUL-terminated */
+    size_t artifact_len;
+    size_t count;          /* Number of versions added */
+
+    /* NUL-terminated, or NULL if there are none of the kind */
+    const char *latest;
+    size_t latest_len;
+    const char *release;
+    size_t release_len;
+    const char *snapshot;
+    size_t snapshot_len;
+};
+
+/**
+ * Callers must free the returned resource with `mv_latest_free`.
+ *
+ * @return an empty aggregation, or NULL if memory could not be allocated
+ */
+struct maven_latest* mv_latest_create(void);
+
+/** Release an aggregation. */
+void mv_latest_free(struct maven_latest *latest);
+
+/**
+ * Add a version of an artifact; both are copied if they are kept.
+ *
+ * @return 1, or 0 if memory could not be allocated
+ */
+int mv_latest_add(struct maven_latest *latest, const char *artifact,
+    size_t artifact_len, const char *version, size_t len);
+
+/**
+ * Add everything in `from` to `into`, as if the versions added to `from`
+ * had been added to `into` after its own.
+ *
+ * @return 1, or 0 if memory could not be allocated
+ */
+int mv_latest_merge(struct maven_latest *into,
+    const struct maven_latest *from);
+
+/** @return the number of artifacts */
+size_t mv_latest_size(const struct maven_latest *latest);
+
+/**
+ * Read the `i`th artifact, in the order artifacts were first added. The
+ * strings remain valid until the aggregation is changed or released.
+ *
+ * @return 1, or 0 if there is no such artifact
+ */
+int mv_latest_at(const struct maven_latest *latest, size_t i,
+    struct mv_latest_entry *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATEST_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MAVEN_RANGE_H_
+#define MAVEN_RANGE_H_
+
+#include <stddef.h>
+
+#include "c-maven-utils/maven-version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct maven_range;
+
+/**
+ * Parse a Maven version range specification [1].
+ *
+ * A specification is a single version, which is only a recommendation and
+ * matches everything (`1.0`), or a comma-separated list of intervals in
+ * ascending order that do not overlap (`[1.0,2.0)`, `(,1.5],[2.0,)`,
+ * `[1.2]`). Bounds are parsed once, and the intervals are kept in order.
+ *
+ * Callers must free the returned resource with `mv_range_free`.
+ *
+ * [1] https://maven.apache.org/enforcer/enforcer-rules/versionRanges.html
+ *
+ * @return an allocated range, or NULL if `spec` is not a valid range or
+ *         memory could not be allocated
+ */
+struct maven_range* mv_range_parse(const char *spec);
+
+/** Release an object allocated with `mv_range_parse`. */
+void mv_range_free(struct maven_range *range);
+
+/** @return whether some interval of `range` contains `version` */
+int mv_range_contains(const struct maven_range *range,
+    const struct maven_version *version);
+
+/**
+ * Find the highest of `n` versions that `range` contains. `versions` must be
+ * sorted in ascending `mv_compare` order; each interval is located with a
+ * binary search.
+ *
+ * @return the index of the match, or `n` if no version matches
+ */
+size_t mv_range_highest(const struct maven_range *range,
+    const struct maven_version *const *versions, size_t n);
+
+/** @return the recommended version of a plain specification, or NULL. */
+const struct maven_version* mv_range_recommended(
+    const struct maven_range *range);
+
+/** @return the number of intervals, in ascending order. */
+size_t mv_range_count(const struct maven_range *range);
+
+/** @return the lower bound of interval `i`, or NULL if it is unbounded. */
+const struct maven_version* mv_range_lower(const struct maven_range *range,
+    size_t i);
+
+/** @return the upper bound of interval `i`, or NULL if it is unbounded. */
+const struct maven_version* mv_range_upper(const struct maven_range *range,
+    size_t i);
+
+/** @return whether interval `i` contains its lower bound. */
+int mv_range_lower_inclusive(const struct maven_range *range, size_t i);
+
+/** @return whether interval `i` contains its upper bound. */
+int mv_range_upper_inclusive(const struct maven_range *range, size_t i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAVEN_RANGE_H_ */
@@ -21,11 +21,39 @@
 #ifndef MAVEN_VERSION_H_
 #define MAVEN_VERSION_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct maven_version;
+struct maven_version_batch;
+
+/**
+ * Memory allocation callbacks.
+ *
+ * `alloc` returns `size` bytes aligned for any object, or NULL on failure.
+ * `free` releases a block returned by `alloc`; `size` is the size that was
+ * requested for it. `ctx` is passed through to both.
+ */
+struct mv_allocator {
+    void* (*alloc)(void *ctx, size_t size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+};
+
+/**
+ * Install the allocator used for every allocation not made through an
+ * explicit allocator (`mv_parse`, `mv_parse_batch`, ...). The callbacks are
+ * copied; NULL restores malloc(3) and free(3).
+ *
+ * This is not synchronized with other calls into the library: install the
+ * allocator before parsing anything, and only replace it once everything
+ * allocated through the previous one has been freed.
+ */
+void mv_set_allocator(const struct mv_allocator *allocator);
 
 /**
  * Parse a string as a Maven version.
@@ -34,6 +62,11 @@ struct maven_version;
  * or more optional numerical components (_minor_, _incremental_, _build_) and
  * an optional string _qualifier_) [1].
  *
+ * The form used for comparison is built the first time the version is
+ * compared or keyed, so versions that are only inspected through the
+ * accessors never pay for it. That build is thread-safe: a version may be
+ * compared from several threads at once.
+ *
  * Callers must free the returned resource with `mv_free`.
  *
  * [1] http://www.mojohaus.org/versions-maven-plugin/version-rules.html
@@ -42,9 +75,39 @@ struct maven_version;
  */
 struct maven_version* mv_parse(const char *str);
 
-/** Release an object allocated with `mv_parse`. */
+/**
+ * Like `mv_parse`, for the `len` bytes at `buf`, which need not be
+ * NUL-terminated (e.g., a field in a memory-mapped file).
+ */
+struct maven_version* mv_parse_n(const char *buf, size_t len);
+
+/**
+ * Like `mv_parse_n`, allocating through `allocator` rather than the installed
+ * allocator. The allocator must remain valid until the version is freed, and
+ * must be thread-safe if the version is compared from several threads.
+ */
+struct maven_version* mv_parse_with(const char *buf, size_t len,
+    const struct mv_allocator *allocator);
+
+/** Release an object allocated with `mv_parse` or `mv_cache_parse`. */
 void mv_free(struct maven_version*);
 
+/**
+ * Parse `n` version strings at once.
+ *
+ * The versions are placed in a single arena owned by the returned batch, and
+ * `versions[i]` receives the parsed form of `strs[i]`. Batch members work with
+ * every accessor and with `mv_compare`; they are all released together by
+ * `mv_batch_free`, and `mv_free` does nothing for them.
+ *
+ * @return the batch, or NULL if memory could not be allocated
+ */
+struct maven_version_batch* mv_parse_batch(const char **strs, size_t n,
+    struct maven_version **versions);
+
+/** Release a batch and every version in it. */
+void mv_batch_free(struct maven_version_batch *batch);
+
 /** @return the major version number, or -1 if no major version is set. */
 int mv_major(struct maven_version *);
 
@@ -60,9 +123,97 @@ int mv_build(struct maven_version *);
 /** @return the qualifier, or NULL. */
 const char* mv_qualifier(struct maven_version *);
 
+/**
+ * Whether a version is a release: it has no qualifiers, or only ones that
+ * Maven treats as a release ("1.0-ga", "1.1.Final"). Snapshots (including
+ * timestamped ones, "1.0-20200101.123456-1"), milestones, service packs and
+ * unknown qualifiers are not releases.
+ *
+ * @return 1 for a release, otherwise 0
+ */
+int mv_is_release(const struct maven_version *version);
+
+/**
+ * Whether a version is a snapshot, as Maven decides it: it ends with
+ * "SNAPSHOT" in any case, or is a deployed snapshot with a timestamp and
+ * build number ("1.0-20200101.123456-1").
+ *
+ * @return 1 for a snapshot, otherwise 0
+ */
+int mv_is_snapshot(const struct maven_version *version);
+
 /** @return -1, 0, 1 for a < b, a == b, a > b, respectively. */
 int mv_compare(const struct maven_version *a, const struct maven_version *b);
 
+/**
+ * Compare two version strings without parsing them into objects.
+ *
+ * Equivalent to `mv_compare` on the parsed versions, but allocates nothing and
+ * walks each string at most a few times.
+ *
+ * @return -1, 0, 1 for a < b, a == b, a > b, respectively.
+ */
+int mv_compare_str(const char *a, const char *b);
+
+/**
+ * Write a binary sort key for a version.
+ *
+ * Keys order under memcmp(3) like their versions do under `mv_compare`, so
+ * they can be stored in byte-ordered indexes or radix sorted. No key is a
+ * prefix of another, and versions that compare equal have identical keys.
+ *
+ * Maven's ordering is not transitive for a few unusual mixes of separators
+ * (e.g., "1-alpha" < "1" < "1.sp" < "1-alpha"), and a sublist compared with
+ * a missing component takes the sign of its first child only (so "1-0.1"
+ * equals "1"). No byte order can reproduce those; keys order such versions
+ * the way Maven 3.9 does, by their first non-null component.
+ *
+ * At most `size` bytes are written to `buf`.
+ *
+ * @return the length of the complete key, which may exceed `size`, or 0 if
+ *         memory could not be allocated
+ */
+size_t mv_sort_key(const struct maven_version *version, unsigned char *buf,
+    size_t size);
+
+/**
+ * Like `mv_sort_key`, for a version that has not been parsed.
+ *
+ * @return the length of the complete key, or 0 if memory could not be
+ *         allocated
+ */
+size_t mv_sort_key_str(const char *str, unsigned char *buf, size_t size);
+
+/** Like `mv_sort_key_str`, for the `len` bytes at `str`. */
+size_t mv_sort_key_n(const char *str, size_t len, unsigned char *buf,
+    size_t size);
+
+/**
+ * Write the canonical form of a version: Maven's `getCanonical`, with
+ * aliases resolved and null components dropped ("1.0.0-GA" is "1",
+ * "1-A1" is "1-alpha-1"). Versions with the same sort key have the same
+ * canonical form, but not the other way around: like Maven, this drops the
+ * separator after a leading null component, so "ga-1" is "1" too.
+ *
+ * At most `size` bytes are written to `buf`, including a terminating NUL
+ * when `size` is not zero.
+ *
+ * @return the length of the complete canonical form (without the NUL), which
+ *         may be `size` or more, or 0 if memory could not be allocated
+ */
+size_t mv_canonical(const struct maven_version *version, char *buf,
+    size_t size);
+
+/**
+ * Hash a version consistently with its equality: versions with the same sort
+ * key, and so all versions that compare equal outside of the non-transitive
+ * mixes described at `mv_sort_key`, hash equally ("1.0" and "1.0.0.0-ga"
+ * do). Hashes are not stable across releases of the library.
+ *
+ * @return the hash, or 0 if memory could not be allocated
+ */
+uint64_t mv_hash(const struct maven_version *version);
+
 #ifdef __cplusplus
 }
 #endif
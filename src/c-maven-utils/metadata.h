@@ -0,0 +1,135 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef METADATA_H_
+#define METADATA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reading `maven-metadata.xml`.
+ *
+ * The parser pulls the fields of a metadata document out of a buffer that
+ * holds all of it (read or mapped from a file) one at a time, as slices of
+ * that buffer. It keeps no state beyond the parser itself and never
+ * allocates, so the slices can go straight to `mv_parse_n`:
+ *
+ *     struct mv_metadata_parser parser;
+ *     struct mv_metadata_entry entry;
+ *
+ *     mv_metadata_init(&parser, buf, len);
+ *     while (mv_metadata_next(&parser, &entry)) {
+ *         if (entry.field == MV_METADATA_VERSION) {
+ *             struct maven_version *v = mv_parse_n(entry.value, entry.len);
+ *             ...
+ *         }
+ *     }
+ *     if (mv_metadata_failed(&parser)) { ... }
+ *
+ * Only the elements of the metadata schema below are reported, wherever
+ * they appear among other elements; attributes, namespace prefixes,
+ * comments, processing instructions and the document type are skipped.
+ * Values are trimmed of surrounding white space and may be CDATA sections,
+ * but are not otherwise decoded: entity references are left as they are.
+ */
+
+enum mv_metadata_field {
+    MV_METADATA_GROUP_ID,          /* metadata/groupId */
+    MV_METADATA_ARTIFACT_ID,       /* metadata/artifactId */
+    MV_METADATA_BASE_VERSION,      /* metadata/version, of a snapshot */
+    MV_METADATA_LATEST,            /* versioning/latest */
+    MV_METADATA_RELEASE,           /* versioning/release */
+    MV_METADATA_VERSION,           /* versioning/versions/version */
+    MV_METADATA_LAST_UPDATED,      /* versioning/lastUpdated */
+    MV_METADATA_SNAPSHOT_TIMESTAMP,    /* versioning/snapshot/timestamp */
+    MV_METADATA_SNAPSHOT_BUILD_NUMBER, /* versioning/snapshot/buildNumber */
+    MV_METADATA_SNAPSHOT_VERSION   /* versioning/snapshotVersions/... */
+};
+
+/** A field read from a document. Slices are not NUL-terminated. */
+struct mv_metadata_entry {
+    enum mv_metadata_field field;
+    const char *value;
+    size_t len;
+
+    /*
+     * The rest of a snapshot version (its value is `value`); NULL and 0 for
+     * other fields and for missing elements
+     */
+    const char *classifier;
+    size_t classifier_len;
+    const char *extension;
+    size_t extension_len;
+    const char *updated;
+    size_t updated_len;
+};
+
+#define MV_METADATA_MAX_DEPTH 8
+
+/** Parser state; initialize with `mv_metadata_init`. */
+struct mv_metadata_parser {
+    /* Internal */
+    const char *buf;
+    size_t len;
+    size_t pos;
+    size_t depth;
+    int failed;
+    unsigned char nodes[MV_METADATA_MAX_DEPTH];
+    size_t names[MV_METADATA_MAX_DEPTH];      /* Offsets of open tags' */
+    size_t name_lens[MV_METADATA_MAX_DEPTH];  /* names, to match closes */
+    size_t text;                              /* Value of the open element */
+    size_t text_len;
+    int has_text;
+    size_t snapshot[4];                       /* Pending snapshot version: */
+    size_t snapshot_lens[4];                  /* classifier, extension, */
+    unsigned snapshot_fields;                 /* value and updated */
+};
+
+/** Start parsing the `len` bytes at `buf`, which must outlive the parser. */
+void mv_metadata_init(struct mv_metadata_parser *parser, const char *buf,
+    size_t len);
+
+/**
+ * Read the next field, in document order. A snapshot version is reported
+ * when its element closes, and only if it has a value.
+ *
+ * @return 1, or 0 at the end of the document or if it is malformed
+ */
+int mv_metadata_next(struct mv_metadata_parser *parser,
+    struct mv_metadata_entry *entry);
+
+/**
+ * Whether parsing stopped at malformed input: a tag, comment or other
+ * markup left open or not closed in order, or a value split by markup.
+ * Fields read before that point were well formed.
+ *
+ * @return 1 if the document is malformed, otherwise 0
+ */
+int mv_metadata_failed(const struct mv_metadata_parser *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METADATA_H_ */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RANGE_INDEX_H_
+#define RANGE_INDEX_H_
+
+#include <stddef.h>
+
+#include "c-maven-utils/maven-range.h"
+#include "c-maven-utils/maven-version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct maven_range_index;
+
+/**
+ * Build an index over `n` ranges that answers which of them contain a
+ * version. `values[i]` is reported for matches of `ranges[i]`.
+ *
+ * The index refers to the ranges rather than copying them; they must outlive
+ * it. A plain recommendation (`1.0`) contains every version.
+ *
+ * Callers must free the returned resource with `mv_range_index_free`.
+ *
+ * @return the index, or NULL if memory could not be allocated
+ */
+struct maven_range_index* mv_range_index_build(
+    const struct maven_range *const *ranges, void *const *values, size_t n);
+
+/** Release an index. The indexed ranges are not freed. */
+void mv_range_index_free(struct maven_range_index *index);
+
+/**
+ * Add a range to the index.
+ *
+ * @return 1, or 0 if memory could not be allocated
+ */
+int mv_range_index_insert(struct maven_range_index *index,
+    const struct maven_range *range, void *value);
+
+/**
+ * Remove a range that was added to the index.
+ *
+ * @return 1, or 0 if the range is not in the index
+ */
+int mv_range_index_remove(struct maven_range_index *index,
+    const struct maven_range *range);
+
+/** @return the number of ranges in the index. */
+size_t mv_range_index_size(const struct maven_range_index *index);
+
+/**
+ * Find the ranges that contain `version`, in O(log n + k) comparisons for k
+ * matches. The values of at most `size` of them are written to `values`, in
+ * no particular order.
+ *
+ * @return the number of matching ranges, which may exceed `size`
+ */
+size_t mv_range_index_query(const struct maven_range_index *index,
+    const struct maven_version *version, void **values, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RANGE_INDEX_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stddef.h>
+
+#include "c-maven-utils/maven-version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Scanning Maven repositories.
+ *
+ * A repository on disk (`~/.m2/repository`, or a mirror) keeps each version
+ * of an artifact in `group/path/artifactId/version/`. A scan walks such a
+ * tree with a pool of threads and lists every artifact with its versions.
+ * A directory is taken to be a version when it holds a file named after the
+ * artifact and version ("maven-core-3.9.6.pom" in "maven-core/3.9.6", or
+ * one starting with "lib-1.0-" in "lib/1.0-SNAPSHOT"); other directories
+ * are searched for artifacts.
+ * Hidden directories and symbolic links are skipped.
+ */
+
+struct maven_scan;
+
+/** An artifact found by a scan, filled in by `mv_scan_artifact_at`. */
+struct mv_scan_artifact {
+    const char *name;                      /* "groupId:artifactId" */
+    size_t len;
+    struct maven_version *const *versions; /* In sort-key order */
+    const char *const *strs;               /* The version directories */
+    size_t count;
+};
+
+/**
+ * Scan the repository at `root` with `threads` threads, or one per CPU if
+ * `threads` is 0. Directories that cannot be read are skipped and counted.
+ *
+ * The versions found belong to the scan, and are released with it by
+ * `mv_scan_free`; they must not be passed to `mv_free`.
+ *
+ * @return the scan, or NULL with errno set if `root` cannot be read or
+ *         memory could not be allocated
+ */
+struct maven_scan* mv_scan(const char *root, unsigned threads);
+
+/** Release a scan and every version in it. */
+void mv_scan_free(struct maven_scan *scan);
+
+/** @return the number of artifacts found */
+size_t mv_scan_size(const struct maven_scan *scan);
+
+/** @return the number of directories that could not be read */
+size_t mv_scan_skipped(const struct maven_scan *scan);
+
+/**
+ * Read the `i`th artifact, in byte order of their names.
+ *
+ * @return 1, or 0 if there is no such artifact
+ */
+int mv_scan_artifact_at(const struct maven_scan *scan, size_t i,
+    struct mv_scan_artifact *artifact);
+
+/**
+ * Write the scanned artifacts to a catalog file (see
+ * `c-maven-utils/catalog.h`).
+ *
+ * @return 1, or 0 with errno set if the catalog could not be written
+ */
+int mv_scan_write_catalog(const struct maven_scan *scan, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCAN_H_ */
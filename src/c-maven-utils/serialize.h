@@ -0,0 +1,109 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERIALIZE_H_
+#define SERIALIZE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c-maven-utils/maven-version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Serialized versions.
+ *
+ * A record holds everything `mv_parse` computes for a version, including its
+ * comparable form, so loading one never re-parses the string. Records are
+ * little endian, padded to a multiple of 8 bytes, and carry a format version
+ * that later releases will continue to read, so they can be stored or sent
+ * to other processes. Records can be concatenated into tables, which
+ * `mv_view_init` walks.
+ */
+
+/**
+ * Serialize `version` into `buf`, writing at most `size` bytes.
+ *
+ * @return the size of the complete record, which may exceed `size`, or 0 if
+ *         memory could not be allocated
+ */
+size_t mv_serialize(const struct maven_version *version, void *buf,
+    size_t size);
+
+/**
+ * Copy the record at the start of `buf` into a new version, after checking
+ * that it lies within the `len` bytes and is well formed. The result works
+ * like a version from `mv_parse` and is released with `mv_free`.
+ *
+ * @return the version, or NULL if the record is malformed or memory could
+ *         not be allocated
+ */
+struct maven_version* mv_deserialize(const void *buf, size_t len);
+
+/**
+ * A version read in place from a record, which must outlive it. The fields
+ * are those of `mv_major`, ... `mv_qualifier`, plus the original string.
+ */
+struct mv_version_view {
+    int major;
+    int minor;
+    int incremental;
+    int build;
+    const char *qualifier; /* Empty if there is none */
+    const char *version;   /* NUL-terminated */
+    size_t len;            /* Of `version` */
+
+    /* Internal */
+    const void *comparable;
+    int has_ordinal;
+    uint64_t ordinal[2];
+};
+
+/**
+ * Check the record at the start of `buf` as `mv_deserialize` does and make
+ * `view` refer to it, without copying or allocating.
+ *
+ * Comparing views in place needs a little-endian host and a record that is
+ * 8-byte aligned; other records are rejected (and can be loaded with
+ * `mv_deserialize`).
+ *
+ * @return the size of the record, which is where the next record in a table
+ *         starts, or 0 if it is malformed or cannot be viewed
+ */
+size_t mv_view_init(struct mv_version_view *view, const void *buf,
+    size_t len);
+
+/**
+ * Compare two views as `mv_compare` compares the versions they were
+ * serialized from.
+ *
+ * @return -1, 0, 1 for a < b, a == b, a > b, respectively.
+ */
+int mv_view_compare(const struct mv_version_view *a,
+    const struct mv_version_view *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SERIALIZE_H_ */
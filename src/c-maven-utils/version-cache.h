@@ -0,0 +1,85 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VERSION_CACHE_H_
+#define VERSION_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c-maven-utils/maven-version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct maven_version_cache;
+
+/** Counters for sizing a cache. */
+struct mv_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t size; /* Versions currently cached */
+};
+
+/**
+ * Create a cache of up to `capacity` parsed versions (at least one), keyed by
+ * the exact bytes they were parsed from. When full, a version that has not
+ * been looked up recently is evicted (CLOCK). The cache is split into
+ * independently locked shards, so it may be used from many threads at once.
+ *
+ * Callers must free the returned resource with `mv_cache_free`.
+ *
+ * @return the cache, or NULL if memory could not be allocated
+ */
+struct maven_version_cache* mv_cache_create(size_t capacity);
+
+/**
+ * Release a cache. Versions returned by it remain valid until they are
+ * released themselves.
+ */
+void mv_cache_free(struct maven_version_cache *cache);
+
+/**
+ * Like `mv_parse`, returning the cached version for `str` if there is one.
+ *
+ * Cached versions are shared between callers and must not be modified;
+ * every one returned holds a reference that the caller releases with
+ * `mv_free`.
+ *
+ * @return a version, or NULL if memory could not be allocated
+ */
+struct maven_version* mv_cache_parse(struct maven_version_cache *cache,
+    const char *str);
+
+/** Like `mv_cache_parse`, for the `len` bytes at `buf`. */
+struct maven_version* mv_cache_parse_n(struct maven_version_cache *cache,
+    const char *buf, size_t len);
+
+/** Read the cache's counters, summed over its shards. */
+void mv_cache_stats(struct maven_version_cache *cache,
+    struct mv_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VERSION_CACHE_H_ */
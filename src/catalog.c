@@ -0,0 +1,617 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/catalog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "byte-order.h"
+#include "c-maven-utils/maven-version.h"
+
+/*
+ * File layout (little endian, tables 8-byte aligned):
+ *
+ *   0  "MVNCATLG"
+ *   8  u32 format version, u32 reserved
+ *  16  u64 number of artifacts, u64 number of versions
+ *  32  u64 offsets of the artifact table, the version table and the strings
+ *  56  u64 size of the file
+ *  64  artifact table, sorted by name: u64 name offset, u32 name length,
+ *      u32 reserved, u64 index of the first version, u64 number of versions
+ *      version table, each artifact's versions in ascending order: u64 key
+ *      offset, u32 key length, u32 version length, u64 version offset
+ *      strings: each artifact's NUL-terminated name, then the key and the
+ *      NUL-terminated string of each of its versions
+ */
+#define kFormatVersion 1
+#define kHeaderSize 64
+#define kArtifactSize 32
+#define kVersionSize 24
+
+static const char kMagic[8] = { 'M', 'V', 'N', 'C', 'A', 'T', 'L', 'G' };
+
+/* Keys up to this long are computed on the stack */
+#define kStackKeySize 256
+
+/* Arena chunks of the builder's copies */
+#define kBuilderChunkSize (64 * 1024)
+
+static int compare_bytes(const void *a, size_t alen, const void *b,
+        size_t blen) {
+    int cmp = memcmp(a, b, alen < blen ? alen : blen);
+    if (cmp) {
+        return cmp;
+    }
+    return alen < blen ? -1 : alen > blen;
+}
+
+/*
+ * Building.
+ */
+
+struct entry {
+    const char *artifact;
+    const char *version;
+    const unsigned char *key;
+    uint32_t artifact_len;
+    uint32_t len;
+    uint32_t key_len;
+};
+
+struct maven_catalog_builder {
+    struct arena arena;
+    struct entry *entries;
+    size_t n;
+    size_t capacity;
+};
+
+struct maven_catalog_builder* mv_catalog_builder_create(void) {
+    struct maven_catalog_builder *b = (struct maven_catalog_builder*)
+        mv_internal_alloc(&mv_internal_allocator, sizeof(*b));
+    if (!b) {
+        return NULL;
+    }
+    memset(b, 0, sizeof(*b));
+    mv_internal_arena_init(&b->arena, &mv_internal_allocator,
+        kBuilderChunkSize);
+    return b;
+}
+
+void mv_catalog_builder_free(struct maven_catalog_builder *b) {
+    if (b->entries) {
+        mv_internal_free(&mv_internal_allocator, b->entries,
+            b->capacity * sizeof(struct entry));
+    }
+    mv_internal_arena_release(&b->arena);
+    mv_internal_free(&mv_internal_allocator, b, sizeof(*b));
+}
+
+static int reserve(struct maven_catalog_builder *b) {
+    if (b->n < b->capacity) {
+        return 1;
+    }
+    size_t capacity = b->capacity ? 2 * b->capacity : 1024;
+    struct entry *entries = (struct entry*) mv_internal_alloc(
+        &mv_internal_allocator, capacity * sizeof(struct entry));
+    if (!entries) {
+        return 0;
+    }
+    if (b->entries) {
+        memcpy(entries, b->entries, b->n * sizeof(struct entry));
+        mv_internal_free(&mv_internal_allocator, b->entries,
+            b->capacity * sizeof(struct entry));
+    }
+    b->entries = entries;
+    b->capacity = capacity;
+    return 1;
+}
+
+static char* copy_string(struct arena *arena, const char *str, size_t len) {
+    char *ret = (char*) mv_internal_arena_alloc(arena, len + 1);
+    if (ret) {
+        memcpy(ret, str, len);
+        ret[len] = '\0';
+    }
+    return ret;
+}
+
+int mv_catalog_builder_add(struct maven_catalog_builder *b,
+        const char *artifact, size_t artifact_len, const char *version,
+        size_t len) {
+    if (artifact_len > UINT32_MAX || len > UINT32_MAX || !reserve(b)) {
+        return 0;
+    }
+
+    unsigned char stack_key[kStackKeySize];
+    size_t key_len = mv_sort_key_n(version, len, stack_key,
+        sizeof(stack_key));
+    unsigned char *key = (unsigned char*) mv_internal_arena_alloc(&b->arena,
+        key_len);
+    if (!key_len || !key) {
+        return 0;
+    }
+    if (key_len <= sizeof(stack_key)) {
+        memcpy(key, stack_key, key_len);
+    } else {
+        mv_sort_key_n(version, len, key, key_len);
+    }
+
+    /* Versions tend to arrive grouped by artifact; share the name */
+    struct entry *e = &b->entries[b->n];
+    const struct entry *prev = b->n ? e - 1 : NULL;
+    if (prev && prev->artifact_len == artifact_len
+            && memcmp(prev->artifact, artifact, artifact_len) == 0) {
+        e->artifact = prev->artifact;
+    } else {
+        e->artifact = copy_string(&b->arena, artifact, artifact_len);
+    }
+    e->version = copy_string(&b->arena, version, len);
+    if (!e->artifact || !e->version) {
+        return 0;
+    }
+    e->key = key;
+    e->artifact_len = artifact_len;
+    e->len = len;
+    e->key_len = key_len;
+    ++b->n;
+    return 1;
+}
+
+static int same_artifact(const struct entry *a, const struct entry *b) {
+    return a->artifact_len == b->artifact_len
+        && memcmp(a->artifact, b->artifact, a->artifact_len) == 0;
+}
+
+/* By artifact, then version; equal versions by string, for stable output */
+static int compare_entries(const void *pa, const void *pb) {
+    const struct entry *a = (const struct entry*) pa;
+    const struct entry *b = (const struct entry*) pb;
+    int cmp = compare_bytes(a->artifact, a->artifact_len, b->artifact,
+        b->artifact_len);
+    if (!cmp) {
+        cmp = compare_bytes(a->key, a->key_len, b->key, b->key_len);
+    }
+    if (!cmp) {
+        cmp = compare_bytes(a->version, a->len, b->version, b->len);
+    }
+    return cmp;
+}
+
+/* Whether sorted entry `i` repeats the one before it */
+static int is_duplicate(const struct entry *entries, size_t i) {
+    return i > 0 && same_artifact(&entries[i - 1], &entries[i])
+        && entries[i - 1].len == entries[i].len
+        && memcmp(entries[i - 1].version, entries[i].version,
+            entries[i].len) == 0;
+}
+
+static int starts_artifact(const struct entry *entries, size_t i) {
+    return i == 0 || !same_artifact(&entries[i - 1], &entries[i]);
+}
+
+static int write_bytes(FILE *f, const void *buf, size_t size) {
+    return fwrite(buf, 1, size, f) == size;
+}
+
+static int write_catalog(struct maven_catalog_builder *b, FILE *f) {
+    const struct entry *entries = b->entries;
+    uint64_t nartifacts = 0;
+    uint64_t nversions = 0;
+    uint64_t strings_size = 0;
+    size_t i, j;
+    for (i = 0; i < b->n; ++i) {
+        if (starts_artifact(entries, i)) {
+            ++nartifacts;
+            strings_size += entries[i].artifact_len + 1;
+        }
+        if (!is_duplicate(entries, i)) {
+            ++nversions;
+            strings_size += entries[i].key_len + entries[i].len + 1;
+        }
+    }
+
+    uint64_t versions_offset = kHeaderSize + nartifacts * kArtifactSize;
+    uint64_t strings_offset = versions_offset + nversions * kVersionSize;
+    unsigned char buf[kHeaderSize];
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, kMagic, sizeof(kMagic));
+    mv_internal_put_u32(buf + 8, kFormatVersion);
+    mv_internal_put_u64(buf + 16, nartifacts);
+    mv_internal_put_u64(buf + 24, nversions);
+    mv_internal_put_u64(buf + 32, kHeaderSize);
+    mv_internal_put_u64(buf + 40, versions_offset);
+    mv_internal_put_u64(buf + 48, strings_offset);
+    mv_internal_put_u64(buf + 56, strings_offset + strings_size);
+    if (!write_bytes(f, buf, kHeaderSize)) {
+        return 0;
+    }
+
+    /* The tables, laying out the strings as they go */
+    uint64_t offset = strings_offset;
+    uint64_t first = 0;
+    for (i = 0; i < b->n; i = j) {
+        uint64_t count = 0;
+        for (j = i; j < b->n && (j == i || !starts_artifact(entries, j));
+                ++j) {
+            count += !is_duplicate(entries, j);
+        }
+        memset(buf, 0, kArtifactSize);
+        mv_internal_put_u64(buf, offset);
+        mv_internal_put_u32(buf + 8, entries[i].artifact_len);
+        mv_internal_put_u64(buf + 16, first);
+        mv_internal_put_u64(buf + 24, count);
+        if (!write_bytes(f, buf, kArtifactSize)) {
+            return 0;
+        }
+        offset += entries[i].artifact_len + 1;
+        for (; i < j; ++i) {
+            if (!is_duplicate(entries, i)) {
+                offset += entries[i].key_len + entries[i].len + 1;
+            }
+        }
+        first += count;
+    }
+
+    offset = strings_offset;
+    for (i = 0; i < b->n; ++i) {
+        if (starts_artifact(entries, i)) {
+            offset += entries[i].artifact_len + 1;
+        }
+        if (is_duplicate(entries, i)) {
+            continue;
+        }
+        mv_internal_put_u64(buf, offset);
+        mv_internal_put_u32(buf + 8, entries[i].key_len);
+        mv_internal_put_u32(buf + 12, entries[i].len);
+        mv_internal_put_u64(buf + 16, offset + entries[i].key_len);
+        if (!write_bytes(f, buf, kVersionSize)) {
+            return 0;
+        }
+        offset += entries[i].key_len + entries[i].len + 1;
+    }
+
+    for (i = 0; i < b->n; ++i) {
+        if (starts_artifact(entries, i) && !write_bytes(f,
+                entries[i].artifact, entries[i].artifact_len + 1)) {
+            return 0;
+        }
+        if (!is_duplicate(entries, i) && (!write_bytes(f, entries[i].key,
+                entries[i].key_len) || !write_bytes(f, entries[i].version,
+                entries[i].len + 1))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int mv_catalog_builder_write(struct maven_catalog_builder *b,
+        const char *path) {
+    if (b->n) {
+        qsort(b->entries, b->n, sizeof(struct entry), compare_entries);
+    }
+
+    size_t path_len = strlen(path);
+    size_t tmp_size = path_len + sizeof(".tmp");
+    char *tmp = (char*) mv_internal_alloc(&mv_internal_allocator, tmp_size);
+    if (!tmp) {
+        errno = ENOMEM;
+        return 0;
+    }
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", sizeof(".tmp"));
+
+    FILE *f = fopen(tmp, "wb");
+    int ok = f != NULL;
+    if (f) {
+        ok = write_catalog(b, f);
+        ok = fclose(f) == 0 && ok;
+        ok = ok && rename(tmp, path) == 0;
+        if (!ok) {
+            int saved = errno;
+            unlink(tmp);
+            errno = saved;
+        }
+    }
+    mv_internal_free(&mv_internal_allocator, tmp, tmp_size);
+    return ok;
+}
+
+/*
+ * Reading.
+ */
+
+struct maven_catalog {
+    const unsigned char *data;
+    size_t size;
+    uint64_t nartifacts;
+    uint64_t nversions;
+    const unsigned char *artifacts;
+    const unsigned char *versions;
+};
+
+/* Whether the header describes a catalog of `size` bytes */
+static int check_header(const unsigned char *data, size_t size,
+        struct maven_catalog *catalog) {
+    if (memcmp(data, kMagic, sizeof(kMagic)) != 0
+            || mv_internal_get_u32(data + 8) != kFormatVersion
+            || mv_internal_get_u64(data + 56) != size
+            || mv_internal_get_u64(data + 32) != kHeaderSize) {
+        return 0;
+    }
+    uint64_t nartifacts = mv_internal_get_u64(data + 16);
+    uint64_t nversions = mv_internal_get_u64(data + 24);
+    uint64_t versions_offset = mv_internal_get_u64(data + 40);
+    uint64_t strings_offset = mv_internal_get_u64(data + 48);
+    if (nartifacts > (size - kHeaderSize) / kArtifactSize
+            || versions_offset != kHeaderSize + nartifacts * kArtifactSize
+            || nversions > (size - versions_offset) / kVersionSize
+            || strings_offset != versions_offset + nversions * kVersionSize) {
+        return 0;
+    }
+
+    catalog->nartifacts = nartifacts;
+    catalog->nversions = nversions;
+    catalog->artifacts = data + kHeaderSize;
+    catalog->versions = data + versions_offset;
+    return 1;
+}
+
+struct maven_catalog* mv_catalog_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size < kHeaderSize) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t size = (size_t) st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    struct maven_catalog *catalog = (struct maven_catalog*)
+        mv_internal_alloc(&mv_internal_allocator, sizeof(*catalog));
+    if (!catalog) {
+        munmap(data, size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    catalog->data = (const unsigned char*) data;
+    catalog->size = size;
+    if (!check_header(catalog->data, size, catalog)) {
+        mv_catalog_close(catalog);
+        errno = EINVAL;
+        return NULL;
+    }
+    return catalog;
+}
+
+void mv_catalog_close(struct maven_catalog *catalog) {
+    munmap((void*) catalog->data, catalog->size);
+    mv_internal_free(&mv_internal_allocator, catalog, sizeof(*catalog));
+}
+
+size_t mv_catalog_size(const struct maven_catalog *catalog) {
+    return catalog->nartifacts;
+}
+
+/*
+ * @return the `len` bytes at `offset`, followed by a NUL if `terminated`,
+ *         or NULL if they are not all in the file
+ */
+static const char* string_at(const struct maven_catalog *catalog,
+        uint64_t offset, uint64_t len, int terminated) {
+    if (offset > catalog->size || len + terminated > catalog->size - offset
+            || (terminated && catalog->data[offset + len] != '\0')) {
+        return NULL;
+    }
+    return (const char*) catalog->data + offset;
+}
+
+int mv_catalog_artifact_at(const struct maven_catalog *catalog, size_t i,
+        struct mv_catalog_artifact *artifact) {
+    if (i >= catalog->nartifacts) {
+        return 0;
+    }
+    const unsigned char *rec = catalog->artifacts + i * kArtifactSize;
+    uint32_t len = mv_internal_get_u32(rec + 8);
+    uint64_t first = mv_internal_get_u64(rec + 16);
+    uint64_t count = mv_internal_get_u64(rec + 24);
+    const char *name = string_at(catalog, mv_internal_get_u64(rec), len, 1);
+    if (!name || first > catalog->nversions
+            || count > catalog->nversions - first) {
+        return 0;
+    }
+    artifact->name = name;
+    artifact->len = len;
+    artifact->count = count;
+    artifact->catalog = catalog;
+    artifact->first = first;
+    return 1;
+}
+
+int mv_catalog_find(const struct maven_catalog *catalog, const char *name,
+        size_t len, struct mv_catalog_artifact *artifact) {
+    size_t lo = 0;
+    size_t hi = catalog->nartifacts;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!mv_catalog_artifact_at(catalog, mid, artifact)) {
+            return 0;
+        }
+        int cmp = compare_bytes(artifact->name, artifact->len, name, len);
+        if (cmp == 0) {
+            return 1;
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+/* The key of the `i`th version of `artifact`, which must exist */
+static const unsigned char* key_at(const struct mv_catalog_artifact *artifact,
+        size_t i, size_t *key_len) {
+    const struct maven_catalog *catalog = artifact->catalog;
+    const unsigned char *rec = catalog->versions
+        + (artifact->first + i) * kVersionSize;
+    *key_len = mv_internal_get_u32(rec + 8);
+    const char *key = string_at(catalog, mv_internal_get_u64(rec), *key_len,
+        0);
+    if (!key) {
+        key = ""; /* Orders first; the file is corrupt anyway */
+        *key_len = 0;
+    }
+    return (const unsigned char*) key;
+}
+
+const char* mv_catalog_version(const struct mv_catalog_artifact *artifact,
+        size_t i, size_t *len) {
+    if (i >= artifact->count) {
+        return NULL;
+    }
+    const struct maven_catalog *catalog = artifact->catalog;
+    const unsigned char *rec = catalog->versions
+        + (artifact->first + i) * kVersionSize;
+    *len = mv_internal_get_u32(rec + 12);
+    return string_at(catalog, mv_internal_get_u64(rec + 16), *len, 1);
+}
+
+const char* mv_catalog_latest(const struct mv_catalog_artifact *artifact,
+        size_t *len) {
+    if (!artifact->count) {
+        return NULL;
+    }
+    return mv_catalog_version(artifact, artifact->count - 1, len);
+}
+
+/* The sort key of a queried version */
+struct query_key {
+    unsigned char stack[kStackKeySize];
+    unsigned char *key;
+    size_t len;
+};
+
+/* @return 1, or 0 with errno set if the key could not be allocated */
+static int query_key_init(struct query_key *q, const char *version,
+        size_t len) {
+    q->key = q->stack;
+    q->len = mv_sort_key_n(version, len, q->stack, sizeof(q->stack));
+    if (q->len > sizeof(q->stack)) {
+        q->key = (unsigned char*) mv_internal_alloc(&mv_internal_allocator,
+            q->len);
+        if (q->key && !mv_sort_key_n(version, len, q->key, q->len)) {
+            mv_internal_free(&mv_internal_allocator, q->key, q->len);
+            q->key = NULL;
+        }
+    }
+    if (!q->len || !q->key) {
+        errno = ENOMEM;
+        return 0;
+    }
+    return 1;
+}
+
+static void query_key_release(struct query_key *q) {
+    if (q->key != q->stack) {
+        mv_internal_free(&mv_internal_allocator, q->key, q->len);
+    }
+}
+
+/*
+ * @return the index of the first version whose key is not less than (or,
+ *         for `upper`, greater than) `q`
+ */
+static size_t search(const struct mv_catalog_artifact *artifact,
+        const struct query_key *q, int upper) {
+    size_t lo = 0;
+    size_t hi = artifact->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t key_len;
+        const unsigned char *key = key_at(artifact, mid, &key_len);
+        int cmp = compare_bytes(key, key_len, q->key, q->len);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+size_t mv_catalog_lower_bound(const struct mv_catalog_artifact *artifact,
+        const char *version, size_t len) {
+    struct query_key q;
+    if (!query_key_init(&q, version, len)) {
+        return (size_t) -1;
+    }
+    size_t ret = search(artifact, &q, 0);
+    query_key_release(&q);
+    return ret;
+}
+
+size_t mv_catalog_upper_bound(const struct mv_catalog_artifact *artifact,
+        const char *version, size_t len) {
+    struct query_key q;
+    if (!query_key_init(&q, version, len)) {
+        return (size_t) -1;
+    }
+    size_t ret = search(artifact, &q, 1);
+    query_key_release(&q);
+    return ret;
+}
+
+int mv_catalog_contains(const struct mv_catalog_artifact *artifact,
+        const char *version, size_t len) {
+    struct query_key q;
+    if (!query_key_init(&q, version, len)) {
+        return -1;
+    }
+    size_t i = search(artifact, &q, 0);
+    int ret = 0;
+    if (i < artifact->count) {
+        size_t key_len;
+        const unsigned char *key = key_at(artifact, i, &key_len);
+        ret = compare_bytes(key, key_len, q.key, q.len) == 0;
+    }
+    query_key_release(&q);
+    return ret;
+}
@@ -22,304 +22,286 @@
 
 #include <assert.h>
 #include <ctype.h>
-#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct list_head {
-    struct list_head *next;
-    struct list_head *prev;
-};
-
-static int list_empty(struct list_head *head) {
-    return head->next == head;
-}
-
-static void list_init(struct list_head *head) {
-    head->next = head->prev = head;
-}
-
-static void list_del(struct list_head *entry) {
-    entry->prev->next = entry->next;
-    entry->next->prev = entry->prev;
-    entry->next = entry->prev = entry;
-}
-
-static void list_insert_front(struct list_head *head, struct list_head *entry) {
-    assert(list_empty(entry));
-
-    entry->next = head->next;
-    entry->next->prev = entry;
-    head->next = entry;
-    entry->prev = head;
-}
-
-static void list_insert_back(struct list_head *head, struct list_head *entry) {
-    assert(list_empty(entry));
-
-    entry->prev = head->prev;
-    entry->prev->next = entry;
-    head->prev = entry;
-    entry->next = head;
-}
-
-struct stack_elem {
-    struct list_head head;
-    void *value;
-};
-
-struct stack {
-    struct list_head items;
-};
-
-static void stack_init(struct stack *s) {
-    list_init(&s->items);
-}
-
-static void stack_push(struct stack *s, void *value) {
-    struct stack_elem *elem = (struct stack_elem*) malloc(sizeof(*elem));
-    list_init(&elem->head);
-    elem->value = value;
-    list_insert_front(&s->items, &elem->head);
-}
-
-static int stack_empty(struct stack *s) {
-    return list_empty(&s->items);
-}
-
-static void* stack_pop(struct stack *s) {
-    assert(!stack_empty(s));
-
-    struct stack_elem *front = (struct stack_elem*) s->items.next;
-    list_del(&front->head);
-    void *ret = front->value;
-    free(front);
-    return ret;
-}
+#include "arena.h"
+#include "byte-order.h"
+#include "hash.h"
+#include "lexer.h"
 
 enum item_type {
     INTEGER_ITEM,
+    BIG_INTEGER_ITEM,
     STRING_ITEM,
     LIST_ITEM,
 };
 
+/*
+ * A parsed version is a flat array of tagged items; items[0] is the root list.
+ *
+ * The children of a list are the `count` items that immediately follow it.
+ * Parsing only ever descends into a new sublist (never back out), so a
+ * sublist is always the last child of its parent and its own children are
+ * laid out directly after its siblings. Removing an item therefore never
+ * requires fixing up any other list.
+ */
 struct item {
-    struct list_head head;
     enum item_type type;
+    union {
+        int64_t integer;
+        struct {
+            uint32_t digits; /* Offset of the significant digits */
+            uint32_t size;   /* Always more than kMaxInlineDigits */
+        } big;
+        struct {
+            int rank;       /* kUnknownRank for qualifiers Maven does not know */
+            uint32_t name;  /* Offset of an unknown qualifier's name */
+        } qualifier;
+        uint32_t count;     /* Number of children of a list */
+    } u;
 };
 
-struct item_list {
-    struct item common;
-    struct list_head children;
+/*
+ * Single allocation: the header, `nitems` items and then `nstrings` bytes of
+ * NUL-terminated, lower-cased names of unknown qualifiers and the digits of
+ * big integers.
+ */
+struct comparable_version {
+    uint32_t nitems;
+    uint32_t nstrings;
+    struct item items[0];
 };
 
-struct item_integer {
-    struct item common;
-    int value;
+static size_t comparable_size(uint32_t nitems, uint32_t nstrings) {
+    return sizeof(struct comparable_version) + nitems * sizeof(struct item)
+        + nstrings;
+}
+
+static const char* strings_of(const struct comparable_version *comparable) {
+    return (const char*) (comparable->items + comparable->nitems);
+}
+
+/* Qualifier ranks, in Maven's order */
+enum {
+    kAlphaRank,
+    kBetaRank,
+    kMilestoneRank,
+    kRcRank,
+    kSnapshotRank,
+    kReleaseRank,
+    kServicePackRank,
+    kUnknownRank,
 };
 
-struct item_string {
-    struct item common;
-    char *value;
-    char *comparable_qualifier;
+struct qualifier {
+    const char *name;
+    size_t size;
+    int rank;
+    int before_digit; /* Only an alias when a digit follows ("a1" is alpha-1) */
 };
 
-struct comparable_version {
-    struct item_list *items;
+#define QUALIFIER(name, rank, before_digit) \
+    { name, sizeof(name) - 1, rank, before_digit }
+
+/*
+ * Known qualifiers and their aliases, placed at their qualifier_hash. The
+ * hash has no collisions among them; anything else that lands on a slot is
+ * told apart by its name.
+ */
+static const struct qualifier qualifiers[32] = {
+    [2] = QUALIFIER("rc", kRcRank, 0),
+    [3] = QUALIFIER("snapshot", kSnapshotRank, 0),
+    [4] = QUALIFIER("milestone", kMilestoneRank, 0),
+    [8] = QUALIFIER("a", kAlphaRank, 1),
+    [11] = QUALIFIER("b", kBetaRank, 1),
+    [12] = QUALIFIER("m", kMilestoneRank, 1),
+    [17] = QUALIFIER("cr", kRcRank, 0),
+    [19] = QUALIFIER("ga", kReleaseRank, 0),
+    [23] = QUALIFIER("final", kReleaseRank, 0),
+    [24] = QUALIFIER("beta", kBetaRank, 0),
+    [28] = QUALIFIER("alpha", kAlphaRank, 0),
+    [29] = QUALIFIER("sp", kServicePackRank, 0),
 };
 
-static void free_item(struct item *item);
+/* Case-insensitive on letters; `size` must be nonzero */
+static unsigned qualifier_hash(const char *str, size_t size) {
+    return (size * 5 + ((unsigned char) str[0] | 0x20)
+        + (((unsigned char) str[size - 1] | 0x20) << 1)) & 31;
+}
 
-static void free_item_list(struct item_list *list) {
-    while (!list_empty(&list->children)) {
-        struct list_head *child = list->children.next;
-        list_del(child);
-        free_item((struct item*) child);
+/* Whether `str`, folded to lower case, is `name` */
+static int name_equals(const char *str, size_t size, const char *name,
+        size_t name_size) {
+    size_t i;
+    if (size != name_size) {
+        return 0;
     }
-    free(list);
+    for (i = 0; i < size; ++i) {
+        if (tolower((unsigned char) str[i]) != name[i]) {
+            return 0;
+        }
+    }
+    return 1;
 }
 
-static void free_item_string(struct item_string *string) {
-    free(string->value);
-    free(string->comparable_qualifier);
-    free(string);
+/*
+ * Resolves the aliases ("a1" is "alpha-1", "ga" is the release, ...).
+ *
+ * @return the rank of the qualifier, or kUnknownRank
+ */
+static int qualifier_rank(const char *str, size_t size,
+        int followed_by_digit) {
+    if (size == 0) {
+        return kReleaseRank;
+    }
+    const struct qualifier *q = &qualifiers[qualifier_hash(str, size)];
+    if (q->name && (followed_by_digit || !q->before_digit)
+            && name_equals(str, size, q->name, q->size)) {
+        return q->rank;
+    }
+    return kUnknownRank;
 }
 
-static void free_item(struct item *item) {
-    assert(list_empty(&item->head));
-
+static int is_null(const struct item *item) {
     switch (item->type) {
     case INTEGER_ITEM:
-        free((struct item_integer*) item);
-        break;
+        return item->u.integer == 0;
+    case BIG_INTEGER_ITEM:
+        return 0;
     case STRING_ITEM:
-        free_item_string((struct item_string*) item);
-        break;
+        return item->u.qualifier.rank == kReleaseRank;
     case LIST_ITEM:
-        /* I feel pretty okay about this recursion. */
-        free_item_list((struct item_list*) item);
-        break;
+        return item->u.count == 0;
     }
+    return 0;
 }
 
-struct qualifier {
-    const char *name;
-    int index;
+/*
+ * Scratch space for parsing. Items and qualifier strings are accumulated here
+ * and copied into an exactly-sized comparable_version once normalized.
+ */
+struct builder {
+    struct item *items;
+    uint32_t nitems;
+    char *strings;
+    uint32_t nstrings;
+    uint32_t list; /* Index of the list currently being appended to */
+    size_t scratch_size; /* Size of heap-allocated scratch space, if any */
 };
 
-struct qualifier qualifiers[] = {
-    {"", 5},
-    {"alpha", 0},
-    {"beta", 1},
-    {"milestone", 2},
-    {"rc", 3},
-    {"snapshot", 4},
-    {"sp", 6}
-};
+/* Versions up to 127 characters are parsed without touching the heap */
+#define kScratchItems 256
+#define kScratchStrings 256
 
-const char kReleaseVersionIndexString[] = "5";
+static struct item* add_item(struct builder *b, enum item_type type) {
+    struct item *item = &b->items[b->nitems++];
+    item->type = type;
+    ++b->items[b->list].u.count;
+    return item;
+}
 
-static int qualifier_index(const char *name) {
-    const int k_max = 6;
+static void add_list(struct builder *b) {
+    add_item(b, LIST_ITEM)->u.count = 0;
+    b->list = b->nitems - 1;
+}
 
-    int max = 6;
-    int min = 0;
+static void add_integer(struct builder *b, int64_t value) {
+    add_item(b, INTEGER_ITEM)->u.integer = value;
+}
 
-    while (min <= max) {
-        int cur = min + (max - min) / 2;
-        int cmp = strcmp(name, qualifiers[cur].name);
-        if (cmp == 0) {
-            return qualifiers[cur].index;
-        }
+/*
+ * Integers with up to this many significant digits are stored inline; longer
+ * ones (Maven's BigIntegerItem) keep their digits in the string pool.
+ */
+#define kMaxInlineDigits 18
 
-        if (cmp < 0) {
-            max = cur - 1;
-        } else {
-            min = cur + 1;
-        }
+static int64_t parse_integer(const char *buf, size_t size) {
+    int64_t value = 0;
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        value = value * 10 + (buf[i] - '0');
     }
-
-    return -1;
+    return value;
 }
 
-static int is_null(struct item *item) {
-    switch (item->type) {
-    case INTEGER_ITEM:
-        return ((struct item_integer*) item)->value == 0;
-    case STRING_ITEM:
-        return 0 == strcmp(((struct item_string*) item)->comparable_qualifier,
-            kReleaseVersionIndexString);
-    case LIST_ITEM:
-        return list_empty(&((struct item_list*) item)->children);
+/* Skips the leading zeros of the `*size` digits at `buf` */
+static const char* significant_digits(const char *buf, size_t *size) {
+    while (*size > 0 && *buf == '0') {
+        ++buf;
+        --*size;
     }
+    return buf;
 }
 
-static struct item* item_list_prev(struct item_list *list, struct item *cur) {
-    if (list_empty(&list->children)) {
-        return NULL;
+static void add_number(struct builder *b, const char *buf, size_t size) {
+    buf = significant_digits(buf, &size);
+    if (size <= kMaxInlineDigits) {
+        add_integer(b, parse_integer(buf, size));
+        return;
     }
 
-    if (!cur) {
-        return (struct item*) list->children.prev;
+    struct item *item = add_item(b, BIG_INTEGER_ITEM);
+    item->u.big.digits = b->nstrings;
+    item->u.big.size = size;
+    memcpy(b->strings + b->nstrings, buf, size);
+    b->nstrings += size;
+}
+
+static void add_string(struct builder *b, const char *str, size_t size,
+        int followed_by_digit) {
+    struct item *item = add_item(b, STRING_ITEM);
+    item->u.qualifier.rank = qualifier_rank(str, size, followed_by_digit);
+    if (item->u.qualifier.rank == kUnknownRank) {
+        item->u.qualifier.name = b->nstrings;
+        mv_internal_lower(b->strings + b->nstrings, str, size);
+        b->strings[b->nstrings + size] = '\0';
+        b->nstrings += size + 1;
     }
+}
 
-    if (cur->head.prev == &list->children) {
-        return NULL;
+static void parse_item(struct builder *b, int is_digit, const char *buf,
+        size_t size) {
+    if (is_digit) {
+        add_number(b, buf, size);
+    } else {
+        add_string(b, buf, size, /*followed by digit=*/ 0);
     }
+}
 
-    return (struct item*) cur->head.prev;
+static void remove_item(struct builder *b, uint32_t index) {
+    memmove(&b->items[index], &b->items[index + 1],
+        (b->nitems - index - 1) * sizeof(struct item));
+    --b->nitems;
 }
 
-static void print_item(struct item *item, int first);
-static void normalize_list_item(struct item_list *list) {
-    struct item *child = item_list_prev(list, NULL);
-    while (child) {
+static void normalize_list_item(struct builder *b, uint32_t list) {
+    uint32_t i;
+    for (i = b->items[list].u.count; i > 0; --i) {
+        struct item *child = &b->items[list + i];
         if (is_null(child)) {
-            list_del(&child->head);
-            free_item(child);
-            child = item_list_prev(list, NULL);
+            remove_item(b, list + i);
+            --b->items[list].u.count;
         } else if (child->type != LIST_ITEM) {
             break;
-        } else {
-            child = item_list_prev(list, child);
         }
     }
 }
 
-static void init_item(struct item *item, enum item_type type) {
-    list_init(&item->head);
-    item->type = type;
-}
-
-static void item_list_add(struct item_list *list, struct item *item) {
-    list_insert_back(&list->children, &item->head);
-}
-
-static struct item_list* mk_item_list() {
-    struct item_list *ret = (struct item_list*) malloc(sizeof(*ret));
-    init_item(&ret->common, LIST_ITEM);
-    list_init(&ret->children);
-    return ret;
-}
-
-static struct item_integer* mk_item_integer(int value) {
-    struct item_integer *ret = (struct item_integer*) malloc(sizeof(*ret));
-    init_item(&ret->common, INTEGER_ITEM);
-    ret->value = value;
-    return ret;
-}
-
-static char* mk_comparable_qualifier(const char *str) {
-    int idx = qualifier_index(str);
-    if (idx == -1) {
-        size_t size = strlen(str) + 3;
-        char *ret = (char *) malloc(size);
-        snprintf(ret, size, "%d-%s", 7, str);
-        return ret;
-    }
-    char *ret = (char *) malloc(2);
-    snprintf(ret, 2, "%d", idx);
-    return ret;
-}
-
-static struct item_string* mk_item_string(const char *str, size_t size,
-        int followed_by_digit) {
-    struct item_string *ret = (struct item_string*) malloc(sizeof(*ret));
-    init_item(&ret->common, STRING_ITEM);
-
-    if (followed_by_digit && size == 1) {
-        switch (*str) {
-        case 'a':
-            ret->value = strdup("alpha");
-            break;
-        case 'b':
-            ret->value = strdup("beta");
-            break;
-        case 'm':
-            ret->value = strdup("milestone");
-            break;
-        default:
-            ret->value = strndup(str, size);
-            break;
+static void normalize(struct builder *b) {
+    /* Sublists follow their parents, so this visits the innermost first */
+    uint32_t i;
+    for (i = b->nitems; i > 0; --i) {
+        if (b->items[i - 1].type == LIST_ITEM) {
+            normalize_list_item(b, i - 1);
         }
-    } else if (!strncmp(str, "ga", size)) {
-        ret->value = strdup("");
-    } else if (!strncmp(str, "final", size)) {
-        ret->value = strdup("");
-    } else if (!strncmp(str, "cr", size)) {
-        ret->value = strdup("rc");
-    } else {
-        ret->value = strndup(str, size);
     }
-    ret->comparable_qualifier = mk_comparable_qualifier(ret->value);
-    return ret;
 }
 
-static struct item* parse_item(int is_digit, const char *buf, size_t size) {
-    if (is_digit) {
-        return (struct item*) mk_item_integer(strtol(buf, NULL, 10));
-    }
-    return (struct item*) mk_item_string(buf, size, /*followed by digit=*/ 0);
+static int sign(int value) {
+    return value < 0 ? -1 : value > 0;
 }
 
 static int compare_int(int a, int b) {
@@ -331,65 +313,95 @@ static int compare_int(int a, int b) {
     return 1;
 }
 
-static int compare_item_integer(struct item_integer *a, struct item *b) {
+static int compare_int64(int64_t a, int64_t b) {
+    return a < b ? -1 : a > b;
+}
+
+/* Compares runs of significant digits, as Maven's BigIntegerItem does */
+static int compare_digits(const char *a, size_t asize, const char *b,
+        size_t bsize) {
+    if (asize != bsize) {
+        return asize < bsize ? -1 : 1;
+    }
+    return sign(memcmp(a, b, asize));
+}
+
+static int compare_item(const struct item *a, const char *as,
+    const struct item *b, const char *bs);
+
+static int compare_item_integer(const struct item *a, const struct item *b) {
     if (!b) {
-        return a->value == 0 ? 0 : 1;
+        return a->u.integer == 0 ? 0 : 1;
     }
 
     switch (b->type) {
     case INTEGER_ITEM:
-        return compare_int(a->value, ((struct item_integer*) b)->value);
+        return compare_int64(a->u.integer, b->u.integer);
+    case BIG_INTEGER_ITEM:
+        return -1;
     case STRING_ITEM:
         return 1; /* Numeric components are always newer than qualifiers */
     case LIST_ITEM:
         return 1; /* Numeric components are always newer than sublists. */
     }
+    return 0;
 }
 
-static int compare_item_string(struct item_string *a, struct item *b) {
+static int compare_item_big_integer(const struct item *a, const char *as,
+        const struct item *b, const char *bs) {
     if (!b) {
-        return strcmp(a->comparable_qualifier, kReleaseVersionIndexString);
+        return 1;
     }
 
     switch (b->type) {
     case INTEGER_ITEM:
-        return -1;
+        return 1;
+    case BIG_INTEGER_ITEM:
+        return compare_digits(as + a->u.big.digits, a->u.big.size,
+            bs + b->u.big.digits, b->u.big.size);
     case STRING_ITEM:
-        return strcmp(a->comparable_qualifier,
-            ((struct item_string*) b)->comparable_qualifier);
+        return 1;
     case LIST_ITEM:
-        return -1;
+        return 1;
     }
+    return 0;
 }
 
-static int compare_item(struct item*, struct item*);
-
-static struct item* item_list_next(struct item_list *list, struct item *cur) {
-    if (list_empty(&list->children)) {
-        return NULL;
-    }
-
-    if (!cur) {
-        return (struct item*) list->children.next;
+static int compare_item_string(const struct item *a, const char *as,
+        const struct item *b, const char *bs) {
+    if (!b) {
+        return compare_int(a->u.qualifier.rank, kReleaseRank);
     }
 
-    if (cur->head.next == &list->children) {
-        return NULL;
+    switch (b->type) {
+    case INTEGER_ITEM:
+    case BIG_INTEGER_ITEM:
+        return -1;
+    case STRING_ITEM:
+        if (a->u.qualifier.rank != b->u.qualifier.rank
+                || a->u.qualifier.rank != kUnknownRank) {
+            return compare_int(a->u.qualifier.rank, b->u.qualifier.rank);
+        }
+        return sign(strcmp(as + a->u.qualifier.name,
+            bs + b->u.qualifier.name));
+    case LIST_ITEM:
+        return -1;
     }
-
-    return (struct item*) cur->head.next;
+    return 0;
 }
 
-static int compare_item_list(struct item_list *a, struct item *b) {
+static int compare_item_list(const struct item *a, const char *as,
+        const struct item *b, const char *bs) {
     if (!b) {
-        if (list_empty(&a->children)) {
+        if (a->u.count == 0) {
             return 0;
         }
-        return compare_item((struct item*)a->children.next, NULL);
+        return compare_item(a + 1, as, NULL, NULL);
     }
 
     switch (b->type) {
     case INTEGER_ITEM:
+    case BIG_INTEGER_ITEM:
         return -1;
     case STRING_ITEM:
         return 1;
@@ -397,22 +409,22 @@ static int compare_item_list(struct item_list *a, struct item *b) {
         break;
     }
 
-    /* compare items in lock step */
-    struct item_list *bl = (struct item_list*) b;
-    struct item *left = NULL;
-    struct item *right = NULL;
-
-    while (item_list_next(a, left) || item_list_next(bl, right)) {
-        left = item_list_next(a, left);
-        right = item_list_next(bl, right);
+    /*
+     * Compare items in lock step. Only the last child can be a list, so the
+     * i-th child is always at offset i + 1.
+     */
+    uint32_t i;
+    for (i = 0; i < a->u.count || i < b->u.count; ++i) {
+        const struct item *left = a + 1 + i;
+        const struct item *right = b + 1 + i;
 
         int result;
-        if (!left && !right) {
-            result = 0;
-        } else if (!left) {
-            result = -1 * compare_item(right, NULL);
+        if (i >= a->u.count) {
+            result = -1 * compare_item(right, bs, NULL, NULL);
+        } else if (i >= b->u.count) {
+            result = compare_item(left, as, NULL, NULL);
         } else {
-            result = compare_item(left, right);
+            result = compare_item(left, as, right, bs);
         }
 
         if (result != 0) {
@@ -423,109 +435,991 @@ static int compare_item_list(struct item_list *a, struct item *b) {
     return 0;
 }
 
-static int compare_item(struct item *a, struct item *b) {
+static int compare_item(const struct item *a, const char *as,
+        const struct item *b, const char *bs) {
     switch (a->type) {
     case INTEGER_ITEM:
-        return compare_item_integer((struct item_integer*) a, b);
+        return compare_item_integer(a, b);
+    case BIG_INTEGER_ITEM:
+        return compare_item_big_integer(a, as, b, bs);
     case STRING_ITEM:
-        return compare_item_string((struct item_string*) a, b);
+        return compare_item_string(a, as, b, bs);
     case LIST_ITEM:
-        return compare_item_list((struct item_list*) a, b);
+        return compare_item_list(a, as, b, bs);
     }
+    return 0;
 }
 
-struct comparable_version* mv_internal_parse_comparable(const char *orig) {
-    struct stack lists; /* For post-parse normalization */
-    stack_init(&lists);
+static void parse_items(struct builder *b, const char *version, size_t len) {
+    b->items[0].type = LIST_ITEM;
+    b->items[0].u.count = 0;
+    b->nitems = 1;
+    b->nstrings = 0;
+    b->list = 0;
+
+    struct scanner scanner;
+    mv_internal_scanner_init(&scanner, version, len);
+
+    /* Items never mix digits and other characters */
+    size_t start_index = 0;
+    size_t i;
+    while ((i = mv_internal_next_boundary(&scanner)) < len) {
+        char cur = version[i];
+        int is_digit = isdigit((unsigned char) version[start_index]);
+        if (cur == '.' || cur == '-') {
+            if (i == start_index) {
+                add_integer(b, 0);
+            } else {
+                parse_item(b, is_digit, version + start_index,
+                    i - start_index);
+            }
+            start_index = i + 1;
+            if (cur == '-') {
+                add_list(b);
+            }
+        } else if (is_digit) {
+            add_number(b, version + start_index, i - start_index);
+            start_index = i;
+            add_list(b);
+        } else {
+            add_string(b, version + start_index, i - start_index,
+                /*followed by digit=*/ 1);
+            start_index = i;
+            add_list(b);
+        }
+    }
+
+    if (start_index < len) {
+        parse_item(b, isdigit((unsigned char) version[start_index]),
+            version + start_index, len - start_index);
+    }
 
-    char *version = strdup(orig);
-    size_t len = strlen(version);
-    int i;
-    for (i = 0; i < len; ++i) {
-        version[i] = tolower(version[i]);
+    normalize(b);
+}
+
+/*
+ * Parses `version` into `b`, using `scratch_items` and `scratch_strings` when
+ * they are large enough. Callers release the builder with `release_builder`.
+ */
+static void build(struct builder *b, const char *version, size_t len,
+        struct item *scratch_items, char *scratch_strings,
+        const struct mv_allocator *allocator) {
+    /*
+     * Every character contributes at most two items (a value and a sublist)
+     * and at most two bytes of qualifier name (itself and a terminator).
+     */
+    size_t max_items = 2 * len + 1;
+    size_t max_strings = 2 * len + 1;
+
+    b->items = scratch_items;
+    b->strings = scratch_strings;
+    b->scratch_size = 0;
+    if (max_items > kScratchItems || max_strings > kScratchStrings) {
+        b->scratch_size = max_items * sizeof(struct item) + max_strings;
+        b->items = (struct item*) mv_internal_alloc(allocator,
+            b->scratch_size);
+        if (!b->items) {
+            b->nitems = 0;
+            return;
+        }
+        b->strings = (char*) (b->items + max_items);
     }
 
-    struct comparable_version *comparable =
-        (struct comparable_version*) malloc(sizeof(*comparable));
+    parse_items(b, version, len);
+}
 
-    comparable->items = mk_item_list();
-    struct item_list *list = comparable->items;
-    stack_push(&lists, list);
+static void release_builder(struct builder *b,
+        const struct mv_allocator *allocator) {
+    if (b->scratch_size) {
+        mv_internal_free(allocator, b->items, b->scratch_size);
+    }
+}
 
-    int is_digit = 0;
-    int start_index = 0;
-    const char *cur = version;
-    for (i = 0; *cur != '\0'; ++i, ++cur) {
-        if (*cur == '.') {
-            if (i == start_index) {
-                item_list_add(list, (struct item*) mk_item_integer(0));
-            } else {
-                item_list_add(list, parse_item(is_digit, version + start_index,
-                    i - start_index));
+struct comparable_version* mv_internal_parse_comparable(const char *version,
+        size_t len, const struct mv_allocator *allocator) {
+    struct item scratch_items[kScratchItems];
+    char scratch_strings[kScratchStrings];
+    struct builder b;
+    build(&b, version, len, scratch_items, scratch_strings, allocator);
+    if (!b.nitems) {
+        return NULL;
+    }
+
+    struct comparable_version *comparable = (struct comparable_version*)
+        mv_internal_alloc(allocator, comparable_size(b.nitems, b.nstrings));
+    if (comparable) {
+        comparable->nitems = b.nitems;
+        comparable->nstrings = b.nstrings;
+        memcpy(comparable->items, b.items, b.nitems * sizeof(struct item));
+        memcpy((char*) strings_of(comparable), b.strings, b.nstrings);
+    }
+
+    release_builder(&b, allocator);
+
+    return comparable;
+}
+
+void mv_internal_free_comparable(struct comparable_version* comparable,
+        const struct mv_allocator *allocator) {
+    mv_internal_free(allocator, comparable,
+        comparable_size(comparable->nitems, comparable->nstrings));
+}
+
+int mv_internal_compare(const struct comparable_version *a,
+        const struct comparable_version *b) {
+    return compare_item_list(a->items, strings_of(a), b->items,
+        strings_of(b));
+}
+
+/*
+ * Streaming comparison.
+ *
+ * A lexer replays the token stream that parse_items consumes, and a cursor
+ * applies normalization to it on the fly. Because a sublist is always the
+ * last item of its parent, comparing two versions in lock step never returns
+ * to an outer list, and two cursors can be compared in a single pass without
+ * building either list.
+ */
+enum token_type {
+    END_TOKEN,
+    ITEM_TOKEN,
+    LIST_TOKEN, /* Start of a sublist */
+};
+
+struct token {
+    enum token_type type;
+    const char *str;
+    size_t size;
+    int is_digit;
+    int followed_by_digit;
+};
+
+struct lexer {
+    const char *version;
+    size_t len;
+    struct scanner scanner;
+    size_t start_index;
+    int pending_list;
+};
+
+static void lexer_init(struct lexer *lex, const char *version, size_t len) {
+    lex->version = version;
+    lex->len = len;
+    mv_internal_scanner_init(&lex->scanner, version, len);
+    lex->start_index = 0;
+    lex->pending_list = 0;
+}
+
+static void make_item_token(struct lexer *lex, struct token *tok, size_t end,
+        int followed_by_digit) {
+    tok->type = ITEM_TOKEN;
+    tok->str = lex->version + lex->start_index;
+    tok->size = end - lex->start_index;
+    tok->is_digit = tok->size == 0 || isdigit((unsigned char) *tok->str);
+    tok->followed_by_digit = followed_by_digit;
+}
+
+/* Mirrors the loop in parse_items */
+static void next_token(struct lexer *lex, struct token *tok) {
+    if (lex->pending_list) {
+        lex->pending_list = 0;
+        tok->type = LIST_TOKEN;
+        return;
+    }
+
+    size_t i = mv_internal_next_boundary(&lex->scanner);
+    if (i < lex->len) {
+        char cur = lex->version[i];
+        if (cur == '.' || cur == '-') {
+            make_item_token(lex, tok, i, 0);
+            lex->start_index = i + 1;
+            lex->pending_list = cur == '-';
+        } else {
+            make_item_token(lex, tok, i, isdigit((unsigned char) cur));
+            lex->start_index = i;
+            lex->pending_list = 1;
+        }
+        return;
+    }
+
+    if (lex->start_index < lex->len) {
+        make_item_token(lex, tok, lex->len, 0);
+        lex->start_index = lex->len;
+        return;
+    }
+
+    tok->type = END_TOKEN;
+}
+
+/* A scalar item, as produced by a cursor */
+struct scalar {
+    int is_integer;
+    int64_t value;    /* Integer value (-1 if big), or qualifier rank */
+    const char *str;  /* Unknown qualifier, or big integer digits */
+    size_t size;
+};
+
+static void make_scalar(const struct token *tok, struct scalar *scalar) {
+    scalar->is_integer = tok->is_digit;
+    if (tok->is_digit) {
+        scalar->size = tok->size;
+        scalar->str = significant_digits(tok->str, &scalar->size);
+        scalar->value = scalar->size <= kMaxInlineDigits
+            ? parse_integer(scalar->str, scalar->size) : -1;
+    } else {
+        scalar->value = qualifier_rank(tok->str, tok->size,
+            tok->followed_by_digit);
+        scalar->str = tok->str;
+        scalar->size = tok->size;
+    }
+}
+
+/* Like compare_item(scalar, NULL) */
+static int compare_scalar_null(const struct scalar *a) {
+    if (a->is_integer) {
+        return a->value == 0 ? 0 : 1;
+    }
+    return compare_int64(a->value, kReleaseRank);
+}
+
+static int scalar_is_null(const struct scalar *a) {
+    return compare_scalar_null(a) == 0;
+}
+
+static int compare_scalar(const struct scalar *a, const struct scalar *b) {
+    if (a->is_integer != b->is_integer) {
+        return a->is_integer ? 1 : -1;
+    }
+    if (a->is_integer) {
+        if (a->value == -1 && b->value == -1) {
+            return compare_digits(a->str, a->size, b->str, b->size);
+        } else if (a->value == -1 || b->value == -1) {
+            return a->value == -1 ? 1 : -1;
+        }
+        return compare_int64(a->value, b->value);
+    }
+    if (a->value != b->value || a->value != kUnknownRank) {
+        return compare_int64(a->value, b->value);
+    }
+
+    size_t size = a->size < b->size ? a->size : b->size;
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        int c = compare_int(tolower((unsigned char) a->str[i]),
+            tolower((unsigned char) b->str[i]));
+        if (c != 0) {
+            return c;
+        }
+    }
+    return compare_int(a->size > size, b->size > size);
+}
+
+/*
+ * Yields the normalized items of a version. Normalization only drops nulls
+ * that have no non-null scalar after them in the same list, and sublists
+ * with no non-null scalar anywhere in them; both are decided by looking
+ * ahead, and the look-ahead results are cached so each cursor stays linear.
+ */
+struct cursor {
+    struct lexer lex;
+    int done;
+    const char *keep_before;   /* Nulls that start before here are kept */
+    const char *drop_before;   /* Nulls that start before here are dropped */
+    int scanned;
+    const char *last_nonnull;  /* Start of the last non-null scalar */
+};
+
+static void cursor_init(struct cursor *c, const char *version, size_t len) {
+    lexer_init(&c->lex, version, len);
+    c->done = 0;
+    c->keep_before = c->drop_before = version;
+    c->scanned = 0;
+    c->last_nonnull = NULL;
+}
+
+/* Whether the rest of the version holds a non-null scalar */
+static int cursor_has_nonnull(struct cursor *c) {
+    if (!c->scanned) {
+        struct lexer lex = c->lex;
+        struct token tok;
+        for (next_token(&lex, &tok); tok.type != END_TOKEN;
+                next_token(&lex, &tok)) {
+            struct scalar scalar;
+            if (tok.type == ITEM_TOKEN) {
+                make_scalar(&tok, &scalar);
+                if (!scalar_is_null(&scalar)) {
+                    c->last_nonnull = tok.str;
+                }
             }
-            start_index = i + 1;
-        } else if (*cur == '-') {
-            if (i == start_index) {
-                item_list_add(list, (struct item*) mk_item_integer(0));
-            } else {
-                item_list_add(list, parse_item(is_digit, version + start_index,
-                    i - start_index));
+        }
+        c->scanned = 1;
+    }
+    return c->last_nonnull
+        && c->last_nonnull >= c->lex.version + c->lex.start_index;
+}
+
+/* Whether the null at `tok` has a non-null scalar after it in its list */
+static int cursor_keeps_null(struct cursor *c, const struct token *null) {
+    if (null->str < c->keep_before) {
+        return 1;
+    }
+    if (null->str < c->drop_before) {
+        return 0;
+    }
+
+    struct lexer lex = c->lex;
+    struct token tok;
+    for (next_token(&lex, &tok); tok.type == ITEM_TOKEN;
+            next_token(&lex, &tok)) {
+        struct scalar scalar;
+        make_scalar(&tok, &scalar);
+        if (!scalar_is_null(&scalar)) {
+            c->keep_before = tok.str;
+            return 1;
+        }
+    }
+    c->drop_before = lex.version + lex.start_index;
+    return 0;
+}
+
+/* @return the next item's type; `scalar` is set for ITEM_TOKEN */
+static enum token_type cursor_next(struct cursor *c, struct scalar *scalar) {
+    while (!c->done) {
+        struct token tok;
+        next_token(&c->lex, &tok);
+
+        switch (tok.type) {
+        case END_TOKEN:
+            c->done = 1;
+            break;
+        case LIST_TOKEN:
+            if (cursor_has_nonnull(c)) {
+                return LIST_TOKEN;
             }
-            start_index = i + 1;
+            c->done = 1;
+            break;
+        case ITEM_TOKEN:
+            make_scalar(&tok, scalar);
+            if (!scalar_is_null(scalar) || cursor_keeps_null(c, &tok)) {
+                return ITEM_TOKEN;
+            }
+            break;
+        }
+    }
+    return END_TOKEN;
+}
+
+/* Like compare_item_list(sublist, NULL) for the sublist `c` just entered */
+static int compare_sublist_null(struct cursor *c) {
+    struct scalar scalar;
+    enum token_type type;
+    while ((type = cursor_next(c, &scalar)) == LIST_TOKEN) {
+        /* The first child is itself a list */
+    }
+    return type == ITEM_TOKEN ? compare_scalar_null(&scalar) : 0;
+}
 
-            struct item_list *newlist = mk_item_list();
-            item_list_add(list, (struct item*) newlist);
-            list = newlist;
-            stack_push(&lists, list);
-        } else if (isdigit(*cur)) {
-            if (!is_digit && i > start_index) {
-                item_list_add(list, (struct item*) mk_item_string(
-                    version + start_index, i - start_index,
-                    /*followed by digit=*/ 1));
-                start_index = i;
-
-                struct item_list *newlist = mk_item_list();
-                item_list_add(list, (struct item*) newlist);
-                list = newlist;
-                stack_push(&lists, list);
+int mv_internal_compare_str(const char *a, size_t alen, const char *b,
+        size_t blen) {
+    struct cursor ca, cb;
+    cursor_init(&ca, a, alen);
+    cursor_init(&cb, b, blen);
+
+    for (;;) {
+        struct scalar sa, sb;
+        enum token_type ta = cursor_next(&ca, &sa);
+        enum token_type tb = cursor_next(&cb, &sb);
+
+        int result = 0;
+        if (ta == END_TOKEN && tb == END_TOKEN) {
+            return 0;
+        } else if (tb == END_TOKEN) {
+            if (ta == LIST_TOKEN) {
+                return compare_sublist_null(&ca);
+            }
+            result = compare_scalar_null(&sa);
+        } else if (ta == END_TOKEN) {
+            if (tb == LIST_TOKEN) {
+                return -1 * compare_sublist_null(&cb);
             }
-            is_digit = 1;
+            result = -1 * compare_scalar_null(&sb);
+        } else if (ta == LIST_TOKEN && tb == LIST_TOKEN) {
+            /* Both cursors are now inside their sublists */
+            continue;
+        } else if (ta == LIST_TOKEN) {
+            return sb.is_integer ? -1 : 1;
+        } else if (tb == LIST_TOKEN) {
+            return sa.is_integer ? 1 : -1;
         } else {
-            if (is_digit && i > start_index) {
-                item_list_add(list, parse_item(/*is_digit=*/ 1,
-                    version + start_index, i - start_index));
-                start_index = i;
-
-                struct item_list *newlist = mk_item_list();
-                item_list_add(list, (struct item*) newlist);
-                list = newlist;
-                stack_push(&lists, list);
+            result = compare_scalar(&sa, &sb);
+        }
+
+        if (result != 0) {
+            return result;
+        }
+    }
+}
+
+/*
+ * Sort keys.
+ *
+ * Each item is written as a tag byte plus payload, and every list (including
+ * the root) is closed by kKeyEnd. Comparing two keys with memcmp(3) then
+ * walks the items in the same lock step as compare_item_list. Where one list
+ * has run out, its kKeyEnd meets an item of the other list, so every tag must
+ * order against kKeyEnd the way that item compares with a missing one:
+ * negative items (alpha ... snapshot, lists that start with one) sort below
+ * it and positive items above it. Null items that survive normalization (the
+ * 0 in "1.0.1") compare equal to a missing item and defer to their next
+ * non-null sibling, so they are tagged with that sibling's sign.
+ *
+ * Within each group the tags follow the type order string < list < integer.
+ * c-maven-utils/cpp/static-version.h encodes the same keys at compile time.
+ */
+enum {
+    kKeyQualifier = 0x10,       /* + rank, for ranks below the release */
+    kKeyReleaseBeforeNegative = 0x15,
+    kKeyListNegative = 0x18,
+    kKeyZeroBeforeNegative = 0x19,
+    kKeyEnd = 0x20,
+    kKeyReleaseBeforePositive = 0x25,
+    kKeyServicePack = 0x26,
+    kKeyUnknownQualifier = 0x27, /* + NUL-terminated name */
+    kKeyListPositive = 0x28,
+    kKeyZeroBeforePositive = 0x29,
+    kKeyInteger = 0x2a,         /* + 8 bytes, big endian */
+    kKeyBigInteger = 0x2b,      /* + 4 byte big endian length, + digits */
+};
+
+/* Writes a key to `buf`, or hashes it (mv_hash) if `hashing` is set */
+struct key_writer {
+    unsigned char *buf;
+    size_t size;
+    size_t len;
+    int hashing;
+    uint64_t hash;
+    uint64_t word; /* Bytes not yet mixed into `hash` */
+};
+
+static void key_put(struct key_writer *w, unsigned char c) {
+    if (w->hashing) {
+        w->word |= (uint64_t) c << (8 * (w->len & 7));
+        if ((w->len & 7) == 7) {
+            w->hash = mv_internal_hash_mix(w->hash, w->word);
+            w->word = 0;
+        }
+    } else if (w->len < w->size) {
+        w->buf[w->len] = c;
+    }
+    ++w->len;
+}
+
+/*
+ * @return how `item` compares with a missing item. Unlike compare_item_list,
+ * a list takes the sign of its first non-null child rather than of its first
+ * child, which is what makes the key order total.
+ */
+static int item_sign(const struct item *item, const char *strings) {
+    switch (item->type) {
+    case INTEGER_ITEM:
+        return item->u.integer == 0 ? 0 : 1;
+    case BIG_INTEGER_ITEM:
+        return 1;
+    case STRING_ITEM:
+        return compare_int(item->u.qualifier.rank, kReleaseRank);
+    case LIST_ITEM: {
+        uint32_t i;
+        for (i = 0; i < item->u.count; ++i) {
+            int sign = item_sign(item + 1 + i, strings);
+            if (sign != 0) {
+                return sign;
             }
-            is_digit = 0;
         }
+        return 0;
+    }
     }
+    return 0;
+}
 
-    if (start_index < len) {
-        item_list_add(list, parse_item(is_digit, version + start_index,
-            len - start_index));
+static void key_put_string(struct key_writer *w, const struct item *item,
+        const char *strings, int sign) {
+    const char *name;
+    switch (item->u.qualifier.rank) {
+    case kReleaseRank:
+        key_put(w, sign < 0 ? kKeyReleaseBeforeNegative :
+            kKeyReleaseBeforePositive);
+        break;
+    case kServicePackRank:
+        key_put(w, kKeyServicePack);
+        break;
+    case kUnknownRank:
+        key_put(w, kKeyUnknownQualifier);
+        for (name = strings + item->u.qualifier.name; *name; ++name) {
+            key_put(w, *name);
+        }
+        key_put(w, '\0');
+        break;
+    default:
+        key_put(w, kKeyQualifier + item->u.qualifier.rank);
+        break;
+    }
+}
+
+static void key_put_integer(struct key_writer *w, int64_t value, int sign) {
+    if (value == 0) {
+        key_put(w, sign < 0 ? kKeyZeroBeforeNegative : kKeyZeroBeforePositive);
+        return;
     }
 
-    while (!stack_empty(&lists)) {
-        list = (struct item_list*) stack_pop(&lists);
-        normalize_list_item(list);
+    int shift;
+    key_put(w, kKeyInteger);
+    for (shift = 56; shift >= 0; shift -= 8) {
+        key_put(w, (uint64_t) value >> shift);
     }
+}
 
-    free(version);
+/* Every big integer is larger than every inline one */
+static void key_put_big_integer(struct key_writer *w, const char *digits,
+        uint32_t size) {
+    uint32_t i;
+    key_put(w, kKeyBigInteger);
+    key_put(w, size >> 24);
+    key_put(w, size >> 16);
+    key_put(w, size >> 8);
+    key_put(w, size);
+    for (i = 0; i < size; ++i) {
+        key_put(w, digits[i]);
+    }
+}
 
-    return comparable;
+static void sort_key(const struct item *list, const char *strings,
+        struct key_writer *w) {
+    uint32_t depth = 0;
+
+    /* Only the last child can be a list, so descend iteratively */
+    while (list) {
+        const struct item *sublist = NULL;
+        uint32_t next = 0; /* Index of the next non-null child */
+        int next_sign = 1;
+        uint32_t i;
+
+        for (i = 0; i < list->u.count; ++i) {
+            const struct item *child = list + 1 + i;
+            int sign = item_sign(child, strings);
+
+            if (sign == 0) {
+                if (next <= i) {
+                    for (next = i + 1; next < list->u.count; ++next) {
+                        next_sign = item_sign(list + 1 + next, strings);
+                        if (next_sign != 0) {
+                            break;
+                        }
+                    }
+                }
+                sign = next_sign;
+            }
+
+            switch (child->type) {
+            case INTEGER_ITEM:
+                key_put_integer(w, child->u.integer, sign);
+                break;
+            case BIG_INTEGER_ITEM:
+                key_put_big_integer(w, strings + child->u.big.digits,
+                    child->u.big.size);
+                break;
+            case STRING_ITEM:
+                key_put_string(w, child, strings, sign);
+                break;
+            case LIST_ITEM:
+                key_put(w, sign < 0 ? kKeyListNegative : kKeyListPositive);
+                sublist = child;
+                break;
+            }
+        }
+
+        ++depth;
+        list = sublist;
+    }
+
+    while (depth--) {
+        key_put(w, kKeyEnd);
+    }
+}
+
+static size_t write_key(const struct item *list, const char *strings,
+        unsigned char *buf, size_t size) {
+    struct key_writer w = { buf, size, 0, 0, 0, 0 };
+    sort_key(list, strings, &w);
+    return w.len;
+}
+
+static uint64_t hash_key(const struct item *list, const char *strings) {
+    struct key_writer w = { NULL, 0, 0, 1, 0, 0 };
+    sort_key(list, strings, &w);
+    return mv_internal_hash_finish(w.hash, w.word, w.len);
+}
+
+/*
+ * Canonical form: Maven's ComparableVersion.getCanonical, the normalized items
+ * with aliases resolved, joined by '.' (or '-' before a sublist).
+ */
+
+/* Indexed by rank, up to the service pack */
+static const char *canonical_names[] = {
+    "alpha", "beta", "milestone", "rc", "snapshot", "", "sp",
+};
+
+static void canonical_put_string(struct key_writer *w, const char *str) {
+    for (; *str; ++str) {
+        key_put(w, *str);
+    }
 }
 
-void mv_internal_free_comparable(struct comparable_version* comparable) {
-    free_item_list(comparable->items);
-    free(comparable);
+static void canonical_put_integer(struct key_writer *w, int64_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) {
+        key_put(w, digits[--n]);
+    }
 }
 
-int mv_internal_compare(struct comparable_version *a,
-        struct comparable_version *b) {
-    return compare_item_list(a->items, (struct item*) b->items);
+static size_t canonical(const struct item *list, const char *strings,
+        char *buf, size_t size) {
+    struct key_writer w = { (unsigned char*) buf, size, 0, 0, 0, 0 };
+
+    while (list) {
+        const struct item *sublist = NULL;
+        size_t start = w.len; /* Maven joins each list in its own buffer */
+        uint32_t i;
+
+        for (i = 0; i < list->u.count; ++i) {
+            const struct item *child = list + 1 + i;
+            if (w.len > start) {
+                key_put(&w, child->type == LIST_ITEM ? '-' : '.');
+            }
+
+            switch (child->type) {
+            case INTEGER_ITEM:
+                canonical_put_integer(&w, child->u.integer);
+                break;
+            case BIG_INTEGER_ITEM: {
+                uint32_t j;
+                for (j = 0; j < child->u.big.size; ++j) {
+                    key_put(&w, strings[child->u.big.digits + j]);
+                }
+                break;
+            }
+            case STRING_ITEM:
+                canonical_put_string(&w,
+                    child->u.qualifier.rank == kUnknownRank
+                        ? strings + child->u.qualifier.name
+                        : canonical_names[child->u.qualifier.rank]);
+                break;
+            case LIST_ITEM:
+                sublist = child;
+                break;
+            }
+        }
+
+        list = sublist;
+    }
+
+    /* NUL-terminate, truncating if need be */
+    if (size > 0) {
+        buf[w.len < size ? w.len : size - 1] = '\0';
+    }
+    return w.len;
+}
+
+/* Whether every qualifier is a release alias ("ga", "final", ...) */
+static int is_release(const struct item *items, size_t nitems) {
+    size_t i;
+    for (i = 0; i < nitems; ++i) {
+        if (items[i].type == STRING_ITEM
+                && items[i].u.qualifier.rank != kReleaseRank) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int mv_internal_is_release(const struct comparable_version *comparable) {
+    return is_release(comparable->items, comparable->nitems);
+}
+
+int mv_internal_is_release_str(const char *version, size_t len) {
+    struct item scratch_items[kScratchItems];
+    char scratch_strings[kScratchStrings];
+    struct builder b;
+    build(&b, version, len, scratch_items, scratch_strings,
+        &mv_internal_allocator);
+    if (!b.nitems) {
+        return 0;
+    }
+
+    int ret = is_release(b.items, b.nitems);
+
+    release_builder(&b, &mv_internal_allocator);
+
+    return ret;
+}
+
+size_t mv_internal_sort_key(const struct comparable_version *comparable,
+        unsigned char *buf, size_t size) {
+    return write_key(comparable->items, strings_of(comparable), buf, size);
+}
+
+size_t mv_internal_sort_key_str(const char *version, size_t len,
+        unsigned char *buf, size_t size) {
+    struct item scratch_items[kScratchItems];
+    char scratch_strings[kScratchStrings];
+    struct builder b;
+    build(&b, version, len, scratch_items, scratch_strings,
+        &mv_internal_allocator);
+    if (!b.nitems) {
+        return 0;
+    }
+
+    size_t ret = write_key(b.items, b.strings, buf, size);
+
+    release_builder(&b, &mv_internal_allocator);
+
+    return ret;
+}
+
+size_t mv_internal_canonical(const struct comparable_version *comparable,
+        char *buf, size_t size) {
+    return canonical(comparable->items, strings_of(comparable), buf, size);
+}
+
+size_t mv_internal_canonical_str(const char *version, size_t len, char *buf,
+        size_t size) {
+    struct item scratch_items[kScratchItems];
+    char scratch_strings[kScratchStrings];
+    struct builder b;
+    build(&b, version, len, scratch_items, scratch_strings,
+        &mv_internal_allocator);
+    if (!b.nitems) {
+        if (size > 0) {
+            buf[0] = '\0';
+        }
+        return 0;
+    }
+
+    size_t ret = canonical(b.items, b.strings, buf, size);
+
+    release_builder(&b, &mv_internal_allocator);
+
+    return ret;
+}
+
+uint64_t mv_internal_hash_version(
+        const struct comparable_version *comparable) {
+    return hash_key(comparable->items, strings_of(comparable));
+}
+
+uint64_t mv_internal_hash_version_str(const char *version, size_t len) {
+    struct item scratch_items[kScratchItems];
+    char scratch_strings[kScratchStrings];
+    struct builder b;
+    build(&b, version, len, scratch_items, scratch_strings,
+        &mv_internal_allocator);
+    if (!b.nitems) {
+        return 0;
+    }
+
+    uint64_t ret = hash_key(b.items, b.strings);
+
+    release_builder(&b, &mv_internal_allocator);
+
+    return ret;
+}
+
+/*
+ * Serialized images.
+ *
+ * An image is laid out like a comparable_version, in little endian: nitems
+ * and nstrings (u32 each), then 16 bytes per item (the u32 type, four bytes
+ * of padding and the u64 integer, or two u32 fields: big integer digits and
+ * size, qualifier rank and name, or list count and padding), then the
+ * strings. On little-endian hosts that is exactly the in-memory layout, so
+ * an aligned image can be compared in place.
+ */
+#define kImageHeaderSize 8
+#define kImageItemSize 16
+
+/* 18 nines: the largest integer stored inline */
+#define kMaxInlineInteger 999999999999999999LL
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+_Static_assert(sizeof(struct item) == kImageItemSize
+    && offsetof(struct item, u) == 8, "items must match their image");
+#endif
+
+size_t mv_internal_image_size(const struct comparable_version *comparable) {
+    return kImageHeaderSize + (size_t) comparable->nitems * kImageItemSize
+        + comparable->nstrings;
+}
+
+void mv_internal_write_image(const struct comparable_version *comparable,
+        unsigned char *buf) {
+    uint32_t i;
+    mv_internal_put_u32(buf, comparable->nitems);
+    mv_internal_put_u32(buf + 4, comparable->nstrings);
+    buf += kImageHeaderSize;
+    for (i = 0; i < comparable->nitems; ++i, buf += kImageItemSize) {
+        const struct item *item = &comparable->items[i];
+        memset(buf, 0, kImageItemSize);
+        mv_internal_put_u32(buf, item->type);
+        switch (item->type) {
+        case INTEGER_ITEM:
+            mv_internal_put_u64(buf + 8, (uint64_t) item->u.integer);
+            break;
+        case BIG_INTEGER_ITEM:
+            mv_internal_put_u32(buf + 8, item->u.big.digits);
+            mv_internal_put_u32(buf + 12, item->u.big.size);
+            break;
+        case STRING_ITEM:
+            mv_internal_put_u32(buf + 8, (uint32_t) item->u.qualifier.rank);
+            mv_internal_put_u32(buf + 12, item->u.qualifier.name);
+            break;
+        case LIST_ITEM:
+            mv_internal_put_u32(buf + 8, item->u.count);
+            break;
+        }
+    }
+    memcpy(buf, strings_of(comparable), comparable->nstrings);
+}
+
+/* Whether the image of an item holds a valid value */
+static int check_image_item(const unsigned char *item, const char *strings,
+        uint32_t nstrings) {
+    uint32_t i;
+    switch (mv_internal_get_u32(item)) {
+    case INTEGER_ITEM:
+        return mv_internal_get_u64(item + 8) <= (uint64_t) kMaxInlineInteger;
+    case BIG_INTEGER_ITEM: {
+        uint32_t digits = mv_internal_get_u32(item + 8);
+        uint32_t size = mv_internal_get_u32(item + 12);
+        if (size <= kMaxInlineDigits || digits > nstrings
+                || size > nstrings - digits || strings[digits] == '0') {
+            return 0;
+        }
+        for (i = 0; i < size; ++i) {
+            if (!isdigit((unsigned char) strings[digits + i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    case STRING_ITEM: {
+        uint32_t rank = mv_internal_get_u32(item + 8);
+        uint32_t name = mv_internal_get_u32(item + 12);
+        if (rank != kUnknownRank) {
+            return rank < kUnknownRank;
+        }
+        return name < nstrings
+            && memchr(strings + name, '\0', nstrings - name) != NULL;
+    }
+    case LIST_ITEM:
+        return 1;
+    }
+    return 0;
+}
+
+size_t mv_internal_check_image(const unsigned char *buf, size_t len) {
+    if (len < kImageHeaderSize) {
+        return 0;
+    }
+    uint32_t nitems = mv_internal_get_u32(buf);
+    uint32_t nstrings = mv_internal_get_u32(buf + 4);
+    if (nitems == 0 || nitems > (len - kImageHeaderSize) / kImageItemSize
+            || nstrings > len - kImageHeaderSize
+                - (size_t) nitems * kImageItemSize) {
+        return 0;
+    }
+
+    const unsigned char *items = buf + kImageHeaderSize;
+    const char *strings = (const char*) items + nitems * kImageItemSize;
+    if (mv_internal_get_u32(items) != LIST_ITEM) {
+        return 0;
+    }
+
+    /*
+     * The children of each list must follow it, with only the last one a
+     * sublist, and the tree must account for every item.
+     */
+    uint32_t list = 0;
+    for (;;) {
+        uint32_t count = mv_internal_get_u32(
+            items + list * kImageItemSize + 8);
+        uint32_t sublist = 0;
+        uint32_t i;
+        if (count > nitems - list - 1) {
+            return 0;
+        }
+        for (i = 1; i <= count; ++i) {
+            const unsigned char *child = items + (list + i) * kImageItemSize;
+            if (!check_image_item(child, strings, nstrings)) {
+                return 0;
+            }
+            if (mv_internal_get_u32(child) == LIST_ITEM) {
+                if (i != count) {
+                    return 0;
+                }
+                sublist = list + i;
+            }
+        }
+        if (!sublist) {
+            if (list + count + 1 != nitems) {
+                return 0;
+            }
+            break;
+        }
+        list = sublist;
+    }
+
+    return kImageHeaderSize + (size_t) nitems * kImageItemSize + nstrings;
+}
+
+struct comparable_version* mv_internal_read_image(const unsigned char *buf,
+        const struct mv_allocator *allocator) {
+    uint32_t nitems = mv_internal_get_u32(buf);
+    uint32_t nstrings = mv_internal_get_u32(buf + 4);
+    struct comparable_version *comparable = (struct comparable_version*)
+        mv_internal_alloc(allocator, comparable_size(nitems, nstrings));
+    if (!comparable) {
+        return NULL;
+    }
+    comparable->nitems = nitems;
+    comparable->nstrings = nstrings;
+
+    uint32_t i;
+    buf += kImageHeaderSize;
+    for (i = 0; i < nitems; ++i, buf += kImageItemSize) {
+        struct item *item = &comparable->items[i];
+        item->type = (enum item_type) mv_internal_get_u32(buf);
+        switch (item->type) {
+        case INTEGER_ITEM:
+            item->u.integer = (int64_t) mv_internal_get_u64(buf + 8);
+            break;
+        case BIG_INTEGER_ITEM:
+            item->u.big.digits = mv_internal_get_u32(buf + 8);
+            item->u.big.size = mv_internal_get_u32(buf + 12);
+            break;
+        case STRING_ITEM:
+            item->u.qualifier.rank = (int) mv_internal_get_u32(buf + 8);
+            item->u.qualifier.name = mv_internal_get_u32(buf + 12);
+            break;
+        case LIST_ITEM:
+            item->u.count = mv_internal_get_u32(buf + 8);
+            break;
+        }
+    }
+    memcpy((char*) strings_of(comparable), buf, nstrings);
+    return comparable;
 }
@@ -21,10 +21,47 @@
 #ifndef COMPARABLE_VERSION_H_
 #define COMPARABLE_VERSION_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 struct comparable_version;
-struct comparable_version* mv_internal_parse_comparable(const char *version);
-void mv_internal_free_comparable(struct comparable_version *comparable);
-int mv_internal_compare(struct comparable_version *a,
-    struct comparable_version *b);
+struct mv_allocator;
+
+struct comparable_version* mv_internal_parse_comparable(const char *version,
+    size_t len, const struct mv_allocator *allocator);
+void mv_internal_free_comparable(struct comparable_version *comparable,
+    const struct mv_allocator *allocator);
+int mv_internal_compare(const struct comparable_version *a,
+    const struct comparable_version *b);
+int mv_internal_compare_str(const char *a, size_t alen, const char *b,
+    size_t blen);
+int mv_internal_is_release(const struct comparable_version *comparable);
+int mv_internal_is_release_str(const char *version, size_t len);
+size_t mv_internal_sort_key(const struct comparable_version *comparable,
+    unsigned char *buf, size_t size);
+size_t mv_internal_sort_key_str(const char *version, size_t len,
+    unsigned char *buf, size_t size);
+size_t mv_internal_canonical(const struct comparable_version *comparable,
+    char *buf, size_t size);
+size_t mv_internal_canonical_str(const char *version, size_t len, char *buf,
+    size_t size);
+uint64_t mv_internal_hash_version(
+    const struct comparable_version *comparable);
+uint64_t mv_internal_hash_version_str(const char *version, size_t len);
+
+/*
+ * Serialized images of comparable versions, which on little-endian hosts can
+ * be cast to `struct comparable_version` where they are 8-byte aligned.
+ */
+size_t mv_internal_image_size(const struct comparable_version *comparable);
+void mv_internal_write_image(const struct comparable_version *comparable,
+    unsigned char *buf);
+
+/* @return the size of the valid image at `buf`, or 0 */
+size_t mv_internal_check_image(const unsigned char *buf, size_t len);
+
+/* Copies a valid image */
+struct comparable_version* mv_internal_read_image(const unsigned char *buf,
+    const struct mv_allocator *allocator);
 
 #endif /* COMPARABLE_VERSION_H_ */
@@ -0,0 +1,62 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * A word-at-a-time hash, since long qualifiers would dominate otherwise.
+ * Words are mixed in as they fill up and `mv_internal_hash_finish` spreads
+ * every input bit over the low bits too, which is where hash tables take
+ * their buckets from.
+ */
+
+static inline uint64_t mv_internal_hash_mix(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 29);
+}
+
+/* @param word the last, partial word of the input (zero padded) */
+static inline uint64_t mv_internal_hash_finish(uint64_t hash, uint64_t word,
+        size_t len) {
+    hash = mv_internal_hash_mix(hash, word) ^ len;
+    hash = (hash ^ (hash >> 32)) * 0xd6e8feb86659fd93ULL;
+    return hash ^ (hash >> 32);
+}
+
+static inline uint64_t mv_internal_hash(const void *buf, size_t len) {
+    const char *bytes = (const char*) buf;
+    uint64_t hash = 0;
+    uint64_t word;
+    size_t i;
+    for (i = 0; i + sizeof(word) <= len; i += sizeof(word)) {
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = mv_internal_hash_mix(hash, word);
+    }
+    word = 0;
+    memcpy(&word, bytes + i, len - i);
+    return mv_internal_hash_finish(hash, word, len);
+}
+
+#endif /* HASH_H_ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/latest.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "c-maven-utils/maven-version.h"
+#include "hash.h"
+#include "shared-version.h"
+
+/* Arena chunks of the artifact names */
+#define kNameChunkSize (64 * 1024)
+
+/* Keys up to this long are computed on the stack */
+#define kStackKeySize 256
+
+enum { kLatest, kRelease, kSnapshot, kKinds };
+
+/* The newest version of a kind: its key, then the string and a NUL */
+struct best {
+    unsigned char *buf;
+    uint32_t capacity;
+    uint32_t key_len;
+    uint32_t len;
+};
+
+struct entry {
+    uint64_t hash;
+    const char *name;
+    size_t len;
+    size_t count;
+    struct best best[kKinds];
+};
+
+struct maven_latest {
+    struct arena names;
+    struct entry *entries;  /* In the order they were added */
+    size_t n;
+    size_t capacity;
+    size_t *table;          /* Open addressing; entry index + 1, or 0 */
+    size_t table_size;      /* A power of two, at least twice `n` */
+};
+
+static int compare_bytes(const void *a, size_t alen, const void *b,
+        size_t blen) {
+    int cmp = memcmp(a, b, alen < blen ? alen : blen);
+    if (cmp) {
+        return cmp;
+    }
+    return alen < blen ? -1 : alen > blen;
+}
+
+struct maven_latest* mv_latest_create(void) {
+    struct maven_latest *l = (struct maven_latest*) mv_internal_alloc(
+        &mv_internal_allocator, sizeof(*l));
+    if (!l) {
+        return NULL;
+    }
+    memset(l, 0, sizeof(*l));
+    mv_internal_arena_init(&l->names, &mv_internal_allocator,
+        kNameChunkSize);
+    return l;
+}
+
+void mv_latest_free(struct maven_latest *l) {
+    size_t i;
+    int k;
+    for (i = 0; i < l->n; ++i) {
+        for (k = 0; k < kKinds; ++k) {
+            struct best *b = &l->entries[i].best[k];
+            if (b->buf) {
+                mv_internal_free(&mv_internal_allocator, b->buf,
+                    b->capacity);
+            }
+        }
+    }
+    if (l->entries) {
+        mv_internal_free(&mv_internal_allocator, l->entries,
+            l->capacity * sizeof(struct entry));
+    }
+    if (l->table) {
+        mv_internal_free(&mv_internal_allocator, l->table,
+            l->table_size * sizeof(size_t));
+    }
+    mv_internal_arena_release(&l->names);
+    mv_internal_free(&mv_internal_allocator, l, sizeof(*l));
+}
+
+static int grow_table(struct maven_latest *l) {
+    size_t size = l->table_size ? 2 * l->table_size : 1024;
+    size_t *table = (size_t*) mv_internal_alloc(&mv_internal_allocator,
+        size * sizeof(size_t));
+    if (!table) {
+        return 0;
+    }
+    memset(table, 0, size * sizeof(size_t));
+    size_t i;
+    for (i = 0; i < l->n; ++i) {
+        size_t slot = l->entries[i].hash & (size - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = i + 1;
+    }
+    if (l->table) {
+        mv_internal_free(&mv_internal_allocator, l->table,
+            l->table_size * sizeof(size_t));
+    }
+    l->table = table;
+    l->table_size = size;
+    return 1;
+}
+
+static int grow_entries(struct maven_latest *l) {
+    size_t capacity = l->capacity ? 2 * l->capacity : 256;
+    struct entry *entries = (struct entry*) mv_internal_alloc(
+        &mv_internal_allocator, capacity * sizeof(struct entry));
+    if (!entries) {
+        return 0;
+    }
+    if (l->entries) {
+        memcpy(entries, l->entries, l->n * sizeof(struct entry));
+        mv_internal_free(&mv_internal_allocator, l->entries,
+            l->capacity * sizeof(struct entry));
+    }
+    l->entries = entries;
+    l->capacity = capacity;
+    return 1;
+}
+
+/* @return the artifact's entry, added if it is new, or NULL */
+static struct entry* find(struct maven_latest *l, const char *name,
+        size_t len) {
+    if (2 * (l->n + 1) > l->table_size && !grow_table(l)) {
+        return NULL;
+    }
+    uint64_t hash = mv_internal_hash(name, len);
+    size_t mask = l->table_size - 1;
+    size_t slot = hash & mask;
+    for (; l->table[slot]; slot = (slot + 1) & mask) {
+        struct entry *e = &l->entries[l->table[slot] - 1];
+        if (e->hash == hash && e->len == len && !memcmp(e->name, name, len)) {
+            return e;
+        }
+    }
+
+    if (l->n == l->capacity && !grow_entries(l)) {
+        return NULL;
+    }
+    char *copy = (char*) mv_internal_arena_alloc(&l->names, len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+
+    struct entry *e = &l->entries[l->n];
+    memset(e, 0, sizeof(*e));
+    e->hash = hash;
+    e->name = copy;
+    e->len = len;
+    l->table[slot] = ++l->n;
+    return e;
+}
+
+/* Whether a version with `key` would replace `b` */
+static int newer(const struct best *b, const unsigned char *key,
+        size_t key_len) {
+    return !b->buf || compare_bytes(key, key_len, b->buf, b->key_len) > 0;
+}
+
+static int replace(struct best *b, const unsigned char *key, size_t key_len,
+        const char *version, size_t len) {
+    size_t size = key_len + len + 1;
+    if (size > b->capacity) {
+        unsigned char *buf = (unsigned char*) mv_internal_alloc(
+            &mv_internal_allocator, size);
+        if (!buf) {
+            return 0;
+        }
+        if (b->buf) {
+            mv_internal_free(&mv_internal_allocator, b->buf, b->capacity);
+        }
+        b->buf = buf;
+        b->capacity = (uint32_t) size;
+    }
+    memcpy(b->buf, key, key_len);
+    memcpy(b->buf + key_len, version, len);
+    b->buf[key_len + len] = '\0';
+    b->key_len = (uint32_t) key_len;
+    b->len = (uint32_t) len;
+    return 1;
+}
+
+int mv_latest_add(struct maven_latest *l, const char *artifact,
+        size_t artifact_len, const char *version, size_t len) {
+    if (len > UINT32_MAX) {
+        return 0;
+    }
+    struct entry *e = find(l, artifact, artifact_len);
+    if (!e) {
+        return 0;
+    }
+
+    unsigned char stack[kStackKeySize];
+    unsigned char *key = stack;
+    size_t key_len = mv_sort_key_n(version, len, stack, sizeof(stack));
+    if (!key_len || key_len > UINT32_MAX - len - 1) {
+        return 0;
+    }
+    if (key_len > sizeof(stack)) {
+        key = (unsigned char*) mv_internal_alloc(&mv_internal_allocator,
+            key_len);
+        if (!key) {
+            return 0;
+        }
+        mv_sort_key_n(version, len, key, key_len);
+    }
+
+    /* Kinds are only worked out for versions that would be kept */
+    int ok = 1;
+    if (newer(&e->best[kLatest], key, key_len)) {
+        ok = replace(&e->best[kLatest], key, key_len, version, len);
+    }
+    if (ok && newer(&e->best[kRelease], key, key_len)
+            && mv_internal_is_release_version(version, len)) {
+        ok = replace(&e->best[kRelease], key, key_len, version, len);
+    }
+    if (ok && newer(&e->best[kSnapshot], key, key_len)
+            && mv_internal_is_snapshot(version, len)) {
+        ok = replace(&e->best[kSnapshot], key, key_len, version, len);
+    }
+
+    if (key != stack) {
+        mv_internal_free(&mv_internal_allocator, key, key_len);
+    }
+    e->count += ok;
+    return ok;
+}
+
+int mv_latest_merge(struct maven_latest *into,
+        const struct maven_latest *from) {
+    size_t i;
+    int k;
+    for (i = 0; i < from->n; ++i) {
+        const struct entry *src = &from->entries[i];
+        struct entry *dst = find(into, src->name, src->len);
+        if (!dst) {
+            return 0;
+        }
+        dst->count += src->count;
+        for (k = 0; k < kKinds; ++k) {
+            const struct best *b = &src->best[k];
+            if (b->buf && newer(&dst->best[k], b->buf, b->key_len)
+                    && !replace(&dst->best[k], b->buf, b->key_len,
+                        (const char*) b->buf + b->key_len, b->len)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+size_t mv_latest_size(const struct maven_latest *l) {
+    return l->n;
+}
+
+static const char* best_version(const struct best *b, size_t *len) {
+    if (!b->buf) {
+        *len = 0;
+        return NULL;
+    }
+    *len = b->len;
+    return (const char*) b->buf + b->key_len;
+}
+
+int mv_latest_at(const struct maven_latest *l, size_t i,
+        struct mv_latest_entry *entry) {
+    if (i >= l->n) {
+        return 0;
+    }
+    const struct entry *e = &l->entries[i];
+    entry->artifact = e->name;
+    entry->artifact_len = e->len;
+    entry->count = e->count;
+    entry->latest = best_version(&e->best[kLatest], &entry->latest_len);
+    entry->release = best_version(&e->best[kRelease], &entry->release_len);
+    entry->snapshot = best_version(&e->best[kSnapshot],
+        &entry->snapshot_len);
+    return 1;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lexer.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Kernels over exactly 64 readable bytes: bit i of `digits` is set if
+ * block[i] is a decimal digit, and of `separators` if it is '.' or '-'.
+ */
+typedef void (*classify_fn)(const char *block, uint64_t *digits,
+    uint64_t *separators);
+typedef void (*lower_fn)(char *dst, const char *src, size_t size);
+
+struct kernels {
+    classify_fn classify;
+    lower_fn lower;
+};
+
+static void classify_scalar(const char *block, uint64_t *digits,
+        uint64_t *separators) {
+    uint64_t d = 0;
+    uint64_t s = 0;
+    int i;
+    for (i = 0; i < 64; ++i) {
+        unsigned char c = block[i];
+        d |= (uint64_t) ((unsigned char) (c - '0') < 10) << i;
+        s |= (uint64_t) (c == '.' || c == '-') << i;
+    }
+    *digits = d;
+    *separators = s;
+}
+
+static void lower_scalar(char *dst, const char *src, size_t size) {
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        unsigned char c = src[i];
+        dst[i] = (unsigned char) (c - 'A') < 26 ? c | 0x20 : c;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+
+/* Bytes in [lo, lo + n) are those where min(v - lo, n - 1) == v - lo */
+__attribute__((target("sse2")))
+static __m128i in_range_sse2(__m128i v, char lo, char n) {
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(n - 1)), x);
+}
+
+__attribute__((target("sse2")))
+static void classify_sse2(const char *block, uint64_t *digits,
+        uint64_t *separators) {
+    uint64_t d = 0;
+    uint64_t s = 0;
+    int i;
+    for (i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (block + i));
+        __m128i sep = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        d |= (uint64_t) (uint16_t) _mm_movemask_epi8(
+            in_range_sse2(v, '0', 10)) << i;
+        s |= (uint64_t) (uint16_t) _mm_movemask_epi8(sep) << i;
+    }
+    *digits = d;
+    *separators = s;
+}
+
+__attribute__((target("sse2")))
+static void lower_sse2(char *dst, const char *src, size_t size) {
+    size_t i;
+    for (i = 0; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i upper = in_range_sse2(v, 'A', 26);
+        v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+        _mm_storeu_si128((__m128i*) (dst + i), v);
+    }
+    lower_scalar(dst + i, src + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static __m256i in_range_avx2(__m256i v, char lo, char n) {
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(n - 1)), x);
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char *block, uint64_t *digits,
+        uint64_t *separators) {
+    uint64_t d = 0;
+    uint64_t s = 0;
+    int i;
+    for (i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (block + i));
+        __m256i sep = _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+        d |= (uint64_t) (uint32_t) _mm256_movemask_epi8(
+            in_range_avx2(v, '0', 10)) << i;
+        s |= (uint64_t) (uint32_t) _mm256_movemask_epi8(sep) << i;
+    }
+    *digits = d;
+    *separators = s;
+}
+
+__attribute__((target("avx2")))
+static void lower_avx2(char *dst, const char *src, size_t size) {
+    size_t i;
+    for (i = 0; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i upper = in_range_avx2(v, 'A', 26);
+        v = _mm256_or_si256(v, _mm256_and_si256(upper,
+            _mm256_set1_epi8(0x20)));
+        _mm256_storeu_si256((__m256i*) (dst + i), v);
+    }
+    lower_sse2(dst + i, src + i, size - i);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+static const struct kernels kScalarKernels = { classify_scalar, lower_scalar };
+#ifdef HAVE_X86_SIMD
+static const struct kernels kSse2Kernels = { classify_sse2, lower_sse2 };
+static const struct kernels kAvx2Kernels = { classify_avx2, lower_avx2 };
+#endif
+
+/* Chosen on first use; racing threads all choose the same kernels */
+static const struct kernels *selected_kernels;
+
+static const struct kernels* kernels(void) {
+    const struct kernels *ret = __atomic_load_n(&selected_kernels,
+        __ATOMIC_RELAXED);
+    if (ret) {
+        return ret;
+    }
+
+    ret = &kScalarKernels;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ret = &kAvx2Kernels;
+    } else if (__builtin_cpu_supports("sse2")) {
+        ret = &kSse2Kernels;
+    }
+#endif
+    __atomic_store_n(&selected_kernels, ret, __ATOMIC_RELAXED);
+    return ret;
+}
+
+void mv_internal_scan_block(struct scanner *scanner) {
+    const char *block = scanner->str + scanner->base;
+    size_t n = scanner->len - scanner->base;
+    uint64_t valid = ~(uint64_t) 0;
+
+    char tail[64];
+    if (n < 64) {
+        memcpy(tail, block, n);
+        memset(tail + n, 0, 64 - n);
+        block = tail;
+        valid = ((uint64_t) 1 << n) - 1;
+    }
+
+    uint64_t digits, separators;
+    kernels()->classify(block, &digits, &separators);
+
+    uint64_t others = valid & ~digits & ~separators;
+    uint64_t prev_digits = digits << 1 | (scanner->carry & 1);
+    uint64_t prev_others = others << 1 | (scanner->carry >> 1);
+
+    scanner->pending = separators | (digits & prev_others)
+        | (others & prev_digits);
+    scanner->carry = digits >> 63 | (others >> 63) << 1;
+}
+
+void mv_internal_scanner_init(struct scanner *scanner, const char *str,
+        size_t len) {
+    scanner->str = str;
+    scanner->len = len;
+    scanner->base = 0;
+    scanner->pending = 0;
+    scanner->carry = 0;
+    if (len) {
+        mv_internal_scan_block(scanner);
+    }
+}
+
+void mv_internal_lower(char *dst, const char *src, size_t size) {
+    kernels()->lower(dst, src, size);
+}
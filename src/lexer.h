@@ -0,0 +1,67 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LEXER_H_
+#define LEXER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Token boundaries of a version string, found 64 bytes at a time.
+ *
+ * A boundary is a separator ('.' or '-') or a byte whose digit-ness differs
+ * from the byte before it, neither being a separator. These are exactly the
+ * positions where Maven's lexer ends an item. Each block is classified with
+ * SIMD instructions when the CPU has them.
+ */
+struct scanner {
+    const char *str;
+    size_t len;
+    size_t base;        /* Offset of the current block */
+    uint64_t pending;   /* Unconsumed boundaries in the current block */
+    uint64_t carry;     /* Bit 0: the last byte of the block was a digit */
+                        /* Bit 1: ... was neither a digit nor a separator */
+};
+
+void mv_internal_scanner_init(struct scanner *scanner, const char *str,
+    size_t len);
+
+/* Finds the boundaries of the block at `scanner->base` */
+void mv_internal_scan_block(struct scanner *scanner);
+
+/* @return the offset of the next boundary, or `len` if there are no more */
+static inline size_t mv_internal_next_boundary(struct scanner *scanner) {
+    while (!scanner->pending) {
+        if (scanner->base + 64 >= scanner->len) {
+            return scanner->len;
+        }
+        scanner->base += 64;
+        mv_internal_scan_block(scanner);
+    }
+    size_t ret = scanner->base + __builtin_ctzll(scanner->pending);
+    scanner->pending &= scanner->pending - 1;
+    return ret;
+}
+
+/* Copies `size` bytes from `src` to `dst`, folding ASCII to lower case. */
+void mv_internal_lower(char *dst, const char *src, size_t size);
+
+#endif /* LEXER_H_ */
@@ -0,0 +1,328 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/maven-range.h"
+
+#include <string.h>
+
+#include "arena.h"
+
+/* A restriction, in Maven's terms */
+struct interval {
+    struct maven_version *lower; /* NULL if unbounded */
+    struct maven_version *upper; /* NULL if unbounded; may alias `lower` */
+    int lower_inclusive;
+    int upper_inclusive;
+};
+
+struct maven_range {
+    struct maven_version *recommended;
+    size_t count;
+    size_t capacity;
+    struct interval intervals[0];
+};
+
+static size_t range_size(size_t capacity) {
+    return sizeof(struct maven_range) + capacity * sizeof(struct interval);
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Trims whitespace from both ends of [*str, *end) */
+static void trim(const char **str, const char **end) {
+    while (*str != *end && is_space(**str)) {
+        ++*str;
+    }
+    while (*end != *str && is_space((*end)[-1])) {
+        --*end;
+    }
+}
+
+static const char* find(const char *str, const char *end, char c) {
+    const char *ret = (const char*) memchr(str, c, end - str);
+    return ret ? ret : end;
+}
+
+/* Parses a non-empty bound, or leaves `*version` NULL for an empty one */
+static int parse_bound(const char *str, const char *end,
+        struct maven_version **version) {
+    *version = NULL;
+    if (str == end) {
+        return 1;
+    }
+    *version = mv_parse_n(str, end - str);
+    return *version != NULL;
+}
+
+/*
+ * Parses a bracketed restriction, from its opening to its closing bracket,
+ * into `interval`. Implements Restriction parsing from Maven's VersionRange.
+ *
+ * @return whether the restriction is valid
+ */
+static int parse_interval(const char *str, const char *end,
+        struct interval *interval) {
+    interval->lower_inclusive = *str == '[';
+    interval->upper_inclusive = end[-1] == ']';
+
+    const char *inner = str + 1;
+    const char *inner_end = end - 1;
+    trim(&inner, &inner_end);
+
+    const char *comma = find(inner, inner_end, ',');
+    if (comma == inner_end) {
+        /* A single version, which must be inclusive */
+        if (!interval->lower_inclusive || !interval->upper_inclusive
+                || inner == inner_end) {
+            return 0;
+        }
+        if (!parse_bound(inner, inner_end, &interval->lower)) {
+            return 0;
+        }
+        interval->upper = interval->lower;
+        return 1;
+    }
+
+    const char *lower_end = comma;
+    const char *upper = comma + 1;
+    trim(&inner, &lower_end);
+    trim(&upper, &inner_end);
+    if (lower_end - inner == inner_end - upper
+            && !memcmp(inner, upper, lower_end - inner)) {
+        return 0; /* Identical bounds, including two empty ones */
+    }
+
+    /* Either bound may be allocated by the time a check fails */
+    if (!parse_bound(inner, lower_end, &interval->lower)) {
+        return 0;
+    }
+    if (!parse_bound(upper, inner_end, &interval->upper)
+            || (interval->lower && interval->upper
+                && mv_compare(interval->upper, interval->lower) < 0)) {
+        if (interval->lower) {
+            mv_free(interval->lower);
+        }
+        if (interval->upper) {
+            mv_free(interval->upper);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+static void free_interval(struct interval *interval) {
+    if (interval->lower) {
+        mv_free(interval->lower);
+    }
+    if (interval->upper && interval->upper != interval->lower) {
+        mv_free(interval->upper);
+    }
+}
+
+/* Intervals must ascend, though adjacent ones may share a bound */
+static int follows(const struct interval *prev, const struct interval *next) {
+    return prev->upper && next->lower
+        && mv_compare(next->lower, prev->upper) >= 0;
+}
+
+/*
+ * Implements VersionRange.createFromVersionSpec from Maven 3, filling in
+ * `range`. Whatever was parsed before a failure is left for the caller to
+ * free.
+ *
+ * @return whether the specification is valid
+ */
+static int parse_spec(struct maven_range *range, const char *str,
+        const char *end) {
+    trim(&str, &end);
+    while (str != end && (*str == '[' || *str == '(')) {
+        /* The restriction ends at whichever closing bracket comes first */
+        const char *close = find(str, end, ')');
+        const char *bracket = find(str, end, ']');
+        if (bracket < close) {
+            close = bracket;
+        }
+        if (close == end) {
+            return 0;
+        }
+
+        struct interval *interval = &range->intervals[range->count];
+        if (!parse_interval(str, close + 1, interval)) {
+            return 0;
+        }
+        ++range->count;
+        if (range->count > 1 && !follows(interval - 1, interval)) {
+            return 0;
+        }
+
+        str = close + 1;
+        trim(&str, &end);
+        if (str != end && *str == ',') {
+            ++str;
+            trim(&str, &end);
+        }
+    }
+
+    if (str == end) {
+        return range->count > 0;
+    }
+
+    /* Only a lone version may be a recommendation */
+    if (range->count > 0) {
+        return 0;
+    }
+    range->recommended = mv_parse_n(str, end - str);
+    if (!range->recommended) {
+        return 0;
+    }
+    memset(&range->intervals[0], 0, sizeof(struct interval));
+    range->count = 1;
+    return 1;
+}
+
+static struct maven_range* parse_range(const char *str, const char *end) {
+    /* Every interval starts with an opening bracket */
+    size_t capacity = 1;
+    const char *cur;
+    for (cur = str; cur != end; ++cur) {
+        capacity += *cur == '[' || *cur == '(';
+    }
+
+    struct maven_range *range = (struct maven_range*) mv_internal_alloc(
+        &mv_internal_allocator, range_size(capacity));
+    if (!range) {
+        return NULL;
+    }
+    range->recommended = NULL;
+    range->count = 0;
+    range->capacity = capacity;
+
+    if (!parse_spec(range, str, end)) {
+        mv_range_free(range);
+        return NULL;
+    }
+    return range;
+}
+
+struct maven_range* mv_range_parse(const char *spec) {
+    return parse_range(spec, spec + strlen(spec));
+}
+
+void mv_range_free(struct maven_range *range) {
+    size_t i;
+    for (i = 0; i < range->count; ++i) {
+        free_interval(&range->intervals[i]);
+    }
+    if (range->recommended) {
+        mv_free(range->recommended);
+    }
+    mv_internal_free(&mv_internal_allocator, range,
+        range_size(range->capacity));
+}
+
+static int above_lower(const struct interval *interval,
+        const struct maven_version *version) {
+    if (!interval->lower) {
+        return 1;
+    }
+    int cmp = mv_compare(version, interval->lower);
+    return cmp > 0 || (cmp == 0 && interval->lower_inclusive);
+}
+
+static int below_upper(const struct interval *interval,
+        const struct maven_version *version) {
+    if (!interval->upper) {
+        return 1;
+    }
+    int cmp = mv_compare(version, interval->upper);
+    return cmp < 0 || (cmp == 0 && interval->upper_inclusive);
+}
+
+int mv_range_contains(const struct maven_range *range,
+        const struct maven_version *version) {
+    size_t i;
+    for (i = 0; i < range->count; ++i) {
+        const struct interval *interval = &range->intervals[i];
+        if (above_lower(interval, version) && below_upper(interval, version)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t mv_range_highest(const struct maven_range *range,
+        const struct maven_version *const *versions, size_t n) {
+    /*
+     * Try the intervals from the top. Versions above one interval are above
+     * every interval before it, so each search only narrows the array.
+     */
+    size_t end = n;
+    size_t i = range->count;
+    while (i-- > 0 && end > 0) {
+        const struct interval *interval = &range->intervals[i];
+
+        /* Find the first version above the interval */
+        size_t lo = 0;
+        size_t hi = end;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (below_upper(interval, versions[mid])) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        end = lo;
+        if (end > 0 && above_lower(interval, versions[end - 1])) {
+            return end - 1;
+        }
+    }
+    return n;
+}
+
+const struct maven_version* mv_range_recommended(
+        const struct maven_range *range) {
+    return range->recommended;
+}
+
+size_t mv_range_count(const struct maven_range *range) {
+    return range->count;
+}
+
+const struct maven_version* mv_range_lower(const struct maven_range *range,
+        size_t i) {
+    return range->intervals[i].lower;
+}
+
+const struct maven_version* mv_range_upper(const struct maven_range *range,
+        size_t i) {
+    return range->intervals[i].upper;
+}
+
+int mv_range_lower_inclusive(const struct maven_range *range, size_t i) {
+    return range->intervals[i].lower_inclusive;
+}
+
+int mv_range_upper_inclusive(const struct maven_range *range, size_t i) {
+    return range->intervals[i].upper_inclusive;
+}
@@ -21,26 +21,76 @@
 #include "c-maven-utils/maven-version.h"
 
 #include <ctype.h>
-#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "comparable-version.h"
+#include "lexer.h"
+#include "shared-version.h"
 
-struct maven_version {
-    int major;
-    int minor;
-    int incremental;
-    int build;
-    struct comparable_version *comparable;
-    char qualifier[0];
+struct maven_version_batch {
+    struct arena arena;
+    struct mv_allocator allocator;
 };
 
-static struct maven_version* alloc_version(size_t qualifier_len) {
-    struct maven_version *ret = (struct maven_version*) malloc(
-        sizeof(struct maven_version) + qualifier_len + 1);
-    memset(ret, 0, sizeof(struct maven_version) + qualifier_len + 1);
+/* Initial arena chunk for a batch; chunks double from here */
+#define kBatchChunkSize (16 * 1024)
+
+static size_t version_size(size_t qualifier_len, size_t len) {
+    return sizeof(struct maven_version) + qualifier_len + 1 + len;
+}
+
+struct maven_version* mv_internal_alloc_version(const char *version,
+        size_t len, size_t qualifier_len,
+        const struct mv_allocator *allocator) {
+    size_t size = version_size(qualifier_len, len);
+    struct maven_version *ret = (struct maven_version*) mv_internal_alloc(
+        allocator, size);
+    if (!ret) {
+        return NULL;
+    }
+    memset(ret, 0, size);
     ret->major = ret->minor = ret->incremental = ret->build = -1;
+    ret->allocator = allocator;
+    ret->refs = 1;
+    ret->size = size;
+
+    char *copy = ret->qualifier + qualifier_len + 1;
+    memcpy(copy, version, len);
+    ret->version = copy;
+    ret->len = len;
+    return ret;
+}
+
+static void free_version(struct maven_version *version) {
+    /* Not recomputed: a qualifier can hold a NUL from `mv_parse_n` */
+    mv_internal_free(version->allocator, version, version->size);
+}
+
+/* Racing builders each parse a copy and the first to publish wins */
+struct comparable_version* mv_internal_comparable(
+        const struct maven_version *version) {
+    struct maven_version *v = (struct maven_version*) version;
+    struct comparable_version *ret = __atomic_load_n(&v->comparable,
+        __ATOMIC_ACQUIRE);
+    if (ret) {
+        return ret;
+    }
+
+    ret = mv_internal_parse_comparable(v->version, v->len, v->allocator);
+    if (!ret) {
+        return NULL;
+    }
+
+    struct comparable_version *expected = NULL;
+    if (!__atomic_compare_exchange_n(&v->comparable, &expected, ret, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        mv_internal_free_comparable(ret, v->allocator);
+        ret = expected;
+    }
     return ret;
 }
 
@@ -49,94 +99,149 @@ struct parsed_int {
     int valid;
 };
 
-static struct parsed_int parse_int_limit(const char *str, const char *end,
-        int base) {
-    struct parsed_int ret = { 0, 0};
-    char *last = NULL;
-    ret.value = strtol(str, &last, base);
-    ret.valid = (*str != '\0' && last == end);
+/* Parses [str, end) as a non-empty run of decimal digits that fits an int */
+static struct parsed_int parse_int(const char *str, const char *end) {
+    struct parsed_int ret = { 0, str != end };
+    for (; str != end; ++str) {
+        int digit = *str - '0';
+        if (digit < 0 || digit > 9 || ret.value > (INT_MAX - digit) / 10) {
+            ret.valid = 0;
+            break;
+        }
+        ret.value = ret.value * 10 + digit;
+    }
     return ret;
 }
 
-static struct parsed_int parse_int(const char *str, int base) {
-    return parse_int_limit(str, str + strlen(str), base);
-}
+/*
+ * Packs X[.Y[.Z]][-N] into `ordinal`. Components must fit an int, like the
+ * integer items they stand in for.
+ *
+ * @return whether `version` has that form
+ */
+static int pack_ordinal(const char *version, const char *end,
+        struct ordinal *ordinal) {
+    uint64_t components[4] = { 0, 0, 0, 0 };
+    int n = 0; /* The component being parsed */
+
+    const char *cur = version;
+    for (;;) {
+        const char *start = cur;
+        uint64_t value = 0;
+        for (; cur != end && *cur >= '0' && *cur <= '9'; ++cur) {
+            value = value * 10 + (*cur - '0');
+            if (value > INT_MAX) {
+                return 0;
+            }
+        }
+        if (cur == start) {
+            return 0;
+        }
+        components[n] = value;
 
-static int starts_with_digit(const char *str) {
-    return isdigit(*str);
+        if (cur == end) {
+            break;
+        } else if (*cur == '.' && n < 2) {
+            ++n;
+        } else if (*cur == '-' && n < 3) {
+            n = 3;
+        } else {
+            return 0;
+        }
+        ++cur;
+    }
+
+    ordinal->hi = components[0] << 32 | components[1];
+    ordinal->lo = components[2] << 32 | components[3];
+    return 1;
 }
 
 /*
  * Implements the parsing algorithm from DefaultArtifactVersion in Maven 3.
  */
-struct maven_version* mv_parse(const char *version) {
-    const char *dash = strchr(version, '-');
-    const char *part2 = dash ? dash + 1 : NULL;
-    const char *part1;
-    int release_p1 = 0;
-
-    if (dash) {
-        /* Simplifies use of null-termination-expecting methods below */
-        part1 = strndup(version, dash - version);
-        release_p1 = 1;
-    } else {
-        part1 = version;
+static struct maven_version* parse_version(const char *version, size_t len,
+        const struct mv_allocator *allocator) {
+    const char *end = version + len;
+
+    /* The first dash, and up to three dots before it */
+    const char *dash = end;
+    const char *dots[3];
+    int ndots = 0;
+    struct scanner scanner;
+    mv_internal_scanner_init(&scanner, version, len);
+    size_t i;
+    while ((i = mv_internal_next_boundary(&scanner)) < len) {
+        if (version[i] == '-') {
+            dash = version + i;
+            break;
+        } else if (version[i] == '.' && ndots < 3) {
+            dots[ndots++] = version + i;
+        }
+    }
+    while (ndots < 3) {
+        dots[ndots++] = dash;
     }
 
+    const char *part1_end = dash;
+    const char *part2 = dash != end ? dash + 1 : NULL;
+
     int major, minor, incremental, build;
     major = minor = incremental = build = -1;
     const char *qualifier = NULL;
+    const char *qualifier_end = NULL;
 
     if (part2) {
-        if (strlen(part2) == 1 || *part2 != '0') {
-            struct parsed_int p = parse_int(part2, /*base=*/ 10);
+        if (end - part2 <= 1 || *part2 != '0') {
+            struct parsed_int p = parse_int(part2, end);
             if (p.valid) {
                 build = p.value;
             } else {
                 qualifier = part2;
+                qualifier_end = end;
             }
         }
     }
 
-    if (!strchr(part1, '.') && *part1 != '0') {
-        struct parsed_int p = parse_int(part1, /*base=*/ 10);
+    if (dots[0] == part1_end
+            && (version == part1_end || *version != '0')) {
+        struct parsed_int p = parse_int(version, part1_end);
         if (p.valid) {
             major = p.value;
         } else {
             qualifier = version;
+            qualifier_end = end;
             build = -1;
         }
     } else {
         int fallback = 0;
 
         for (;;) {
-            const char *cur = part1;
-            const char *sep = strchr(cur, '.');
+            const char *cur = version;
+            const char *sep = dots[0];
 
-            struct parsed_int p = sep ?
-                parse_int_limit(cur, sep, 10) : parse_int(cur, 10);
+            struct parsed_int p = parse_int(cur, sep);
             if (p.valid) {
                 major = p.value;
             } else {
                 fallback = 1;
                 break;
             }
-            if (!sep) { break; }
+            if (sep == part1_end) { break; }
 
             cur = sep + 1;
-            sep = strchr(cur, '.');
-            p = sep ? parse_int_limit(cur, sep, 10) : parse_int(cur, 10);
+            sep = dots[1];
+            p = parse_int(cur, sep);
             if (p.valid) {
                 minor = p.value;
             } else {
                 fallback = 1;
                 break;
             }
-            if (!sep) { break; }
+            if (sep == part1_end) { break; }
 
             cur = sep + 1;
-            sep = strchr(cur, '.');
-            p = sep ? parse_int_limit(cur, sep,10) : parse_int(cur, 10);
+            sep = dots[2];
+            p = parse_int(cur, sep);
             if (p.valid) {
                 incremental = p.value;
             } else {
@@ -144,9 +249,11 @@ struct maven_version* mv_parse(const char *version) {
                 break;
             }
 
-            if (sep) {
+            if (sep != part1_end) {
                 qualifier = sep + 1;
-                fallback = starts_with_digit(qualifier);
+                qualifier_end = part1_end;
+                fallback = qualifier != qualifier_end
+                    && isdigit((unsigned char) *qualifier);
             }
 
             break;
@@ -154,16 +261,14 @@ struct maven_version* mv_parse(const char *version) {
 
         if (fallback) {
             qualifier = version;
+            qualifier_end = end;
             major = minor = incremental = build = -1;
         }
     }
 
-    if (release_p1) {
-        free((char *) part1);
-    }
-
-    struct maven_version *ret = alloc_version(
-        qualifier ? strlen(qualifier) : 0);
+    size_t qualifier_len = qualifier ? qualifier_end - qualifier : 0;
+    struct maven_version *ret = mv_internal_alloc_version(version, len,
+        qualifier_len, allocator);
     if (!ret) {
         return NULL;
     }
@@ -173,17 +278,80 @@ struct maven_version* mv_parse(const char *version) {
     ret->build = build;
 
     if (qualifier) {
-        memcpy(ret->qualifier, qualifier, strlen(qualifier));
+        memcpy(ret->qualifier, qualifier, qualifier_len);
     }
-
-    ret->comparable = mv_internal_parse_comparable(version);
+    ret->has_ordinal = pack_ordinal(version, end, &ret->ordinal);
 
     return ret;
 }
 
+struct maven_version* mv_parse_n(const char *buf, size_t len) {
+    return parse_version(buf, len, &mv_internal_allocator);
+}
+
+struct maven_version* mv_parse_with(const char *buf, size_t len,
+        const struct mv_allocator *allocator) {
+    return parse_version(buf, len, allocator);
+}
+
+struct maven_version* mv_parse(const char *version) {
+    return mv_parse_n(version, strlen(version));
+}
+
+struct maven_version* mv_internal_retain(struct maven_version *version) {
+    __atomic_add_fetch(&version->refs, 1, __ATOMIC_RELAXED);
+    return version;
+}
+
+const char* mv_internal_version_string(const struct maven_version *version,
+        size_t *len) {
+    *len = version->len;
+    return version->version;
+}
+
 void mv_free(struct maven_version *version) {
-    mv_internal_free_comparable(version->comparable);
-    free(version);
+    /* A sole owner need not pay for the atomic decrement */
+    if (__atomic_load_n(&version->refs, __ATOMIC_ACQUIRE) != 1
+            && __atomic_sub_fetch(&version->refs, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    if (version->comparable) {
+        mv_internal_free_comparable(version->comparable, version->allocator);
+    }
+    free_version(version);
+}
+
+struct maven_version_batch* mv_parse_batch(const char **strs, size_t n,
+        struct maven_version **versions) {
+    struct maven_version_batch *batch = (struct maven_version_batch*)
+        mv_internal_alloc(&mv_internal_allocator, sizeof(*batch));
+    if (!batch) {
+        return NULL;
+    }
+    mv_internal_arena_init(&batch->arena, &mv_internal_allocator,
+        kBatchChunkSize);
+    batch->allocator = mv_internal_arena_allocator(&batch->arena);
+
+    /*
+     * The arena is not thread-safe, so batch members build their comparable
+     * forms up front rather than on first comparison.
+     */
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        versions[i] = parse_version(strs[i], strlen(strs[i]),
+            &batch->allocator);
+        if (!versions[i] || !mv_internal_comparable(versions[i])) {
+            mv_batch_free(batch);
+            return NULL;
+        }
+    }
+
+    return batch;
+}
+
+void mv_batch_free(struct maven_version_batch *batch) {
+    mv_internal_arena_release(&batch->arena);
+    mv_internal_free(&mv_internal_allocator, batch, sizeof(*batch));
 }
 
 int mv_major(struct maven_version *version) {
@@ -206,6 +374,125 @@ const char* mv_qualifier(struct maven_version *version) {
     return version->qualifier;
 }
 
+static int compare_u64(uint64_t a, uint64_t b) {
+    return a < b ? -1 : a > b;
+}
+
 int mv_compare(const struct maven_version *a, const struct maven_version *b) {
-    return mv_internal_compare(a->comparable, b->comparable);
+    if (a->has_ordinal && b->has_ordinal) {
+        if (a->ordinal.hi != b->ordinal.hi) {
+            return compare_u64(a->ordinal.hi, b->ordinal.hi);
+        }
+        return compare_u64(a->ordinal.lo, b->ordinal.lo);
+    }
+
+    struct comparable_version *ca = mv_internal_comparable(a);
+    struct comparable_version *cb = mv_internal_comparable(b);
+    if (!ca || !cb) {
+        return mv_internal_compare_str(a->version, a->len, b->version,
+            b->len);
+    }
+    return mv_internal_compare(ca, cb);
+}
+
+/* Skips back over the digits before `end`, returning how many there were */
+static size_t digits_before(const char *begin, const char **end) {
+    const char *cur = *end;
+    while (cur != begin && cur[-1] >= '0' && cur[-1] <= '9') {
+        --cur;
+    }
+    size_t ret = *end - cur;
+    *end = cur;
+    return ret;
+}
+
+/*
+ * Whether `version` names a deployed snapshot, which replaces SNAPSHOT with
+ * a timestamp and build number ("1.0-20200101.123456-1").
+ */
+static int is_timestamped_snapshot(const char *version, size_t len) {
+    const char *cur = version + len;
+    if (!digits_before(version, &cur) || cur == version || *--cur != '-') {
+        return 0;
+    }
+    if (digits_before(version, &cur) != 6 || cur == version
+            || *--cur != '.') {
+        return 0;
+    }
+    return digits_before(version, &cur) == 8 && cur != version
+        && *--cur == '-' && cur != version;
+}
+
+int mv_is_release(const struct maven_version *version) {
+    if (is_timestamped_snapshot(version->version, version->len)) {
+        return 0;
+    }
+    struct comparable_version *comparable = mv_internal_comparable(version);
+    if (!comparable) {
+        return mv_internal_is_release_str(version->version, version->len);
+    }
+    return mv_internal_is_release(comparable);
+}
+
+int mv_internal_is_release_version(const char *version, size_t len) {
+    return !is_timestamped_snapshot(version, len)
+        && mv_internal_is_release_str(version, len);
+}
+
+int mv_internal_is_snapshot(const char *version, size_t len) {
+    static const char kSnapshot[] = "snapshot";
+    size_t n = sizeof(kSnapshot) - 1;
+    if (len >= n) {
+        char lower[sizeof(kSnapshot) - 1];
+        mv_internal_lower(lower, version + len - n, n);
+        if (!memcmp(lower, kSnapshot, n)) {
+            return 1;
+        }
+    }
+    return is_timestamped_snapshot(version, len);
+}
+
+int mv_is_snapshot(const struct maven_version *version) {
+    return mv_internal_is_snapshot(version->version, version->len);
+}
+
+int mv_compare_str(const char *a, const char *b) {
+    return mv_internal_compare_str(a, strlen(a), b, strlen(b));
+}
+
+size_t mv_sort_key(const struct maven_version *version, unsigned char *buf,
+        size_t size) {
+    struct comparable_version *comparable = mv_internal_comparable(version);
+    if (!comparable) {
+        return mv_internal_sort_key_str(version->version, version->len, buf,
+            size);
+    }
+    return mv_internal_sort_key(comparable, buf, size);
+}
+
+size_t mv_sort_key_str(const char *str, unsigned char *buf, size_t size) {
+    return mv_internal_sort_key_str(str, strlen(str), buf, size);
+}
+
+size_t mv_sort_key_n(const char *str, size_t len, unsigned char *buf,
+        size_t size) {
+    return mv_internal_sort_key_str(str, len, buf, size);
+}
+
+size_t mv_canonical(const struct maven_version *version, char *buf,
+        size_t size) {
+    struct comparable_version *comparable = mv_internal_comparable(version);
+    if (!comparable) {
+        return mv_internal_canonical_str(version->version, version->len, buf,
+            size);
+    }
+    return mv_internal_canonical(comparable, buf, size);
+}
+
+uint64_t mv_hash(const struct maven_version *version) {
+    struct comparable_version *comparable = mv_internal_comparable(version);
+    if (!comparable) {
+        return mv_internal_hash_version_str(version->version, version->len);
+    }
+    return mv_internal_hash_version(comparable);
 }
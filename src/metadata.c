@@ -0,0 +1,436 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/metadata.h"
+
+#include <string.h>
+
+/* Elements of the metadata schema; anything else is kOther */
+enum node {
+    kDocument,
+    kOther,
+    kMetadata,
+    kGroupId,
+    kArtifactId,
+    kBaseVersion,
+    kVersioning,
+    kLatest,
+    kRelease,
+    kLastUpdated,
+    kVersions,
+    kVersion,
+    kSnapshot,
+    kTimestamp,
+    kBuildNumber,
+    kSnapshotVersions,
+    kSnapshotVersion,
+    kClassifier,
+    kExtension,
+    kValue,
+    kUpdated,
+    kNodes
+};
+
+/* Slots of the pending snapshot version */
+enum { kClassifierSlot, kExtensionSlot, kValueSlot, kUpdatedSlot };
+
+struct node_info {
+    unsigned char parent;
+    const char *name;
+    size_t len;
+    signed char field;  /* Reported field of a value, or -1 */
+    signed char slot;   /* Slot of a snapshot version's value, or -1 */
+};
+
+#define NODE(parent, name, field, slot) \
+    { parent, name, sizeof(name) - 1, field, slot }
+
+static const struct node_info kNodeInfo[kNodes] = {
+    [kDocument] = NODE(kDocument, "", -1, -1),
+    [kOther] = NODE(kDocument, "", -1, -1),
+    [kMetadata] = NODE(kDocument, "metadata", -1, -1),
+    [kGroupId] = NODE(kMetadata, "groupId", MV_METADATA_GROUP_ID, -1),
+    [kArtifactId] = NODE(kMetadata, "artifactId", MV_METADATA_ARTIFACT_ID,
+        -1),
+    [kBaseVersion] = NODE(kMetadata, "version", MV_METADATA_BASE_VERSION, -1),
+    [kVersioning] = NODE(kMetadata, "versioning", -1, -1),
+    [kLatest] = NODE(kVersioning, "latest", MV_METADATA_LATEST, -1),
+    [kRelease] = NODE(kVersioning, "release", MV_METADATA_RELEASE, -1),
+    [kLastUpdated] = NODE(kVersioning, "lastUpdated",
+        MV_METADATA_LAST_UPDATED, -1),
+    [kVersions] = NODE(kVersioning, "versions", -1, -1),
+    [kVersion] = NODE(kVersions, "version", MV_METADATA_VERSION, -1),
+    [kSnapshot] = NODE(kVersioning, "snapshot", -1, -1),
+    [kTimestamp] = NODE(kSnapshot, "timestamp",
+        MV_METADATA_SNAPSHOT_TIMESTAMP, -1),
+    [kBuildNumber] = NODE(kSnapshot, "buildNumber",
+        MV_METADATA_SNAPSHOT_BUILD_NUMBER, -1),
+    [kSnapshotVersions] = NODE(kVersioning, "snapshotVersions", -1, -1),
+    [kSnapshotVersion] = NODE(kSnapshotVersions, "snapshotVersion", -1, -1),
+    [kClassifier] = NODE(kSnapshotVersion, "classifier", -1,
+        kClassifierSlot),
+    [kExtension] = NODE(kSnapshotVersion, "extension", -1, kExtensionSlot),
+    [kValue] = NODE(kSnapshotVersion, "value", -1, kValueSlot),
+    [kUpdated] = NODE(kSnapshotVersion, "updated", -1, kUpdatedSlot),
+};
+
+#undef NODE
+
+static int is_value(unsigned char node) {
+    return kNodeInfo[node].field >= 0 || kNodeInfo[node].slot >= 0;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* The innermost open element */
+static unsigned char top(const struct mv_metadata_parser *parser) {
+    if (!parser->depth) {
+        return kDocument;
+    }
+    if (parser->depth > MV_METADATA_MAX_DEPTH) {
+        return kOther;
+    }
+    return parser->nodes[parser->depth - 1];
+}
+
+static unsigned char child(unsigned char parent, const char *name,
+        size_t len) {
+    if (parent == kOther) {
+        return kOther;
+    }
+    unsigned char node;
+    for (node = kMetadata; node < kNodes; ++node) {
+        const struct node_info *info = &kNodeInfo[node];
+        if (info->parent == parent && info->len == len
+                && !memcmp(info->name, name, len)) {
+            return node;
+        }
+    }
+    return kOther;
+}
+
+static int fail(struct mv_metadata_parser *parser) {
+    parser->failed = 1;
+    return 0;
+}
+
+/* @return the offset of `pat` at or after `from`, or `len` */
+static size_t find(const struct mv_metadata_parser *parser, size_t from,
+        const char *pat, size_t pat_len) {
+    const char *buf = parser->buf;
+    size_t len = parser->len;
+    while (from + pat_len <= len) {
+        const char *c = memchr(buf + from, pat[0], len - from - pat_len + 1);
+        if (!c) {
+            break;
+        }
+        from = c - buf;
+        if (!memcmp(c, pat, pat_len)) {
+            return from;
+        }
+        ++from;
+    }
+    return len;
+}
+
+/* Records text inside the open element, if it holds a value */
+static void text(struct mv_metadata_parser *parser, size_t start,
+        size_t end) {
+    if (!is_value(top(parser))) {
+        return;
+    }
+    while (start < end && is_space(parser->buf[start])) {
+        ++start;
+    }
+    while (end > start && is_space(parser->buf[end - 1])) {
+        --end;
+    }
+    if (start == end) {
+        return;
+    }
+    if (parser->has_text) {
+        fail(parser); /* Split by markup; no single slice holds it */
+        return;
+    }
+    parser->text = start;
+    parser->text_len = end - start;
+    parser->has_text = 1;
+}
+
+static void open_element(struct mv_metadata_parser *parser, size_t name,
+        size_t len) {
+    const char *local = parser->buf + name;
+    size_t local_len = len;
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        if (parser->buf[name + i] == ':') {
+            local = parser->buf + name + i + 1;
+            local_len = len - i - 1;
+        }
+    }
+
+    unsigned char node = child(top(parser), local, local_len);
+    if (parser->depth < MV_METADATA_MAX_DEPTH) {
+        parser->nodes[parser->depth] = node;
+        parser->names[parser->depth] = name;
+        parser->name_lens[parser->depth] = len;
+    }
+    ++parser->depth;
+
+    if (is_value(node)) {
+        parser->has_text = 0;
+    } else if (node == kSnapshotVersion) {
+        parser->snapshot_fields = 0;
+    }
+}
+
+static void clear_entry(struct mv_metadata_entry *entry) {
+    entry->classifier = NULL;
+    entry->classifier_len = 0;
+    entry->extension = NULL;
+    entry->extension_len = 0;
+    entry->updated = NULL;
+    entry->updated_len = 0;
+}
+
+static const char* slot(const struct mv_metadata_parser *parser, int i,
+        size_t *len) {
+    if (!(parser->snapshot_fields & (1u << i))) {
+        *len = 0;
+        return NULL;
+    }
+    *len = parser->snapshot_lens[i];
+    return parser->buf + parser->snapshot[i];
+}
+
+/*
+ * Closes the innermost element.
+ *
+ * @return 1 if it completed a field, which is written to `entry`
+ */
+static int close_element(struct mv_metadata_parser *parser,
+        struct mv_metadata_entry *entry) {
+    unsigned char node = top(parser);
+    --parser->depth;
+
+    const struct node_info *info = &kNodeInfo[node];
+    size_t value = parser->has_text ? parser->text : parser->pos;
+    size_t len = parser->has_text ? parser->text_len : 0;
+    if (info->field >= 0) {
+        entry->field = info->field;
+        entry->value = parser->buf + value;
+        entry->len = len;
+        clear_entry(entry);
+        return 1;
+    }
+    if (info->slot >= 0) {
+        parser->snapshot[info->slot] = value;
+        parser->snapshot_lens[info->slot] = len;
+        parser->snapshot_fields |= 1u << info->slot;
+        return 0;
+    }
+    if (node == kSnapshotVersion
+            && (parser->snapshot_fields & (1u << kValueSlot))) {
+        entry->field = MV_METADATA_SNAPSHOT_VERSION;
+        entry->value = slot(parser, kValueSlot, &entry->len);
+        entry->classifier = slot(parser, kClassifierSlot,
+            &entry->classifier_len);
+        entry->extension = slot(parser, kExtensionSlot,
+            &entry->extension_len);
+        entry->updated = slot(parser, kUpdatedSlot, &entry->updated_len);
+        return 1;
+    }
+    return 0;
+}
+
+/* Skips past a start tag and its attributes; `pos` is at its name */
+static int start_tag(struct mv_metadata_parser *parser,
+        struct mv_metadata_entry *entry) {
+    const char *buf = parser->buf;
+    size_t name = parser->pos;
+    size_t i = name;
+    while (i < parser->len && !is_space(buf[i]) && buf[i] != '/'
+            && buf[i] != '>') {
+        ++i;
+    }
+    if (i == name) {
+        return fail(parser);
+    }
+    size_t name_len = i - name;
+
+    while (i < parser->len) {
+        char c = buf[i];
+        if (c == '>') {
+            parser->pos = i + 1;
+            open_element(parser, name, name_len);
+            return 0;
+        }
+        if (c == '/' && i + 1 < parser->len && buf[i + 1] == '>') {
+            parser->pos = i + 2;
+            open_element(parser, name, name_len);
+            return close_element(parser, entry);
+        }
+        if (c == '"' || c == '\'') {
+            const char *quote = memchr(buf + i + 1, c, parser->len - i - 1);
+            if (!quote) {
+                break;
+            }
+            i = quote - buf;
+        }
+        ++i;
+    }
+    return fail(parser);
+}
+
+/* Skips past an end tag; `pos` is at its name */
+static int end_tag(struct mv_metadata_parser *parser,
+        struct mv_metadata_entry *entry) {
+    const char *buf = parser->buf;
+    size_t name = parser->pos;
+    size_t i = name;
+    while (i < parser->len && !is_space(buf[i]) && buf[i] != '>') {
+        ++i;
+    }
+    size_t name_len = i - name;
+    while (i < parser->len && is_space(buf[i])) {
+        ++i;
+    }
+    if (i == parser->len || buf[i] != '>' || !parser->depth) {
+        return fail(parser);
+    }
+    if (parser->depth <= MV_METADATA_MAX_DEPTH) {
+        size_t open = parser->depth - 1;
+        if (parser->name_lens[open] != name_len
+                || memcmp(buf + parser->names[open], buf + name, name_len)) {
+            return fail(parser);
+        }
+    }
+    parser->pos = i + 1;
+    return close_element(parser, entry);
+}
+
+/* Skips past a document type declaration, with any internal subset */
+static int doctype(struct mv_metadata_parser *parser) {
+    int brackets = 0;
+    size_t i;
+    for (i = parser->pos; i < parser->len; ++i) {
+        char c = parser->buf[i];
+        if (c == '[') {
+            ++brackets;
+        } else if (c == ']') {
+            --brackets;
+        } else if (c == '>' && brackets <= 0) {
+            parser->pos = i + 1;
+            return 0;
+        }
+    }
+    return fail(parser);
+}
+
+/* Skips past markup that ends with `close` */
+static int skip(struct mv_metadata_parser *parser, size_t from,
+        const char *close, size_t close_len) {
+    size_t end = find(parser, from, close, close_len);
+    if (end == parser->len) {
+        return fail(parser);
+    }
+    parser->pos = end + close_len;
+    return 0;
+}
+
+static int starts_with(const struct mv_metadata_parser *parser,
+        const char *prefix, size_t len) {
+    return parser->len - parser->pos >= len
+        && !memcmp(parser->buf + parser->pos, prefix, len);
+}
+
+/*
+ * Reads the markup at `pos`, which is at a '<'.
+ *
+ * @return 1 if it completed a field, which is written to `entry`
+ */
+static int markup(struct mv_metadata_parser *parser,
+        struct mv_metadata_entry *entry) {
+    if (starts_with(parser, "</", 2)) {
+        parser->pos += 2;
+        return end_tag(parser, entry);
+    }
+    if (starts_with(parser, "<?", 2)) {
+        return skip(parser, parser->pos + 2, "?>", 2);
+    }
+    if (starts_with(parser, "<!--", 4)) {
+        return skip(parser, parser->pos + 4, "-->", 3);
+    }
+    if (starts_with(parser, "<![CDATA[", 9)) {
+        size_t start = parser->pos + 9;
+        size_t end = find(parser, start, "]]>", 3);
+        if (end == parser->len) {
+            return fail(parser);
+        }
+        text(parser, start, end);
+        parser->pos = end + 3;
+        return 0;
+    }
+    if (starts_with(parser, "<!", 2)) {
+        return doctype(parser);
+    }
+    ++parser->pos;
+    return start_tag(parser, entry);
+}
+
+void mv_metadata_init(struct mv_metadata_parser *parser, const char *buf,
+        size_t len) {
+    memset(parser, 0, sizeof(*parser));
+    parser->buf = buf;
+    parser->len = len;
+}
+
+int mv_metadata_next(struct mv_metadata_parser *parser,
+        struct mv_metadata_entry *entry) {
+    while (!parser->failed) {
+        size_t rest = parser->len - parser->pos;
+        const char *lt = memchr(parser->buf + parser->pos, '<', rest);
+        if (!lt) {
+            parser->pos = parser->len;
+            if (parser->depth) {
+                fail(parser); /* Truncated */
+            }
+            return 0;
+        }
+        size_t at = lt - parser->buf;
+        if (at > parser->pos) {
+            text(parser, parser->pos, at);
+            parser->pos = at;
+            if (parser->failed) {
+                break;
+            }
+        }
+        if (markup(parser, entry)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int mv_metadata_failed(const struct mv_metadata_parser *parser) {
+    return parser->failed;
+}
@@ -0,0 +1,609 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/range-index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/*
+ * A centered interval tree. Each node has a center version; intervals that
+ * lie entirely below it go to the left subtree, intervals entirely above it
+ * to the right, and the rest stay in the node, which keeps them sorted by
+ * lower bound and by upper bound. A query below the center only has to scan
+ * the node's intervals by lower bound until one starts above the version
+ * (their upper bounds are all at or above the center), then descend left,
+ * and symmetrically above the center, so it visits one root-to-leaf path and
+ * touches only intervals that match, plus one per node.
+ *
+ * Inserts add leaves, and removals leave nodes behind; the tree is rebuilt
+ * from scratch when either has made it unbalanced.
+ */
+
+/* One interval of an indexed range */
+struct entry {
+    const struct maven_version *lower; /* NULL if unbounded */
+    const struct maven_version *upper; /* NULL if unbounded */
+    int lower_inclusive;
+    int upper_inclusive;
+    const struct maven_range *range;
+    void *value;
+};
+
+struct entries {
+    struct entry *items;
+    size_t count;
+    size_t capacity;
+};
+
+struct node {
+    const struct maven_version *center; /* NULL while all are unbounded */
+    struct node *left;
+    struct node *right;
+    struct entries by_lower;  /* Ascending lower bounds */
+    struct entries by_upper;  /* Descending upper bounds */
+    struct entries at_center; /* Those that contain `center` */
+};
+
+struct maven_range_index {
+    struct node *root;
+    size_t nranges;
+    size_t nentries;
+    size_t built_entries; /* Entries when the tree was last rebuilt */
+};
+
+/* Tree depth beyond which an insert triggers a rebuild */
+static size_t max_depth(size_t nentries) {
+    size_t log = 0;
+    while (nentries >>= 1) {
+        ++log;
+    }
+    return 2 * log + 8;
+}
+
+static int above_lower(const struct entry *e,
+        const struct maven_version *version) {
+    if (!e->lower) {
+        return 1;
+    }
+    int cmp = mv_compare(version, e->lower);
+    return cmp > 0 || (cmp == 0 && e->lower_inclusive);
+}
+
+static int below_upper(const struct entry *e,
+        const struct maven_version *version) {
+    if (!e->upper) {
+        return 1;
+    }
+    int cmp = mv_compare(version, e->upper);
+    return cmp < 0 || (cmp == 0 && e->upper_inclusive);
+}
+
+static int contains(const struct entry *e,
+        const struct maven_version *version) {
+    return above_lower(e, version) && below_upper(e, version);
+}
+
+/* Entirely below `center`, whatever the inclusivity of its upper bound */
+static int left_of(const struct entry *e, const struct maven_version *center) {
+    return e->upper && mv_compare(e->upper, center) < 0;
+}
+
+static int right_of(const struct entry *e, const struct maven_version *center) {
+    return e->lower && mv_compare(e->lower, center) > 0;
+}
+
+/*
+ * Orders by ascending lower bound, unbounded first and inclusive before
+ * exclusive, so the entries a version is above form a prefix.
+ */
+static int lower_order(const void *a, const void *b) {
+    const struct entry *ea = (const struct entry*) a;
+    const struct entry *eb = (const struct entry*) b;
+    if (!ea->lower || !eb->lower) {
+        return !!ea->lower - !!eb->lower;
+    }
+    int cmp = mv_compare(ea->lower, eb->lower);
+    return cmp ? cmp : eb->lower_inclusive - ea->lower_inclusive;
+}
+
+/* Likewise for descending upper bounds */
+static int upper_order(const void *a, const void *b) {
+    const struct entry *ea = (const struct entry*) a;
+    const struct entry *eb = (const struct entry*) b;
+    if (!ea->upper || !eb->upper) {
+        return !!ea->upper - !!eb->upper;
+    }
+    int cmp = mv_compare(eb->upper, ea->upper);
+    return cmp ? cmp : eb->upper_inclusive - ea->upper_inclusive;
+}
+
+static int compare_versions(const void *a, const void *b) {
+    return mv_compare(*(const struct maven_version *const*) a,
+        *(const struct maven_version *const*) b);
+}
+
+static int reserve(struct entries *entries, size_t capacity) {
+    if (capacity <= entries->capacity) {
+        return 1;
+    }
+    if (capacity < 2 * entries->capacity) {
+        capacity = 2 * entries->capacity;
+    }
+
+    struct entry *items = (struct entry*) mv_internal_alloc(
+        &mv_internal_allocator, capacity * sizeof(struct entry));
+    if (!items) {
+        return 0;
+    }
+    if (entries->count) {
+        memcpy(items, entries->items, entries->count * sizeof(struct entry));
+    }
+    if (entries->capacity) {
+        mv_internal_free(&mv_internal_allocator, entries->items,
+            entries->capacity * sizeof(struct entry));
+    }
+    entries->items = items;
+    entries->capacity = capacity;
+    return 1;
+}
+
+static void release(struct entries *entries) {
+    if (entries->capacity) {
+        mv_internal_free(&mv_internal_allocator, entries->items,
+            entries->capacity * sizeof(struct entry));
+    }
+}
+
+/* Inserts `e` after any entries that `order` ranks equal to it */
+static void insert_sorted(struct entries *entries, const struct entry *e,
+        int (*order)(const void*, const void*)) {
+    size_t lo = 0;
+    size_t hi = entries->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (order(&entries->items[mid], e) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    memmove(&entries->items[lo + 1], &entries->items[lo],
+        (entries->count - lo) * sizeof(struct entry));
+    entries->items[lo] = *e;
+    ++entries->count;
+}
+
+/* Whether `a` is the interval `b`, and has the same value unless b's is NULL */
+static int same_entry(const struct entry *a, const struct entry *b) {
+    return a->range == b->range && a->lower == b->lower
+        && a->upper == b->upper && (!b->value || a->value == b->value);
+}
+
+/* Removes the first entry matching `e`, and copies it to `removed` */
+static int remove_entry(struct entries *entries, const struct entry *e,
+        struct entry *removed) {
+    size_t i;
+    for (i = 0; i < entries->count; ++i) {
+        if (same_entry(&entries->items[i], e)) {
+            *removed = entries->items[i];
+            memmove(&entries->items[i], &entries->items[i + 1],
+                (entries->count - i - 1) * sizeof(struct entry));
+            --entries->count;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static struct node* new_node(const struct maven_version *center) {
+    struct node *node = (struct node*) mv_internal_alloc(
+        &mv_internal_allocator, sizeof(struct node));
+    if (node) {
+        memset(node, 0, sizeof(struct node));
+        node->center = center;
+    }
+    return node;
+}
+
+static void free_tree(struct node *node) {
+    while (node) {
+        struct node *right = node->right;
+        free_tree(node->left);
+        release(&node->by_lower);
+        release(&node->by_upper);
+        release(&node->at_center);
+        mv_internal_free(&mv_internal_allocator, node, sizeof(struct node));
+        node = right;
+    }
+}
+
+/* Adds `e`, which belongs at `node`, to its lists */
+static int add_to_node(struct node *node, const struct entry *e) {
+    if (!node->center) {
+        /* Any bound will do; every entry so far contains everything */
+        node->center = e->lower ? e->lower : e->upper;
+    }
+
+    int at_center = !node->center || contains(e, node->center);
+    if (!reserve(&node->by_lower, node->by_lower.count + 1)
+            || !reserve(&node->by_upper, node->by_upper.count + 1)
+            || (at_center
+                && !reserve(&node->at_center, node->at_center.count + 1))) {
+        return 0;
+    }
+
+    insert_sorted(&node->by_lower, e, lower_order);
+    insert_sorted(&node->by_upper, e, upper_order);
+    if (at_center) {
+        node->at_center.items[node->at_center.count++] = *e;
+    }
+    return 1;
+}
+
+/*
+ * Builds a subtree over `n` entries, centered on the median of their bounds.
+ * The entries are reordered.
+ */
+static int build_tree(struct entry *entries, size_t n, struct node **out) {
+    *out = NULL;
+    if (n == 0) {
+        return 1;
+    }
+
+    const struct maven_version **bounds = (const struct maven_version**)
+        mv_internal_alloc(&mv_internal_allocator, 2 * n * sizeof(*bounds));
+    if (!bounds) {
+        return 0;
+    }
+    size_t nbounds = 0;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        if (entries[i].lower) {
+            bounds[nbounds++] = entries[i].lower;
+        }
+        if (entries[i].upper) {
+            bounds[nbounds++] = entries[i].upper;
+        }
+    }
+    const struct maven_version *center = NULL;
+    if (nbounds) {
+        qsort(bounds, nbounds, sizeof(*bounds), compare_versions);
+        center = bounds[nbounds / 2];
+    }
+    mv_internal_free(&mv_internal_allocator, bounds, 2 * n * sizeof(*bounds));
+
+    struct node *node = new_node(center);
+    if (!node) {
+        return 0;
+    }
+    *out = node;
+
+    /*
+     * Partition into [left | here | right]. The entry the center came from
+     * stays here, so both sides are strictly smaller.
+     */
+    size_t left = 0;
+    size_t right = n;
+    i = 0;
+    while (i < right) {
+        struct entry tmp = entries[i];
+        if (center && left_of(&tmp, center)) {
+            entries[i++] = entries[left];
+            entries[left++] = tmp;
+        } else if (center && right_of(&tmp, center)) {
+            entries[i] = entries[--right];
+            entries[right] = tmp;
+        } else {
+            ++i;
+        }
+    }
+
+    size_t here = right - left;
+    if (!reserve(&node->by_lower, here) || !reserve(&node->by_upper, here)
+            || !reserve(&node->at_center, here)) {
+        return 0;
+    }
+    memcpy(node->by_lower.items, entries + left, here * sizeof(struct entry));
+    memcpy(node->by_upper.items, entries + left, here * sizeof(struct entry));
+    node->by_lower.count = node->by_upper.count = here;
+    qsort(node->by_lower.items, here, sizeof(struct entry), lower_order);
+    qsort(node->by_upper.items, here, sizeof(struct entry), upper_order);
+    for (i = left; i < right; ++i) {
+        if (!center || contains(&entries[i], center)) {
+            node->at_center.items[node->at_center.count++] = entries[i];
+        }
+    }
+
+    return build_tree(entries, left, &node->left)
+        && build_tree(entries + right, n - right, &node->right);
+}
+
+static void collect(const struct node *node, struct entry *out, size_t *n) {
+    while (node) {
+        memcpy(out + *n, node->by_lower.items,
+            node->by_lower.count * sizeof(struct entry));
+        *n += node->by_lower.count;
+        collect(node->left, out, n);
+        node = node->right;
+    }
+}
+
+/* Rebuilds the tree balanced; on failure the old tree is kept */
+static int rebuild(struct maven_range_index *index) {
+    size_t n = 0;
+    struct entry *entries = NULL;
+    if (index->nentries) {
+        entries = (struct entry*) mv_internal_alloc(&mv_internal_allocator,
+            index->nentries * sizeof(struct entry));
+        if (!entries) {
+            return 0;
+        }
+        collect(index->root, entries, &n);
+    }
+
+    struct node *root;
+    int ok = build_tree(entries, n, &root);
+    if (ok) {
+        free_tree(index->root);
+        index->root = root;
+        index->built_entries = n;
+    } else {
+        free_tree(root);
+    }
+
+    if (entries) {
+        mv_internal_free(&mv_internal_allocator, entries,
+            index->nentries * sizeof(struct entry));
+    }
+    return ok;
+}
+
+static struct entry interval_entry(const struct maven_range *range, size_t i,
+        void *value) {
+    struct entry e;
+    e.lower = mv_range_lower(range, i);
+    e.upper = mv_range_upper(range, i);
+    e.lower_inclusive = mv_range_lower_inclusive(range, i);
+    e.upper_inclusive = mv_range_upper_inclusive(range, i);
+    e.range = range;
+    e.value = value;
+    return e;
+}
+
+/* Whether one of the intervals before the i-th contains `version` */
+static int earlier_contains(const struct maven_range *range, size_t i,
+        const struct maven_version *version) {
+    while (i-- > 0) {
+        struct entry e = interval_entry(range, i, NULL);
+        if (contains(&e, version)) {
+            return 1;
+        }
+        /* Intervals ascend, so none before this one reach `version` */
+        if (!e.lower || mv_compare(e.lower, version) < 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Adjacent intervals may both include a shared bound ("[1,2],[2,3]"); it is
+ * left to the first so that the range is reported once.
+ */
+static struct entry make_entry(const struct maven_range *range, size_t i,
+        void *value) {
+    struct entry e = interval_entry(range, i, value);
+    if (e.lower && e.lower_inclusive
+            && earlier_contains(range, i, e.lower)) {
+        e.lower_inclusive = 0;
+    }
+    return e;
+}
+
+struct maven_range_index* mv_range_index_build(
+        const struct maven_range *const *ranges, void *const *values,
+        size_t n) {
+    struct maven_range_index *index = (struct maven_range_index*)
+        mv_internal_alloc(&mv_internal_allocator, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    memset(index, 0, sizeof(*index));
+
+    size_t nentries = 0;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        nentries += mv_range_count(ranges[i]);
+    }
+
+    struct entry *entries = NULL;
+    if (nentries) {
+        entries = (struct entry*) mv_internal_alloc(&mv_internal_allocator,
+            nentries * sizeof(struct entry));
+        if (!entries) {
+            mv_range_index_free(index);
+            return NULL;
+        }
+    }
+
+    size_t e = 0;
+    for (i = 0; i < n; ++i) {
+        size_t j;
+        for (j = 0; j < mv_range_count(ranges[i]); ++j) {
+            entries[e++] = make_entry(ranges[i], j, values[i]);
+        }
+    }
+
+    int ok = build_tree(entries, nentries, &index->root);
+    if (entries) {
+        mv_internal_free(&mv_internal_allocator, entries,
+            nentries * sizeof(struct entry));
+    }
+    if (!ok) {
+        mv_range_index_free(index);
+        return NULL;
+    }
+
+    index->nranges = n;
+    index->nentries = index->built_entries = nentries;
+    return index;
+}
+
+void mv_range_index_free(struct maven_range_index *index) {
+    free_tree(index->root);
+    mv_internal_free(&mv_internal_allocator, index, sizeof(*index));
+}
+
+/* @return the depth of the node `e` was added to, or 0 on failure */
+static size_t insert_entry(struct maven_range_index *index,
+        const struct entry *e) {
+    struct node **link = &index->root;
+    size_t depth = 1;
+    while (*link) {
+        struct node *node = *link;
+        if (node->center && left_of(e, node->center)) {
+            link = &node->left;
+        } else if (node->center && right_of(e, node->center)) {
+            link = &node->right;
+        } else {
+            break;
+        }
+        ++depth;
+    }
+
+    if (!*link) {
+        *link = new_node(NULL);
+        if (!*link) {
+            return 0;
+        }
+    }
+    return add_to_node(*link, e) ? depth : 0;
+}
+
+static int remove_from_tree(struct node *node, const struct entry *e) {
+    while (node) {
+        if (node->center && left_of(e, node->center)) {
+            node = node->left;
+        } else if (node->center && right_of(e, node->center)) {
+            node = node->right;
+        } else {
+            /* Once found, remove that same entry from the other lists */
+            struct entry removed;
+            if (!remove_entry(&node->by_lower, e, &removed)) {
+                return 0;
+            }
+            remove_entry(&node->by_upper, &removed, &removed);
+            remove_entry(&node->at_center, &removed, &removed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int mv_range_index_insert(struct maven_range_index *index,
+        const struct maven_range *range, void *value) {
+    size_t depth = 0;
+    size_t i;
+    for (i = 0; i < mv_range_count(range); ++i) {
+        struct entry e = make_entry(range, i, value);
+        size_t d = insert_entry(index, &e);
+        if (!d) {
+            /* Undo the intervals that made it in */
+            while (i-- > 0) {
+                e = make_entry(range, i, value);
+                remove_from_tree(index->root, &e);
+                --index->nentries;
+            }
+            return 0;
+        }
+        ++index->nentries;
+        if (d > depth) {
+            depth = d;
+        }
+    }
+    ++index->nranges;
+
+    if (depth > max_depth(index->nentries)) {
+        rebuild(index); /* Still correct if this fails, just slower */
+    }
+    return 1;
+}
+
+int mv_range_index_remove(struct maven_range_index *index,
+        const struct maven_range *range) {
+    size_t i;
+    for (i = 0; i < mv_range_count(range); ++i) {
+        struct entry e = make_entry(range, i, NULL);
+        if (!remove_from_tree(index->root, &e)) {
+            return 0;
+        }
+        --index->nentries;
+    }
+    --index->nranges;
+
+    if (index->nentries < index->built_entries / 4) {
+        rebuild(index);
+    }
+    return 1;
+}
+
+size_t mv_range_index_size(const struct maven_range_index *index) {
+    return index->nranges;
+}
+
+static void report(const struct entry *e, void **values, size_t size,
+        size_t *n) {
+    if (*n < size) {
+        values[*n] = e->value;
+    }
+    ++*n;
+}
+
+size_t mv_range_index_query(const struct maven_range_index *index,
+        const struct maven_version *version, void **values, size_t size) {
+    size_t n = 0;
+    size_t i;
+    const struct node *node = index->root;
+    while (node) {
+        int cmp = node->center ? mv_compare(version, node->center) : 0;
+        if (cmp == 0) {
+            for (i = 0; i < node->at_center.count; ++i) {
+                report(&node->at_center.items[i], values, size, &n);
+            }
+            break;
+        } else if (cmp < 0) {
+            for (i = 0; i < node->by_lower.count
+                    && above_lower(&node->by_lower.items[i], version); ++i) {
+                report(&node->by_lower.items[i], values, size, &n);
+            }
+            node = node->left;
+        } else {
+            for (i = 0; i < node->by_upper.count
+                    && below_upper(&node->by_upper.items[i], version); ++i) {
+                report(&node->by_upper.items[i], values, size, &n);
+            }
+            node = node->right;
+        }
+    }
+    return n;
+}
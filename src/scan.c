@@ -0,0 +1,731 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/scan.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "arena.h"
+#include "c-maven-utils/catalog.h"
+#include "shared-version.h"
+
+/* Arena chunks of each worker's artifacts and versions */
+#define kWorkerChunkSize (64 * 1024)
+
+/* Bytes of directory entries read at once */
+#define kDirBufferSize (64 * 1024)
+
+/* Keys up to this long are computed on the stack */
+#define kStackKeySize 256
+
+/* A directory waiting to be searched, relative to the root */
+struct work {
+    struct work *next;
+    size_t len;
+    char path[0];
+};
+
+struct artifact {
+    const char *name;
+    size_t len;
+    struct maven_version **versions;
+    const char **strs;
+    size_t count;
+};
+
+/* A version directory of the directory being searched */
+struct found {
+    const char *str;
+    size_t len;
+    struct maven_version *version;
+    const unsigned char *key;
+    size_t key_len;
+};
+
+struct worker {
+    struct maven_scan *scan;
+    struct arena arena;           /* Artifacts and their versions */
+    struct mv_allocator allocator;
+    struct artifact *artifacts;
+    size_t n;
+    size_t capacity;
+    char *buf;                    /* Directory entries */
+    char *names;                  /* Subdirectories being looked at, */
+    size_t names_len;             /* NUL-separated */
+    size_t names_capacity;
+    struct found *found;
+    size_t nfound;
+    size_t found_capacity;
+    size_t skipped;
+};
+
+struct maven_scan {
+    int root;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct work *stack;
+    size_t pending;               /* Directories queued or being searched */
+    int failed;                   /* Memory could not be allocated */
+    struct worker *workers;
+    unsigned nworkers;
+    struct artifact *artifacts;   /* Every worker's, sorted by name */
+    size_t n;
+    size_t skipped;
+};
+
+/*
+ * Makes room for `n` more of the `used` elements of `size` bytes in `array`.
+ *
+ * @return the array, which may have moved, or NULL if it could not grow
+ */
+static void* grow(void *array, size_t *capacity, size_t used, size_t n,
+        size_t size) {
+    if (used + n <= *capacity) {
+        return array;
+    }
+    size_t grown_capacity = *capacity ? *capacity : 64;
+    while (grown_capacity < used + n) {
+        grown_capacity *= 2;
+    }
+    void *grown = mv_internal_alloc(&mv_internal_allocator,
+        grown_capacity * size);
+    if (!grown) {
+        return NULL;
+    }
+    if (array) {
+        memcpy(grown, array, used * size);
+        mv_internal_free(&mv_internal_allocator, array, *capacity * size);
+    }
+    *capacity = grown_capacity;
+    return grown;
+}
+
+static void release(void *array, size_t capacity, size_t size) {
+    if (array) {
+        mv_internal_free(&mv_internal_allocator, array, capacity * size);
+    }
+}
+
+static void fail(struct maven_scan *scan) {
+    pthread_mutex_lock(&scan->lock);
+    scan->failed = 1;
+    pthread_mutex_unlock(&scan->lock);
+}
+
+static struct work* new_work(const struct work *parent, const char *name,
+        size_t len) {
+    size_t path_len = parent && parent->len ? parent->len + 1 + len : len;
+    struct work *work = (struct work*) mv_internal_alloc(
+        &mv_internal_allocator, sizeof(struct work) + path_len + 1);
+    if (!work) {
+        return NULL;
+    }
+    work->next = NULL;
+    work->len = path_len;
+    char *cur = work->path;
+    if (parent && parent->len) {
+        memcpy(cur, parent->path, parent->len);
+        cur += parent->len;
+        *cur++ = '/';
+    }
+    memcpy(cur, name, len);
+    cur[len] = '\0';
+    return work;
+}
+
+static void free_work(struct work *work) {
+    mv_internal_free(&mv_internal_allocator, work,
+        sizeof(struct work) + work->len + 1);
+}
+
+/*
+ * Reading directories. On Linux, entries come straight from getdents64(2)
+ * into the worker's buffer, a buffer at a time.
+ */
+
+struct dir_reader {
+    int fd;
+#ifdef __linux__
+    char *buf;
+    size_t pos;
+    size_t end;
+#else
+    DIR *dir;
+#endif
+};
+
+#ifdef __linux__
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[0];
+};
+#endif
+
+static int open_dir(struct dir_reader *reader, int at, const char *path,
+        char *buf) {
+    reader->fd = openat(at, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (reader->fd < 0) {
+        return 0;
+    }
+#ifdef __linux__
+    reader->buf = buf;
+    reader->pos = reader->end = 0;
+#else
+    reader->dir = fdopendir(reader->fd);
+    if (!reader->dir) {
+        close(reader->fd);
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+static void close_dir(struct dir_reader *reader) {
+#ifdef __linux__
+    close(reader->fd);
+#else
+    closedir(reader->dir);
+#endif
+}
+
+/*
+ * Reads the next entry, skipping hidden ones (and so "." and "..").
+ *
+ * @return 1, or 0 at the end of the directory or if it cannot be read
+ */
+static int read_dir(struct dir_reader *reader, const char **name,
+        int *is_dir) {
+    for (;;) {
+        unsigned char type;
+        const char *entry;
+#ifdef __linux__
+        if (reader->pos == reader->end) {
+            long n = syscall(SYS_getdents64, reader->fd, reader->buf,
+                kDirBufferSize);
+            if (n <= 0) {
+                return 0;
+            }
+            reader->pos = 0;
+            reader->end = n;
+        }
+        const struct linux_dirent64 *d = (const struct linux_dirent64*)
+            (reader->buf + reader->pos);
+        reader->pos += d->d_reclen;
+        type = d->d_type;
+        entry = d->d_name;
+#else
+        const struct dirent *d = readdir(reader->dir);
+        if (!d) {
+            return 0;
+        }
+        type = d->d_type;
+        entry = d->d_name;
+#endif
+        if (entry[0] == '.') {
+            continue;
+        }
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(reader->fd, entry, &st, AT_SYMLINK_NOFOLLOW)) {
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+        }
+        *name = entry;
+        *is_dir = type == DT_DIR;
+        return 1;
+    }
+}
+
+/*
+ * Searching.
+ */
+
+/*
+ * Whether `dir`, a subdirectory of the artifact's directory at `fd`, holds
+ * a file named for the artifact and version: "artifact-version..." or, for
+ * "X-SNAPSHOT", "artifact-X-...".
+ */
+static int is_version(struct worker *w, int fd, const char *artifact,
+        size_t artifact_len, const char *dir, size_t len) {
+    static const char kSnapshot[] = "-SNAPSHOT";
+    size_t prefix_len = len;
+    if (len >= sizeof(kSnapshot) - 1 && !memcmp(dir + len
+            - (sizeof(kSnapshot) - 1), kSnapshot, sizeof(kSnapshot) - 1)) {
+        prefix_len = len - (sizeof(kSnapshot) - 2); /* Keep the '-' */
+    }
+
+    struct dir_reader reader;
+    if (!open_dir(&reader, fd, dir, w->buf)) {
+        return 0;
+    }
+    const char *name;
+    int is_dir;
+    int ret = 0;
+    while (!ret && read_dir(&reader, &name, &is_dir)) {
+        ret = !is_dir && !strncmp(name, artifact, artifact_len)
+            && name[artifact_len] == '-'
+            && !strncmp(name + artifact_len + 1, dir, prefix_len);
+    }
+    close_dir(&reader);
+    return ret;
+}
+
+/*
+ * Ascending versions by sort key, as catalogs store them; equal ones by
+ * string, for stable output. Unlike `mv_compare`, this is transitive.
+ */
+static int compare_found(const void *pa, const void *pb) {
+    const struct found *a = (const struct found*) pa;
+    const struct found *b = (const struct found*) pb;
+    size_t len = a->key_len < b->key_len ? a->key_len : b->key_len;
+    int cmp = memcmp(a->key, b->key, len);
+    if (!cmp) {
+        cmp = a->key_len < b->key_len ? -1 : a->key_len > b->key_len;
+    }
+    return cmp ? cmp : strcmp(a->str, b->str);
+}
+
+/* Copies the sort key of `f` into the arena */
+static int add_key(struct worker *w, struct found *f) {
+    unsigned char stack_key[kStackKeySize];
+    size_t key_len = mv_sort_key(f->version, stack_key, sizeof(stack_key));
+    unsigned char *key = (unsigned char*) mv_internal_arena_alloc(&w->arena,
+        key_len);
+    if (!key_len || !key) {
+        return 0;
+    }
+    if (key_len <= sizeof(stack_key)) {
+        memcpy(key, stack_key, key_len);
+    } else {
+        mv_sort_key(f->version, key, key_len);
+    }
+    f->key = key;
+    f->key_len = key_len;
+    return 1;
+}
+
+/* Records the versions found in `dir` as an artifact */
+static int add_artifact(struct worker *w, const struct work *dir) {
+    struct artifact *artifacts = (struct artifact*) grow(w->artifacts,
+        &w->capacity, w->n, 1, sizeof(struct artifact));
+    if (!artifacts) {
+        return 0;
+    }
+    w->artifacts = artifacts;
+
+    /* "group/path/artifact" becomes "group.path:artifact" */
+    char *name = (char*) mv_internal_arena_alloc(&w->arena, dir->len + 1);
+    if (!name) {
+        return 0;
+    }
+    size_t i;
+    size_t last = 0;
+    for (i = 0; i <= dir->len; ++i) {
+        name[i] = dir->path[i] == '/' ? '.' : dir->path[i];
+        if (dir->path[i] == '/') {
+            last = i;
+        }
+    }
+    name[last] = ':';
+
+    /*
+     * Versions are built in full here: the arena is the worker's, so they
+     * cannot build their comparable forms later, on another thread.
+     */
+    for (i = 0; i < w->nfound; ++i) {
+        struct found *f = &w->found[i];
+        char *str = (char*) mv_internal_arena_alloc(&w->arena, f->len + 1);
+        if (!str) {
+            return 0;
+        }
+        memcpy(str, f->str, f->len + 1);
+        f->str = str;
+        f->version = mv_parse_with(str, f->len, &w->allocator);
+        if (!f->version || !mv_internal_comparable(f->version)
+                || !add_key(w, f)) {
+            return 0;
+        }
+    }
+    qsort(w->found, w->nfound, sizeof(struct found), compare_found);
+
+    struct artifact *a = &w->artifacts[w->n];
+    a->name = name;
+    a->len = dir->len;
+    a->count = w->nfound;
+    a->versions = (struct maven_version**) mv_internal_arena_alloc(
+        &w->arena, w->nfound * sizeof(struct maven_version*));
+    a->strs = (const char**) mv_internal_arena_alloc(&w->arena,
+        w->nfound * sizeof(const char*));
+    if (!a->versions || !a->strs) {
+        return 0;
+    }
+    for (i = 0; i < w->nfound; ++i) {
+        a->versions[i] = w->found[i].version;
+        a->strs[i] = w->found[i].str;
+    }
+    ++w->n;
+    return 1;
+}
+
+/*
+ * Searches `dir`, whose subdirectories are each either a version of an
+ * artifact at `dir` or a directory to search in turn.
+ *
+ * @return the directories to search, linked through `next`, with the last
+ *         in `*last` and their number in `*n`
+ */
+static struct work* search(struct worker *w, const struct work *dir,
+        struct work **last, size_t *n) {
+    struct maven_scan *scan = w->scan;
+    struct dir_reader reader;
+    if (!open_dir(&reader, scan->root, dir->len ? dir->path : ".", w->buf)) {
+        ++w->skipped;
+        return NULL;
+    }
+
+    /* The buffer is needed to look into subdirectories; list them first */
+    const char *name;
+    int is_dir;
+    w->names_len = 0;
+    while (read_dir(&reader, &name, &is_dir)) {
+        if (!is_dir) {
+            continue;
+        }
+        size_t size = strlen(name) + 1;
+        char *names = (char*) grow(w->names, &w->names_capacity,
+            w->names_len, size, 1);
+        if (!names) {
+            close_dir(&reader);
+            fail(scan);
+            return NULL;
+        }
+        w->names = names;
+        memcpy(names + w->names_len, name, size);
+        w->names_len += size;
+    }
+
+    /* Artifacts are inside a group, so `dir` needs a parent */
+    const char *artifact = NULL;
+    size_t artifact_len = 0;
+    size_t i;
+    for (i = dir->len; i > 0; --i) {
+        if (dir->path[i - 1] == '/') {
+            artifact = dir->path + i;
+            artifact_len = dir->len - i;
+            break;
+        }
+    }
+
+    struct work *children = NULL;
+    *last = NULL;
+    *n = 0;
+    w->nfound = 0;
+    const char *sub;
+    size_t len;
+    for (sub = w->names; sub < w->names + w->names_len; sub += len + 1) {
+        len = strlen(sub);
+        if (artifact && is_version(w, reader.fd, artifact, artifact_len, sub,
+                len)) {
+            struct found *found = (struct found*) grow(w->found,
+                &w->found_capacity, w->nfound, 1, sizeof(struct found));
+            if (!found) {
+                fail(scan);
+                break;
+            }
+            w->found = found;
+            found[w->nfound].str = sub;
+            found[w->nfound].len = len;
+            ++w->nfound;
+            continue;
+        }
+
+        struct work *child = new_work(dir, sub, len);
+        if (!child) {
+            fail(scan);
+            break;
+        }
+        child->next = children;
+        children = child;
+        if (!*last) {
+            *last = child;
+        }
+        ++*n;
+    }
+    close_dir(&reader);
+
+    if (w->nfound && !add_artifact(w, dir)) {
+        fail(scan);
+    }
+    return children;
+}
+
+static void* run_worker(void *arg) {
+    struct worker *w = (struct worker*) arg;
+    struct maven_scan *scan = w->scan;
+
+    pthread_mutex_lock(&scan->lock);
+    for (;;) {
+        while (!scan->stack && scan->pending) {
+            pthread_cond_wait(&scan->cond, &scan->lock);
+        }
+        struct work *dir = scan->stack;
+        if (!dir) {
+            break;
+        }
+        scan->stack = dir->next;
+        int failed = scan->failed;
+        pthread_mutex_unlock(&scan->lock);
+
+        /* After a failure, the queue is only drained */
+        struct work *children = NULL;
+        struct work *last = NULL;
+        size_t n = 0;
+        if (!failed) {
+            children = search(w, dir, &last, &n);
+        }
+        free_work(dir);
+
+        pthread_mutex_lock(&scan->lock);
+        if (children) {
+            last->next = scan->stack;
+            scan->stack = children;
+            scan->pending += n;
+        }
+        --scan->pending;
+        if (n > 1 || !scan->pending) {
+            pthread_cond_broadcast(&scan->cond);
+        }
+    }
+    pthread_mutex_unlock(&scan->lock);
+    return NULL;
+}
+
+static int compare_artifacts(const void *pa, const void *pb) {
+    const struct artifact *a = (const struct artifact*) pa;
+    const struct artifact *b = (const struct artifact*) pb;
+    int cmp = memcmp(a->name, b->name, a->len < b->len ? a->len : b->len);
+    if (cmp) {
+        return cmp;
+    }
+    return a->len < b->len ? -1 : a->len > b->len;
+}
+
+/* Gathers the workers' artifacts and releases their scratch space */
+static int collect(struct maven_scan *scan) {
+    unsigned i;
+    size_t n = 0;
+    for (i = 0; i < scan->nworkers; ++i) {
+        struct worker *w = &scan->workers[i];
+        n += w->n;
+        scan->skipped += w->skipped;
+        release(w->buf, kDirBufferSize, 1);
+        release(w->names, w->names_capacity, 1);
+        release(w->found, w->found_capacity, sizeof(struct found));
+        w->buf = w->names = NULL;
+        w->found = NULL;
+    }
+    if (scan->failed) {
+        return 0;
+    }
+
+    if (n) {
+        scan->artifacts = (struct artifact*) mv_internal_alloc(
+            &mv_internal_allocator, n * sizeof(struct artifact));
+        if (!scan->artifacts) {
+            return 0;
+        }
+    }
+    for (i = 0; i < scan->nworkers; ++i) {
+        struct worker *w = &scan->workers[i];
+        if (w->n) {
+            memcpy(scan->artifacts + scan->n, w->artifacts,
+                w->n * sizeof(struct artifact));
+        }
+        scan->n += w->n;
+        release(w->artifacts, w->capacity, sizeof(struct artifact));
+        w->artifacts = NULL;
+    }
+    if (scan->n) {
+        qsort(scan->artifacts, scan->n, sizeof(struct artifact),
+            compare_artifacts);
+    }
+    return 1;
+}
+
+struct maven_scan* mv_scan(const char *root, unsigned threads) {
+    if (!threads) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned) cpus : 1;
+    }
+
+    struct maven_scan *scan = (struct maven_scan*) mv_internal_alloc(
+        &mv_internal_allocator, sizeof(*scan));
+    if (!scan) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(scan, 0, sizeof(*scan));
+    scan->root = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (scan->root < 0) {
+        int saved = errno;
+        mv_internal_free(&mv_internal_allocator, scan, sizeof(*scan));
+        errno = saved;
+        return NULL;
+    }
+    pthread_mutex_init(&scan->lock, NULL);
+    pthread_cond_init(&scan->cond, NULL);
+
+    scan->workers = (struct worker*) mv_internal_alloc(&mv_internal_allocator,
+        threads * sizeof(struct worker));
+    pthread_t *ids = (pthread_t*) mv_internal_alloc(&mv_internal_allocator,
+        threads * sizeof(pthread_t));
+    scan->stack = new_work(NULL, "", 0);
+    scan->pending = 1;
+    if (!scan->workers || !ids || !scan->stack) {
+        scan->failed = 1;
+    }
+
+    unsigned i;
+    if (scan->workers) {
+        memset(scan->workers, 0, threads * sizeof(struct worker));
+        scan->nworkers = threads;
+    }
+    for (i = 0; !scan->failed && i < threads; ++i) {
+        struct worker *w = &scan->workers[i];
+        w->scan = scan;
+        mv_internal_arena_init(&w->arena, &mv_internal_allocator,
+            kWorkerChunkSize);
+        w->allocator = mv_internal_arena_allocator(&w->arena);
+        w->buf = (char*) mv_internal_alloc(&mv_internal_allocator,
+            kDirBufferSize);
+        if (!w->buf) {
+            scan->failed = 1;
+        }
+    }
+
+    /* The calling thread is the first worker; run with fewer on failure */
+    unsigned started = 1;
+    if (!scan->failed) {
+        for (; started < threads; ++started) {
+            if (pthread_create(&ids[started], NULL, run_worker,
+                    &scan->workers[started])) {
+                break;
+            }
+        }
+        run_worker(&scan->workers[0]);
+        for (i = 1; i < started; ++i) {
+            pthread_join(ids[i], NULL);
+        }
+    } else if (scan->stack) {
+        free_work(scan->stack);
+        scan->stack = NULL;
+    }
+    if (ids) {
+        mv_internal_free(&mv_internal_allocator, ids,
+            threads * sizeof(pthread_t));
+    }
+    close(scan->root);
+
+    if (!collect(scan)) {
+        mv_scan_free(scan);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return scan;
+}
+
+void mv_scan_free(struct maven_scan *scan) {
+    unsigned i;
+    for (i = 0; i < scan->nworkers; ++i) {
+        struct worker *w = &scan->workers[i];
+        release(w->artifacts, w->capacity, sizeof(struct artifact));
+        mv_internal_arena_release(&w->arena);
+    }
+    if (scan->workers) {
+        mv_internal_free(&mv_internal_allocator, scan->workers,
+            scan->nworkers * sizeof(struct worker));
+    }
+    release(scan->artifacts, scan->n, sizeof(struct artifact));
+    pthread_mutex_destroy(&scan->lock);
+    pthread_cond_destroy(&scan->cond);
+    mv_internal_free(&mv_internal_allocator, scan, sizeof(*scan));
+}
+
+size_t mv_scan_size(const struct maven_scan *scan) {
+    return scan->n;
+}
+
+size_t mv_scan_skipped(const struct maven_scan *scan) {
+    return scan->skipped;
+}
+
+int mv_scan_artifact_at(const struct maven_scan *scan, size_t i,
+        struct mv_scan_artifact *artifact) {
+    if (i >= scan->n) {
+        return 0;
+    }
+    const struct artifact *a = &scan->artifacts[i];
+    artifact->name = a->name;
+    artifact->len = a->len;
+    artifact->versions = a->versions;
+    artifact->strs = a->strs;
+    artifact->count = a->count;
+    return 1;
+}
+
+int mv_scan_write_catalog(const struct maven_scan *scan, const char *path) {
+    struct maven_catalog_builder *builder = mv_catalog_builder_create();
+    if (!builder) {
+        errno = ENOMEM;
+        return 0;
+    }
+    size_t i, j;
+    for (i = 0; i < scan->n; ++i) {
+        const struct artifact *a = &scan->artifacts[i];
+        for (j = 0; j < a->count; ++j) {
+            if (!mv_catalog_builder_add(builder, a->name, a->len,
+                    a->strs[j], strlen(a->strs[j]))) {
+                mv_catalog_builder_free(builder);
+                errno = ENOMEM;
+                return 0;
+            }
+        }
+    }
+    int ok = mv_catalog_builder_write(builder, path);
+    int saved = errno;
+    mv_catalog_builder_free(builder);
+    errno = saved;
+    return ok;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/serialize.h"
+
+#include <string.h>
+
+#include "arena.h"
+#include "byte-order.h"
+#include "comparable-version.h"
+#include "shared-version.h"
+
+/*
+ * Record layout (little endian):
+ *
+ *   0  "MVN" and the format version
+ *   4  u32 size of the record, a multiple of 8
+ *   8  i32 major, minor, incremental and build
+ *  24  u32 flags (kHasOrdinal)
+ *  28  u32 length of the version string
+ *  32  u64 ordinal hi, lo
+ *  48  u32 length of the qualifier
+ *  52  u32 reserved, zero
+ *  56  the comparable image (see comparable-version.c), the qualifier and the
+ *      version string, each NUL-terminated, and zero padding
+ *
+ * New formats bump the version and keep reading the old ones.
+ */
+#define kFormatVersion 1
+#define kHeaderSize 56
+#define kHasOrdinal 1
+
+static const unsigned char kMagic[3] = { 'M', 'V', 'N' };
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t) 7;
+}
+
+size_t mv_serialize(const struct maven_version *version, void *buf,
+        size_t size) {
+    struct comparable_version *comparable = mv_internal_comparable(version);
+    if (!comparable) {
+        return 0;
+    }
+    size_t qualifier_len = strlen(version->qualifier);
+    size_t image_size = mv_internal_image_size(comparable);
+    size_t record_size = align8(kHeaderSize + image_size + qualifier_len + 1
+        + version->len + 1);
+    if (record_size > size) {
+        return record_size;
+    }
+
+    unsigned char *out = (unsigned char*) buf;
+    memset(out, 0, record_size);
+    memcpy(out, kMagic, sizeof(kMagic));
+    out[3] = kFormatVersion;
+    mv_internal_put_u32(out + 4, record_size);
+    mv_internal_put_u32(out + 8, (uint32_t) version->major);
+    mv_internal_put_u32(out + 12, (uint32_t) version->minor);
+    mv_internal_put_u32(out + 16, (uint32_t) version->incremental);
+    mv_internal_put_u32(out + 20, (uint32_t) version->build);
+    mv_internal_put_u32(out + 24, version->has_ordinal ? kHasOrdinal : 0);
+    mv_internal_put_u32(out + 28, version->len);
+    mv_internal_put_u64(out + 32, version->ordinal.hi);
+    mv_internal_put_u64(out + 40, version->ordinal.lo);
+    mv_internal_put_u32(out + 48, qualifier_len);
+
+    out += kHeaderSize;
+    mv_internal_write_image(comparable, out);
+    out += image_size;
+    memcpy(out, version->qualifier, qualifier_len);
+    out += qualifier_len + 1;
+    memcpy(out, version->version, version->len);
+
+    return record_size;
+}
+
+/* The fields of a well-formed record */
+struct record {
+    size_t size;
+    int components[4];
+    int has_ordinal;
+    struct ordinal ordinal;
+    const unsigned char *image;
+    const char *qualifier;
+    size_t qualifier_len;
+    const char *version;
+    size_t len;
+};
+
+/* @return whether `buf` starts with a well-formed record */
+static int check_record(const unsigned char *buf, size_t len,
+        struct record *r) {
+    if (len < kHeaderSize || memcmp(buf, kMagic, sizeof(kMagic)) != 0
+            || buf[3] != kFormatVersion) {
+        return 0;
+    }
+    r->size = mv_internal_get_u32(buf + 4);
+    if (r->size > len || r->size % 8 != 0 || r->size < kHeaderSize) {
+        return 0;
+    }
+
+    int i;
+    for (i = 0; i < 4; ++i) {
+        r->components[i] = (int32_t) mv_internal_get_u32(buf + 8 + 4 * i);
+        if (r->components[i] < -1) {
+            return 0;
+        }
+    }
+    uint32_t flags = mv_internal_get_u32(buf + 24);
+    if (flags & ~kHasOrdinal) {
+        return 0;
+    }
+    r->has_ordinal = flags & kHasOrdinal;
+    r->len = mv_internal_get_u32(buf + 28);
+    r->ordinal.hi = mv_internal_get_u64(buf + 32);
+    r->ordinal.lo = mv_internal_get_u64(buf + 40);
+    r->qualifier_len = mv_internal_get_u32(buf + 48);
+
+    /* The strings are checked against what remains, so nothing overflows */
+    size_t offset = kHeaderSize;
+    size_t image_size = mv_internal_check_image(buf + offset,
+        r->size - offset);
+    if (!image_size) {
+        return 0;
+    }
+    r->image = buf + offset;
+    offset += image_size;
+
+    if (r->qualifier_len >= r->size - offset) {
+        return 0;
+    }
+    r->qualifier = (const char*) buf + offset;
+    if (memchr(r->qualifier, '\0', r->qualifier_len + 1)
+            != r->qualifier + r->qualifier_len) {
+        return 0;
+    }
+    offset += r->qualifier_len + 1;
+
+    if (r->len >= r->size - offset) {
+        return 0;
+    }
+    r->version = (const char*) buf + offset;
+    return r->version[r->len] == '\0';
+}
+
+struct maven_version* mv_deserialize(const void *buf, size_t len) {
+    struct record r;
+    if (!check_record((const unsigned char*) buf, len, &r)) {
+        return NULL;
+    }
+
+    const struct mv_allocator *allocator = &mv_internal_allocator;
+    struct maven_version *ret = mv_internal_alloc_version(r.version, r.len,
+        r.qualifier_len, allocator);
+    if (!ret) {
+        return NULL;
+    }
+    ret->comparable = mv_internal_read_image(r.image, allocator);
+    if (!ret->comparable) {
+        mv_free(ret);
+        return NULL;
+    }
+    ret->major = r.components[0];
+    ret->minor = r.components[1];
+    ret->incremental = r.components[2];
+    ret->build = r.components[3];
+    ret->has_ordinal = r.has_ordinal;
+    ret->ordinal = r.ordinal;
+    memcpy(ret->qualifier, r.qualifier, r.qualifier_len);
+    return ret;
+}
+
+size_t mv_view_init(struct mv_version_view *view, const void *buf,
+        size_t len) {
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    /* Images are only in the in-memory layout on little-endian hosts */
+    (void) view;
+    (void) buf;
+    (void) len;
+    return 0;
+#else
+    struct record r;
+    if ((uintptr_t) buf % 8 != 0
+            || !check_record((const unsigned char*) buf, len, &r)) {
+        return 0;
+    }
+
+    view->major = r.components[0];
+    view->minor = r.components[1];
+    view->incremental = r.components[2];
+    view->build = r.components[3];
+    view->qualifier = r.qualifier;
+    view->version = r.version;
+    view->len = r.len;
+    view->comparable = r.image;
+    view->has_ordinal = r.has_ordinal;
+    view->ordinal[0] = r.ordinal.hi;
+    view->ordinal[1] = r.ordinal.lo;
+    return r.size;
+#endif
+}
+
+static int compare_u64(uint64_t a, uint64_t b) {
+    return a < b ? -1 : a > b;
+}
+
+int mv_view_compare(const struct mv_version_view *a,
+        const struct mv_version_view *b) {
+    if (a->has_ordinal && b->has_ordinal) {
+        if (a->ordinal[0] != b->ordinal[0]) {
+            return compare_u64(a->ordinal[0], b->ordinal[0]);
+        }
+        return compare_u64(a->ordinal[1], b->ordinal[1]);
+    }
+    return mv_internal_compare(
+        (const struct comparable_version*) a->comparable,
+        (const struct comparable_version*) b->comparable);
+}
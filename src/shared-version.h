@@ -0,0 +1,84 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHARED_VERSION_H_
+#define SHARED_VERSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct comparable_version;
+struct mv_allocator;
+
+/*
+ * Versions of the form X[.Y[.Z]][-N] order exactly like the tuple (X, Y, Z, N)
+ * with missing components as zero, so they carry that tuple packed into two
+ * words and compare without walking the comparable items.
+ */
+struct ordinal {
+    uint64_t hi; /* X << 32 | Y */
+    uint64_t lo; /* Z << 32 | N */
+};
+
+struct maven_version {
+    int major;
+    int minor;
+    int incremental;
+    int build;
+    int has_ordinal;
+    unsigned refs; /* More than one only for shared (cached) versions */
+    struct ordinal ordinal;
+    const struct mv_allocator *allocator;
+    struct comparable_version *comparable; /* Built on first use */
+    const char *version;                   /* Follows the qualifier */
+    size_t len;
+    size_t size;                           /* Of the allocation */
+    char qualifier[0];
+};
+
+/*
+ * Allocates a version holding a copy of `version` and room for a qualifier
+ * of `qualifier_len` bytes, with every component unset.
+ */
+struct maven_version* mv_internal_alloc_version(const char *version,
+    size_t len, size_t qualifier_len, const struct mv_allocator *allocator);
+
+/*
+ * Returns the comparable form of `version`, building it on first use.
+ *
+ * @return the comparable form, or NULL if it could not be allocated
+ */
+struct comparable_version* mv_internal_comparable(
+    const struct maven_version *version);
+
+/* Adds a reference to `version`, which `mv_free` releases */
+struct maven_version* mv_internal_retain(struct maven_version *version);
+
+/* `mv_is_release`, for a version that has not been parsed */
+int mv_internal_is_release_version(const char *version, size_t len);
+
+/* `mv_is_snapshot`, for a version that has not been parsed */
+int mv_internal_is_snapshot(const char *version, size_t len);
+
+/* The string that `version` was parsed from, which is not NUL-terminated */
+const char* mv_internal_version_string(const struct maven_version *version,
+    size_t *len);
+
+#endif /* SHARED_VERSION_H_ */
@@ -0,0 +1,284 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "c-maven-utils/version-cache.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "arena.h"
+#include "hash.h"
+#include "shared-version.h"
+
+/*
+ * Each shard is a chained hash table over a fixed array of slots, which the
+ * CLOCK hand sweeps for a victim once they are all in use. The cache holds
+ * one reference to every version in it, and hands out another with each
+ * lookup, so an evicted version lives on until its last user frees it.
+ */
+
+/* Upper bound on the number of shards; a power of two */
+#define kMaxShards 64
+
+/* Shards are not split below this many slots, so that CLOCK has room to work */
+#define kMinShardCapacity 16
+
+/* Marks the end of a hash chain */
+#define kNone UINT32_MAX
+
+struct slot {
+    struct maven_version *version;
+    uint64_t hash;
+    uint32_t next;  /* Next slot in the hash chain */
+    int referenced; /* Looked up since the hand last passed */
+};
+
+struct shard {
+    pthread_mutex_t lock;
+    struct slot *slots;
+    uint32_t *buckets;
+    size_t capacity;
+    size_t count;
+    size_t hand;
+    size_t nbuckets; /* A power of two */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} __attribute__((aligned(64))); /* Keep shards off each other's lines */
+
+struct maven_version_cache {
+    size_t nshards;
+    struct shard shards[0];
+};
+
+static size_t cache_size(size_t nshards) {
+    return sizeof(struct maven_version_cache)
+        + nshards * sizeof(struct shard);
+}
+
+static int init_shard(struct shard *shard, size_t capacity) {
+    memset(shard, 0, sizeof(*shard));
+    shard->capacity = capacity;
+    shard->nbuckets = 1;
+    while (shard->nbuckets < capacity) {
+        shard->nbuckets <<= 1;
+    }
+
+    shard->slots = (struct slot*) mv_internal_alloc(&mv_internal_allocator,
+        capacity * sizeof(struct slot));
+    shard->buckets = (uint32_t*) mv_internal_alloc(&mv_internal_allocator,
+        shard->nbuckets * sizeof(uint32_t));
+    if (!shard->slots || !shard->buckets) {
+        return 0;
+    }
+    memset(shard->buckets, 0xff, shard->nbuckets * sizeof(uint32_t));
+    pthread_mutex_init(&shard->lock, NULL);
+    return 1;
+}
+
+static void release_shard(struct shard *shard) {
+    size_t i;
+    for (i = 0; i < shard->count; ++i) {
+        mv_free(shard->slots[i].version);
+    }
+    if (shard->slots) {
+        mv_internal_free(&mv_internal_allocator, shard->slots,
+            shard->capacity * sizeof(struct slot));
+    }
+    if (shard->buckets) {
+        mv_internal_free(&mv_internal_allocator, shard->buckets,
+            shard->nbuckets * sizeof(uint32_t));
+    }
+    if (shard->slots && shard->buckets) {
+        pthread_mutex_destroy(&shard->lock);
+    }
+}
+
+struct maven_version_cache* mv_cache_create(size_t capacity) {
+    if (capacity == 0) {
+        capacity = 1;
+    }
+    if (capacity > (size_t) kNone - 1) {
+        capacity = (size_t) kNone - 1;
+    }
+    size_t nshards = 1;
+    while (nshards < kMaxShards
+            && nshards * 2 * kMinShardCapacity <= capacity) {
+        nshards *= 2;
+    }
+
+    struct maven_version_cache *cache = (struct maven_version_cache*)
+        mv_internal_alloc(&mv_internal_allocator, cache_size(nshards));
+    if (!cache) {
+        return NULL;
+    }
+    memset(cache, 0, cache_size(nshards));
+
+    size_t i;
+    for (i = 0; i < nshards; ++i) {
+        /* Spread the remainder over the first shards */
+        size_t share = capacity / nshards + (i < capacity % nshards);
+        cache->nshards = i + 1;
+        if (!init_shard(&cache->shards[i], share)) {
+            mv_cache_free(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void mv_cache_free(struct maven_version_cache *cache) {
+    size_t i;
+    for (i = 0; i < cache->nshards; ++i) {
+        release_shard(&cache->shards[i]);
+    }
+    mv_internal_free(&mv_internal_allocator, cache,
+        cache_size(cache->nshards));
+}
+
+/* @return the slot holding the version for `buf`, or kNone */
+static uint32_t lookup(const struct shard *shard, uint64_t hash,
+        const char *buf, size_t len) {
+    uint32_t i = shard->buckets[hash & (shard->nbuckets - 1)];
+    for (; i != kNone; i = shard->slots[i].next) {
+        const struct slot *slot = &shard->slots[i];
+        if (slot->hash != hash) {
+            continue;
+        }
+        size_t slen;
+        const char *str = mv_internal_version_string(slot->version, &slen);
+        if (slen == len && memcmp(str, buf, len) == 0) {
+            return i;
+        }
+    }
+    return kNone;
+}
+
+static void unlink_slot(struct shard *shard, uint32_t i) {
+    uint32_t *link = &shard->buckets[
+        shard->slots[i].hash & (shard->nbuckets - 1)];
+    while (*link != i) {
+        link = &shard->slots[*link].next;
+    }
+    *link = shard->slots[i].next;
+}
+
+/*
+ * Finds a slot for a new version, evicting the first one the hand reaches
+ * that has not been referenced since it last passed.
+ *
+ * @return the slot; `evicted` receives the version it held, if any
+ */
+static uint32_t claim_slot(struct shard *shard,
+        struct maven_version **evicted) {
+    *evicted = NULL;
+    if (shard->count < shard->capacity) {
+        return (uint32_t) shard->count++;
+    }
+
+    for (;;) {
+        struct slot *slot = &shard->slots[shard->hand];
+        if (!slot->referenced) {
+            break;
+        }
+        slot->referenced = 0;
+        shard->hand = (shard->hand + 1) % shard->capacity;
+    }
+
+    uint32_t i = (uint32_t) shard->hand;
+    shard->hand = (shard->hand + 1) % shard->capacity;
+    unlink_slot(shard, i);
+    *evicted = shard->slots[i].version;
+    ++shard->evictions;
+    return i;
+}
+
+struct maven_version* mv_cache_parse_n(struct maven_version_cache *cache,
+        const char *buf, size_t len) {
+    uint64_t hash = mv_internal_hash(buf, len);
+    struct shard *shard = &cache->shards[
+        (hash >> 32) & (cache->nshards - 1)];
+
+    pthread_mutex_lock(&shard->lock);
+    uint32_t i = lookup(shard, hash, buf, len);
+    if (i != kNone) {
+        struct slot *slot = &shard->slots[i];
+        slot->referenced = 1;
+        ++shard->hits;
+        struct maven_version *ret = mv_internal_retain(slot->version);
+        pthread_mutex_unlock(&shard->lock);
+        return ret;
+    }
+    ++shard->misses;
+    pthread_mutex_unlock(&shard->lock);
+
+    /* Parse outside the lock; another thread may beat us to inserting it */
+    struct maven_version *version = mv_parse_n(buf, len);
+    if (!version) {
+        return NULL;
+    }
+
+    struct maven_version *evicted = NULL;
+    pthread_mutex_lock(&shard->lock);
+    i = lookup(shard, hash, buf, len);
+    if (i != kNone) {
+        struct maven_version *ret = mv_internal_retain(
+            shard->slots[i].version);
+        pthread_mutex_unlock(&shard->lock);
+        mv_free(version);
+        return ret;
+    }
+
+    i = claim_slot(shard, &evicted);
+    struct slot *slot = &shard->slots[i];
+    size_t bucket = hash & (shard->nbuckets - 1);
+    slot->version = version;
+    slot->hash = hash;
+    slot->referenced = 0;
+    slot->next = shard->buckets[bucket];
+    shard->buckets[bucket] = i;
+    mv_internal_retain(version);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (evicted) {
+        mv_free(evicted);
+    }
+    return version;
+}
+
+struct maven_version* mv_cache_parse(struct maven_version_cache *cache,
+        const char *str) {
+    return mv_cache_parse_n(cache, str, strlen(str));
+}
+
+void mv_cache_stats(struct maven_version_cache *cache,
+        struct mv_cache_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    size_t i;
+    for (i = 0; i < cache->nshards; ++i) {
+        struct shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->size += shard->count;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/version-cache.h"
+
+TEST(CacheTest, HitsAndMisses) {
+    auto *cache = mv_cache_create(16);
+    ASSERT_TRUE(cache != nullptr);
+
+    auto *a = mv_cache_parse(cache, "1.2.3-SNAPSHOT");
+    auto *b = mv_cache_parse(cache, "1.2.3-SNAPSHOT");
+    auto *c = mv_cache_parse_n(cache, "1.2.3-SNAPSHOT-extra", 14);
+    auto *d = mv_cache_parse(cache, "1.2.3");
+    ASSERT_TRUE(a != nullptr);
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(a, c);
+    ASSERT_NE(a, d);
+    ASSERT_EQ(2, mv_minor(a));
+    ASSERT_STREQ("SNAPSHOT", mv_qualifier(a));
+    ASSERT_LT(mv_compare(a, d), 0);
+
+    struct mv_cache_stats stats;
+    mv_cache_stats(cache, &stats);
+    ASSERT_EQ(2u, stats.hits);
+    ASSERT_EQ(2u, stats.misses);
+    ASSERT_EQ(0u, stats.evictions);
+    ASSERT_EQ(2u, stats.size);
+
+    mv_free(a);
+    mv_free(b);
+    mv_free(c);
+    mv_free(d);
+    mv_cache_free(cache);
+}
+
+TEST(CacheTest, Eviction) {
+    auto *cache = mv_cache_create(1);
+    ASSERT_TRUE(cache != nullptr);
+
+    // Evicted versions stay valid while referenced
+    auto *a = mv_cache_parse(cache, "1.0");
+    auto *b = mv_cache_parse(cache, "2.0");
+    struct mv_cache_stats stats;
+    mv_cache_stats(cache, &stats);
+    ASSERT_EQ(1u, stats.evictions);
+    ASSERT_EQ(1u, stats.size);
+    ASSERT_EQ(1, mv_major(a));
+    ASSERT_LT(mv_compare(a, b), 0);
+
+    auto *c = mv_cache_parse(cache, "1.0");
+    ASSERT_NE(a, c);
+    ASSERT_EQ(0, mv_compare(a, c));
+    mv_free(a);
+    mv_free(b);
+
+    // And outlive the cache
+    mv_cache_free(cache);
+    ASSERT_EQ(1, mv_major(c));
+    mv_free(c);
+}
+
+TEST(CacheTest, ClockKeepsReferencedVersions) {
+    auto *cache = mv_cache_create(4);
+    ASSERT_TRUE(cache != nullptr);
+
+    std::vector<std::string> strs;
+    for (int i = 0; i < 64; ++i) {
+        strs.push_back("1." + std::to_string(i));
+    }
+    for (auto const& str : strs) {
+        mv_free(mv_cache_parse(cache, "9.9"));
+        mv_free(mv_cache_parse(cache, str.c_str()));
+    }
+
+    struct mv_cache_stats stats;
+    mv_cache_stats(cache, &stats);
+    ASSERT_LE(stats.size, 4u);
+    ASSERT_EQ(stats.hits + stats.misses, 128u);
+    ASSERT_EQ(stats.misses - stats.size, stats.evictions);
+    // "9.9" is looked up between every insert, so it is never evicted
+    ASSERT_EQ(63u, stats.hits);
+
+    mv_cache_free(cache);
+}
+
+TEST(CacheTest, Threads) {
+    auto *cache = mv_cache_create(64);
+    ASSERT_TRUE(cache != nullptr);
+
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                std::string str = std::to_string((i * 7 + t) % 100)
+                    + ".0-rc" + std::to_string(i % 3);
+                auto *v = mv_cache_parse(cache, str.c_str());
+                auto *expected = mv_parse(str.c_str());
+                if (mv_compare(v, expected) != 0) {
+                    ++mismatches;
+                }
+                mv_free(expected);
+                mv_free(v);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0, mismatches.load());
+
+    struct mv_cache_stats stats;
+    mv_cache_stats(cache, &stats);
+    ASSERT_EQ(16000u, stats.hits + stats.misses);
+    ASSERT_LE(stats.size, 64u);
+
+    mv_cache_free(cache);
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/catalog.h"
+#include "c-maven-utils/maven-version.h"
+
+namespace {
+
+class CatalogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = testing::TempDir() + "catalog-test-" + std::to_string(
+            ::testing::UnitTest::GetInstance()->random_seed()) + ".cat";
+        builder_ = mv_catalog_builder_create();
+        ASSERT_TRUE(builder_);
+    }
+
+    void TearDown() override {
+        mv_catalog_builder_free(builder_);
+        std::remove(path_.c_str());
+    }
+
+    void add(std::string const& artifact, std::string const& version) {
+        ASSERT_TRUE(mv_catalog_builder_add(builder_, artifact.data(),
+            artifact.size(), version.data(), version.size()));
+    }
+
+    struct maven_catalog* write() {
+        EXPECT_TRUE(mv_catalog_builder_write(builder_, path_.c_str()));
+        return mv_catalog_open(path_.c_str());
+    }
+
+    static std::vector<std::string> versions(
+            struct mv_catalog_artifact const& artifact) {
+        std::vector<std::string> ret;
+        for (size_t i = 0; i < artifact.count; ++i) {
+            size_t len;
+            const char *str = mv_catalog_version(&artifact, i, &len);
+            EXPECT_TRUE(str);
+            EXPECT_EQ(len, strlen(str));
+            ret.emplace_back(str, len);
+        }
+        return ret;
+    }
+
+    std::string path_;
+    struct maven_catalog_builder *builder_;
+};
+
+} // anonymous namespace
+
+TEST_F(CatalogTest, Queries) {
+    add("org.example:lib", "1.10");
+    add("org.example:lib", "1.2-SNAPSHOT");
+    add("org.example:app", "2.0");
+    add("org.example:lib", "1.2");
+    add("org.example:lib", "1.2-beta-1");
+    add("org.example:lib", "1.10");
+    add("org.example:lib", "1.2.0");
+    add("org.example:app", "2.0-rc1");
+
+    auto *catalog = write();
+    ASSERT_TRUE(catalog);
+    ASSERT_EQ(2u, mv_catalog_size(catalog));
+
+    struct mv_catalog_artifact artifact;
+    ASSERT_TRUE(mv_catalog_artifact_at(catalog, 0, &artifact));
+    ASSERT_STREQ("org.example:app", artifact.name);
+    ASSERT_FALSE(mv_catalog_artifact_at(catalog, 2, &artifact));
+    ASSERT_FALSE(mv_catalog_find(catalog, "org.example:none", 16,
+        &artifact));
+
+    ASSERT_TRUE(mv_catalog_find(catalog, "org.example:lib", 15, &artifact));
+    // Sorted, without the repeated string but with both equal spellings
+    ASSERT_EQ(std::vector<std::string>({ "1.2-beta-1", "1.2-SNAPSHOT",
+        "1.2", "1.2.0", "1.10" }), versions(artifact));
+
+    size_t len;
+    ASSERT_STREQ("1.10", mv_catalog_latest(&artifact, &len));
+    ASSERT_EQ(4u, len);
+
+    ASSERT_EQ(2u, mv_catalog_lower_bound(&artifact, "1.2", 3));
+    ASSERT_EQ(4u, mv_catalog_upper_bound(&artifact, "1.2", 3));
+    ASSERT_STREQ("1.10", mv_catalog_version(&artifact,
+        mv_catalog_upper_bound(&artifact, "1.2", 3), &len));
+    ASSERT_EQ(0u, mv_catalog_upper_bound(&artifact, "1.0", 3));
+    ASSERT_EQ(5u, mv_catalog_upper_bound(&artifact, "1.10", 4));
+    ASSERT_FALSE(mv_catalog_version(&artifact, 5, &len));
+
+    ASSERT_TRUE(mv_catalog_contains(&artifact, "1.2.0.0-ga", 10));
+    ASSERT_TRUE(mv_catalog_contains(&artifact, "1.2-snapshot", 12));
+    ASSERT_FALSE(mv_catalog_contains(&artifact, "1.3", 3));
+
+    // Long versions have keys too long for the stack
+    std::string long_version = "1.2-" + std::string(300, 'q');
+    ASSERT_FALSE(mv_catalog_contains(&artifact, long_version.data(),
+        long_version.size()));
+    ASSERT_EQ(4u, mv_catalog_lower_bound(&artifact, long_version.data(),
+        long_version.size()));
+
+    // Queries whose key cannot be allocated fail instead of guessing
+    struct mv_allocator failing = {
+        [](void*, size_t) -> void* { return nullptr; },
+        [](void*, void*, size_t) {},
+        nullptr
+    };
+    mv_set_allocator(&failing);
+    errno = 0;
+    size_t lower = mv_catalog_lower_bound(&artifact, long_version.data(),
+        long_version.size());
+    int lower_errno = errno;
+    size_t upper = mv_catalog_upper_bound(&artifact, long_version.data(),
+        long_version.size());
+    int contains = mv_catalog_contains(&artifact, long_version.data(),
+        long_version.size());
+    mv_set_allocator(NULL);
+    ASSERT_EQ((size_t) -1, lower);
+    ASSERT_EQ(ENOMEM, lower_errno);
+    ASSERT_EQ((size_t) -1, upper);
+    ASSERT_EQ(-1, contains);
+
+    mv_catalog_close(catalog);
+}
+
+TEST_F(CatalogTest, Empty) {
+    auto *catalog = write();
+    ASSERT_TRUE(catalog);
+    ASSERT_EQ(0u, mv_catalog_size(catalog));
+    struct mv_catalog_artifact artifact;
+    ASSERT_FALSE(mv_catalog_find(catalog, "a", 1, &artifact));
+    mv_catalog_close(catalog);
+
+    ASSERT_FALSE(mv_catalog_open((path_ + ".missing").c_str()));
+}
+
+TEST_F(CatalogTest, ManyArtifacts) {
+    for (int i = 0; i < 300; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            add("g:a" + std::to_string(i),
+                std::to_string(j % 7) + "." + std::to_string(j));
+        }
+    }
+    auto *catalog = write();
+    ASSERT_TRUE(catalog);
+    ASSERT_EQ(300u, mv_catalog_size(catalog));
+    for (int i = 0; i < 300; ++i) {
+        std::string name = "g:a" + std::to_string(i);
+        struct mv_catalog_artifact artifact;
+        ASSERT_TRUE(mv_catalog_find(catalog, name.data(), name.size(),
+            &artifact)) << name;
+        ASSERT_EQ(20u, artifact.count);
+        auto listed = versions(artifact);
+        for (size_t j = 1; j < listed.size(); ++j) {
+            ASSERT_LT(mv_compare_str(listed[j - 1].c_str(),
+                listed[j].c_str()), 0);
+        }
+        size_t len;
+        ASSERT_STREQ("6.13", mv_catalog_latest(&artifact, &len));
+    }
+    mv_catalog_close(catalog);
+}
+
+TEST_F(CatalogTest, Corrupt) {
+    add("g:a", "1.0");
+    add("g:a", "2.0-alpha");
+    add("g:b", "3");
+    auto *catalog = write();
+    ASSERT_TRUE(catalog);
+    mv_catalog_close(catalog);
+
+    std::ifstream in(path_, std::ios::binary);
+    std::string good((std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>());
+    in.close();
+
+    auto rewrite = [&](std::string const& contents) {
+        std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+        out << contents;
+    };
+
+    // Truncated files are rejected up front
+    rewrite(good.substr(0, good.size() - 1));
+    ASSERT_FALSE(mv_catalog_open(path_.c_str()));
+    rewrite(good.substr(0, 10));
+    ASSERT_FALSE(mv_catalog_open(path_.c_str()));
+
+    // Anything else never reads outside the file
+    for (size_t i = 0; i < good.size(); ++i) {
+        std::string bad = good;
+        bad[i] ^= 0x41;
+        rewrite(bad);
+        catalog = mv_catalog_open(path_.c_str());
+        if (!catalog) {
+            continue;
+        }
+        struct mv_catalog_artifact artifact;
+        for (size_t j = 0; mv_catalog_artifact_at(catalog, j, &artifact);
+                ++j) {
+            size_t len;
+            for (size_t k = 0; k < artifact.count; ++k) {
+                mv_catalog_version(&artifact, k, &len);
+            }
+            mv_catalog_contains(&artifact, "2.0", 3);
+        }
+        mv_catalog_find(catalog, "g:b", 3, &artifact);
+        mv_catalog_close(catalog);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "c-maven-utils/cpp/maven-version.h"
+
+static_assert(std::is_nothrow_move_constructible<mvn::Version>::value,
+    "versions must move without throwing");
+static_assert(std::is_nothrow_move_assignable<mvn::Version>::value,
+    "versions must move without throwing");
+
+TEST(CppVersionTest, Components) {
+    mvn::Version v("1.2.3-SNAPSHOT");
+    ASSERT_EQ("1.2.3-SNAPSHOT", v.original());
+    ASSERT_STREQ("1.2.3-SNAPSHOT", v.c_str());
+    ASSERT_EQ(1, v.major());
+    ASSERT_EQ(2, v.minor());
+    ASSERT_EQ(3, v.incremental());
+    ASSERT_EQ(-1, v.build());
+    ASSERT_EQ("SNAPSHOT", v.qualifier());
+
+    mvn::Version w(std::string_view("4-7 trailing", 3));
+    ASSERT_EQ("4-7", w.original());
+    ASSERT_EQ(4, w.major());
+    ASSERT_EQ(7, w.build());
+    ASSERT_EQ("", w.qualifier());
+}
+
+TEST(CppVersionTest, Ordering) {
+    mvn::Version v1("1.0");
+    mvn::Version v2("2.0-alpha");
+    mvn::Version v3("2.0");
+    ASSERT_LT(v1, v2);
+    ASSERT_LT(v2, v3);
+    ASSERT_GT(v3, v1);
+    ASSERT_LE(v1, v1);
+    ASSERT_NE(v1, v3);
+
+    // Equivalent spellings are equal, but keep their own strings
+    mvn::Version v4("1.0.0-ga");
+    ASSERT_EQ(v1, v4);
+    ASSERT_EQ("1.0.0-ga", v4.original());
+
+    std::vector<mvn::Version> versions;
+    for (auto const *str : { "1.10", "1.2-rc1", "1.2", "1.2-SNAPSHOT",
+            "1.2-beta", "1.1" }) {
+        versions.emplace_back(str);
+    }
+    std::sort(versions.begin(), versions.end());
+    std::vector<std::string> sorted;
+    for (auto const& v : versions) {
+        sorted.emplace_back(v.original());
+    }
+    ASSERT_EQ(std::vector<std::string>({ "1.1", "1.2-beta", "1.2-rc1",
+        "1.2-SNAPSHOT", "1.2", "1.10" }), sorted);
+}
+
+TEST(CppVersionTest, Hash) {
+    std::hash<mvn::Version> hash;
+    ASSERT_EQ(hash(mvn::Version("1")), hash(mvn::Version("1.0.0")));
+
+    std::unordered_set<mvn::Version> set;
+    set.emplace("1.0");
+    set.emplace("1");
+    set.emplace("1.0-final");
+    set.emplace("1.1");
+    ASSERT_EQ(2u, set.size());
+    ASSERT_EQ(1u, set.count(mvn::Version("1.1.0")));
+}
+
+TEST(CppVersionTest, CopyAndMove) {
+    // Short versions are stored inline, long ones on the heap
+    std::string long_str = "1.2.3-" + std::string(200, 'q');
+    for (auto const& str : { std::string("1.2"), long_str }) {
+        mvn::Version v(str);
+        mvn::Version copy(v);
+        ASSERT_EQ(v, copy);
+        ASSERT_EQ(str, copy.original());
+        ASSERT_NE(v.c_str(), copy.c_str());
+
+        mvn::Version moved(std::move(copy));
+        ASSERT_EQ(str, moved.original());
+
+        mvn::Version assigned("0");
+        assigned = moved;
+        ASSERT_EQ(str, assigned.original());
+        assigned = mvn::Version("7");
+        ASSERT_EQ("7", assigned.original());
+        assigned = std::move(moved);
+        ASSERT_EQ(str, assigned.original());
+        ASSERT_EQ(2, assigned.minor());
+    }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "c-maven-utils/latest.h"
+
+namespace {
+
+class LatestTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        latest_ = mv_latest_create();
+        ASSERT_TRUE(latest_);
+    }
+
+    void TearDown() override {
+        mv_latest_free(latest_);
+    }
+
+    static void add(struct maven_latest *latest, std::string const& artifact,
+            std::string const& version) {
+        ASSERT_TRUE(mv_latest_add(latest, artifact.data(), artifact.size(),
+            version.data(), version.size()));
+    }
+
+    void add(std::string const& artifact, std::string const& version) {
+        add(latest_, artifact, version);
+    }
+
+    static std::string str(const char *s, size_t len) {
+        return s ? std::string(s, len) : "-";
+    }
+
+    struct maven_latest *latest_;
+};
+
+TEST_F(LatestTest, Empty) {
+    struct mv_latest_entry entry;
+    EXPECT_EQ(0u, mv_latest_size(latest_));
+    EXPECT_FALSE(mv_latest_at(latest_, 0, &entry));
+}
+
+TEST_F(LatestTest, Kinds) {
+    add("g:a", "1.0");
+    add("g:a", "1.10-SNAPSHOT");
+    add("g:a", "1.2");
+    add("g:a", "1.9-beta-1");
+    add("g:a", "1.1-20150101.120000-3");
+    add("g:b", "2.0-SNAPSHOT");
+    add("g:c", "3.0-rc1");
+
+    ASSERT_EQ(3u, mv_latest_size(latest_));
+    struct mv_latest_entry entry;
+    ASSERT_TRUE(mv_latest_at(latest_, 0, &entry));
+    EXPECT_EQ("g:a", std::string(entry.artifact, entry.artifact_len));
+    EXPECT_EQ(5u, entry.count);
+    EXPECT_EQ("1.10-SNAPSHOT", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("1.2", str(entry.release, entry.release_len));
+    EXPECT_EQ("1.10-SNAPSHOT", str(entry.snapshot, entry.snapshot_len));
+    EXPECT_EQ('\0', entry.latest[entry.latest_len]);
+
+    ASSERT_TRUE(mv_latest_at(latest_, 1, &entry));
+    EXPECT_EQ("g:b", std::string(entry.artifact));
+    EXPECT_EQ("2.0-SNAPSHOT", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("-", str(entry.release, entry.release_len));
+    EXPECT_EQ("2.0-SNAPSHOT", str(entry.snapshot, entry.snapshot_len));
+
+    ASSERT_TRUE(mv_latest_at(latest_, 2, &entry));
+    EXPECT_EQ("3.0-rc1", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("-", str(entry.release, entry.release_len));
+    EXPECT_EQ("-", str(entry.snapshot, entry.snapshot_len));
+}
+
+TEST_F(LatestTest, Ties) {
+    add("g:a", "1.0");
+    add("g:a", "1.0.0");
+    add("g:a", "1-ga");
+
+    struct mv_latest_entry entry;
+    ASSERT_TRUE(mv_latest_at(latest_, 0, &entry));
+    EXPECT_EQ(3u, entry.count);
+    EXPECT_EQ("1.0", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("1.0", str(entry.release, entry.release_len));
+}
+
+TEST_F(LatestTest, Merge) {
+    struct maven_latest *other = mv_latest_create();
+    ASSERT_TRUE(other);
+    add("g:a", "1.0");
+    add("g:b", "1.0-SNAPSHOT");
+    add(other, "g:c", "0.1");
+    add(other, "g:b", "1.0");
+    add(other, "g:a", "1.0.0");
+    add(other, "g:a", "0.9-SNAPSHOT");
+
+    ASSERT_TRUE(mv_latest_merge(latest_, other));
+    mv_latest_free(other);
+
+    ASSERT_EQ(3u, mv_latest_size(latest_));
+    struct mv_latest_entry entry;
+    ASSERT_TRUE(mv_latest_at(latest_, 0, &entry));
+    EXPECT_EQ(3u, entry.count);
+    EXPECT_EQ("1.0", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("0.9-SNAPSHOT", str(entry.snapshot, entry.snapshot_len));
+
+    ASSERT_TRUE(mv_latest_at(latest_, 1, &entry));
+    EXPECT_EQ("1.0", str(entry.latest, entry.latest_len));
+    EXPECT_EQ("1.0", str(entry.release, entry.release_len));
+    EXPECT_EQ("1.0-SNAPSHOT", str(entry.snapshot, entry.snapshot_len));
+
+    ASSERT_TRUE(mv_latest_at(latest_, 2, &entry));
+    EXPECT_EQ("g:c", std::string(entry.artifact));
+}
+
+TEST_F(LatestTest, Many) {
+    for (int v = 0; v < 3; ++v) {
+        for (int i = 0; i < 5000; ++i) {
+            add("g:a" + std::to_string(i),
+                std::to_string(i % 7) + "." + std::to_string(v));
+        }
+    }
+    // Longer than the stack key buffer
+    add("g:a0", std::string(300, '9'));
+
+    ASSERT_EQ(5000u, mv_latest_size(latest_));
+    for (size_t i = 0; i < 5000; ++i) {
+        struct mv_latest_entry entry;
+        ASSERT_TRUE(mv_latest_at(latest_, i, &entry));
+        EXPECT_EQ("g:a" + std::to_string(i), std::string(entry.artifact));
+        if (i) {
+            EXPECT_EQ(std::to_string(i % 7) + ".2",
+                str(entry.latest, entry.latest_len));
+        } else {
+            EXPECT_EQ(std::string(300, '9'),
+                str(entry.latest, entry.latest_len));
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/metadata.h"
+
+namespace {
+
+const char *kFieldNames[] = {
+    "groupId", "artifactId", "baseVersion", "latest", "release", "version",
+    "lastUpdated", "timestamp", "buildNumber", "snapshotVersion",
+};
+
+std::string slice(const char *str, size_t len) {
+    return str ? std::string(str, len) : "(null)";
+}
+
+// Reads every field of `doc` as "field=value"
+std::vector<std::string> fields(std::string const& doc, bool *failed) {
+    std::vector<std::string> ret;
+    struct mv_metadata_parser parser;
+    struct mv_metadata_entry entry;
+    mv_metadata_init(&parser, doc.data(), doc.size());
+    while (mv_metadata_next(&parser, &entry)) {
+        EXPECT_GE(entry.value, doc.data());
+        EXPECT_LE(entry.value + entry.len, doc.data() + doc.size());
+        std::string field = kFieldNames[entry.field];
+        field += "=" + slice(entry.value, entry.len);
+        if (entry.field == MV_METADATA_SNAPSHOT_VERSION) {
+            field += " " + slice(entry.classifier, entry.classifier_len)
+                + " " + slice(entry.extension, entry.extension_len)
+                + " " + slice(entry.updated, entry.updated_len);
+        }
+        ret.push_back(field);
+    }
+    *failed = mv_metadata_failed(&parser);
+    return ret;
+}
+
+std::vector<std::string> fields(std::string const& doc) {
+    bool failed;
+    auto ret = fields(doc, &failed);
+    EXPECT_FALSE(failed) << doc;
+    return ret;
+}
+
+}
+
+TEST(MetadataTest, Artifact) {
+    const char *doc =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<metadata modelVersion=\"1.1.0\">\n"
+        "  <groupId>org.apache.maven</groupId>\n"
+        "  <artifactId>maven-core</artifactId>\n"
+        "  <versioning>\n"
+        "    <latest>4.0.0-beta-3</latest>\n"
+        "    <release>3.9.6</release>\n"
+        "    <versions>\n"
+        "      <version>3.9.5</version>\n"
+        "      <version> 3.9.6 </version>\n"
+        "      <version>4.0.0-beta-3</version>\n"
+        "    </versions>\n"
+        "    <lastUpdated>20231201093012</lastUpdated>\n"
+        "  </versioning>\n"
+        "</metadata>\n";
+    std::vector<std::string> expected = {
+        "groupId=org.apache.maven", "artifactId=maven-core",
+        "latest=4.0.0-beta-3", "release=3.9.6", "version=3.9.5",
+        "version=3.9.6", "version=4.0.0-beta-3",
+        "lastUpdated=20231201093012",
+    };
+    EXPECT_EQ(expected, fields(doc));
+}
+
+TEST(MetadataTest, Snapshot) {
+    const char *doc =
+        "<metadata>"
+        "<groupId>com.example</groupId><artifactId>lib</artifactId>"
+        "<version>1.0-SNAPSHOT</version>"
+        "<versioning>"
+        "<snapshot><timestamp>20240102.030405</timestamp>"
+        "<buildNumber>7</buildNumber></snapshot>"
+        "<lastUpdated>20240102030405</lastUpdated>"
+        "<snapshotVersions>"
+        "<snapshotVersion><extension>jar</extension>"
+        "<value>1.0-20240102.030405-7</value>"
+        "<updated>20240102030405</updated></snapshotVersion>"
+        "<snapshotVersion><classifier>sources</classifier>"
+        "<extension>jar</extension><value>1.0-20240102.030405-7</value>"
+        "</snapshotVersion>"
+        "<snapshotVersion><extension>pom</extension></snapshotVersion>"
+        "</snapshotVersions>"
+        "</versioning>"
+        "</metadata>";
+    std::vector<std::string> expected = {
+        "groupId=com.example", "artifactId=lib", "baseVersion=1.0-SNAPSHOT",
+        "timestamp=20240102.030405", "buildNumber=7",
+        "lastUpdated=20240102030405",
+        "snapshotVersion=1.0-20240102.030405-7 (null) jar 20240102030405",
+        "snapshotVersion=1.0-20240102.030405-7 sources jar (null)",
+    };
+    EXPECT_EQ(expected, fields(doc));
+}
+
+TEST(MetadataTest, Markup) {
+    const char *doc =
+        "\xEF\xBB\xBF<?xml version='1.0'?>\n"
+        "<!DOCTYPE metadata [ <!ENTITY x \"y\"> ]>\n"
+        "<!-- <version>0</version> -->\n"
+        "<m:metadata xmlns:m=\"http://maven.apache.org/METADATA/1.1.0\">\n"
+        "  <m:versioning a='>' b=\"/>\">\n"
+        "    <m:versions>\n"
+        "      <m:version><![CDATA[1.0]]></m:version>\n"
+        "      <m:version>  <!-- first --> 1.1 </m:version>\n"
+        "      <m:version/>\n"
+        "      <m:version >1.2</m:version >\n"
+        "    </m:versions>\n"
+        "    <release/>\n"
+        "  </m:versioning>\n"
+        "</m:metadata>\n";
+    std::vector<std::string> expected = {
+        "version=1.0", "version=1.1", "version=", "version=1.2",
+        "release=",
+    };
+    EXPECT_EQ(expected, fields(doc));
+}
+
+TEST(MetadataTest, OtherElements) {
+    // Only fields at their place in the schema are reported
+    const char *doc =
+        "<metadata>"
+        "<plugins><plugin><name>Compiler</name><prefix>compiler</prefix>"
+        "<artifactId>maven-compiler-plugin</artifactId></plugin></plugins>"
+        "<versioning><extra><version>9</version></extra>"
+        "<versions><version>1<b>2</b></version>"
+        "<a><b><c><d><e><f><g><h><i>x</i></h></g></f></e></d></c></b></a>"
+        "<version>2</version></versions></versioning>"
+        "<version>3</version>"
+        "</metadata>"
+        "<version>4</version>";
+    std::vector<std::string> expected = {
+        "version=1", "version=2", "baseVersion=3",
+    };
+    EXPECT_EQ(expected, fields(doc));
+
+    EXPECT_TRUE(fields("<project><version>1</version></project>").empty());
+    EXPECT_TRUE(fields("").empty());
+}
+
+TEST(MetadataTest, Malformed) {
+    const char *docs[] = {
+        "<metadata><versioning><versions><version>1.0</version>",
+        "<metadata><versioning></metadata></versioning>",
+        "<metadata><versioning><versions><version>1.0</versions>",
+        "<metadata><!-- unterminated </metadata>",
+        "<metadata><?pi </metadata>",
+        "<metadata><![CDATA[ </metadata>",
+        "<metadata><versioning x=\"></versioning></metadata>",
+        "<metadata><versioning><versions><version>1<!---->0</version>",
+        "<metadata></metadata></metadata>",
+        "<metadata>< version>1</version></metadata>",
+        "<metadata></metadata x>",
+        "<metadata",
+    };
+    for (const char *doc : docs) {
+        bool failed = false;
+        auto got = fields(doc, &failed);
+        EXPECT_TRUE(failed) << doc;
+        for (auto const& field : got) {
+            EXPECT_EQ("version=1.0", field) << doc;
+        }
+    }
+}
+
+TEST(MetadataTest, Parse) {
+    std::string doc =
+        "<metadata><versioning><versions>"
+        "<version>1.0-SNAPSHOT</version><version>1.0</version>"
+        "</versions></versioning></metadata>";
+    struct mv_metadata_parser parser;
+    struct mv_metadata_entry entry;
+    mv_metadata_init(&parser, doc.data(), doc.size());
+
+    ASSERT_TRUE(mv_metadata_next(&parser, &entry));
+    struct maven_version *v1 = mv_parse_n(entry.value, entry.len);
+    ASSERT_TRUE(mv_metadata_next(&parser, &entry));
+    struct maven_version *v2 = mv_parse_n(entry.value, entry.len);
+    EXPECT_FALSE(mv_metadata_next(&parser, &entry));
+    EXPECT_FALSE(mv_metadata_failed(&parser));
+
+    EXPECT_EQ(1, mv_major(v2));
+    EXPECT_STREQ("SNAPSHOT", mv_qualifier(v1));
+    EXPECT_GT(0, mv_compare(v1, v2));
+    mv_free(v1);
+    mv_free(v2);
+}
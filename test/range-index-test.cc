@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/maven-range.h"
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/range-index.h"
+
+namespace {
+
+void* tag(intptr_t i) {
+    return reinterpret_cast<void*>(i);
+}
+
+std::vector<intptr_t> query(struct maven_range_index *index,
+        const char *version) {
+    auto *v = mv_parse(version);
+    void *values[16];
+    size_t n = mv_range_index_query(index, v, values, 16);
+    mv_free(v);
+    std::vector<intptr_t> ret;
+    for (size_t i = 0; i < n && i < 16; ++i) {
+        ret.push_back(reinterpret_cast<intptr_t>(values[i]));
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+struct Ranges {
+    explicit Ranges(std::vector<const char*> specs) {
+        for (const char *spec : specs) {
+            ranges.push_back(mv_range_parse(spec));
+            values.push_back(tag(values.size() + 1));
+        }
+    }
+    ~Ranges() {
+        for (auto *range : ranges) {
+            mv_range_free(range);
+        }
+    }
+    std::vector<struct maven_range*> ranges;
+    std::vector<void*> values;
+};
+
+} // namespace
+
+TEST(RangeIndexTest, BuildAndQuery) {
+    Ranges r({ "[1.0,2.0)", "[1.5,3.0]", "(,1.0]", "[2.0,)", "[1.2]" });
+    auto *index = mv_range_index_build(r.ranges.data(), r.values.data(),
+        r.ranges.size());
+    ASSERT_TRUE(index != nullptr);
+    ASSERT_EQ(5u, mv_range_index_size(index));
+
+    ASSERT_EQ(std::vector<intptr_t>({ 3 }), query(index, "0.9"));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 3 }), query(index, "1"));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 5 }), query(index, "1.2"));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 2 }), query(index, "1.9"));
+    ASSERT_EQ(std::vector<intptr_t>({ 2, 4 }), query(index, "2.0"));
+    ASSERT_EQ(std::vector<intptr_t>({ 4 }), query(index, "3.0.1"));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 2 }), query(index, "2.0-SNAPSHOT"));
+
+    mv_range_index_free(index);
+}
+
+TEST(RangeIndexTest, SharedBounds) {
+    // Each range is reported once, however many of its intervals match
+    Ranges r({ "[1,2],[2,3]", "(1,1.0],[1.0]", "1.0" });
+    auto *index = mv_range_index_build(r.ranges.data(), r.values.data(),
+        r.ranges.size());
+    ASSERT_TRUE(index != nullptr);
+
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 2, 3 }), query(index, "1"));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 3 }), query(index, "2"));
+    ASSERT_EQ(std::vector<intptr_t>({ 3 }), query(index, "4"));
+
+    mv_range_index_free(index);
+}
+
+TEST(RangeIndexTest, InsertRemove) {
+    Ranges r({ "[1,2)", "[2,3)", "[1,3)", "(,1]", "[3,)" });
+    auto *index = mv_range_index_build(nullptr, nullptr, 0);
+    ASSERT_TRUE(index != nullptr);
+    ASSERT_EQ(0u, mv_range_index_size(index));
+    ASSERT_TRUE(query(index, "1").empty());
+
+    for (size_t i = 0; i < r.ranges.size(); ++i) {
+        ASSERT_TRUE(mv_range_index_insert(index, r.ranges[i], r.values[i]));
+    }
+    ASSERT_EQ(5u, mv_range_index_size(index));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 3, 4 }), query(index, "1"));
+    ASSERT_EQ(std::vector<intptr_t>({ 2, 3 }), query(index, "2.5"));
+
+    ASSERT_TRUE(mv_range_index_remove(index, r.ranges[2]));
+    ASSERT_FALSE(mv_range_index_remove(index, r.ranges[2]));
+    ASSERT_EQ(4u, mv_range_index_size(index));
+    ASSERT_EQ(std::vector<intptr_t>({ 1, 4 }), query(index, "1"));
+    ASSERT_EQ(std::vector<intptr_t>({ 2 }), query(index, "2.5"));
+
+    for (size_t i = 0; i < r.ranges.size(); ++i) {
+        if (i != 2) {
+            ASSERT_TRUE(mv_range_index_remove(index, r.ranges[i]));
+        }
+    }
+    ASSERT_EQ(0u, mv_range_index_size(index));
+    ASSERT_TRUE(query(index, "1").empty());
+
+    mv_range_index_free(index);
+}
+
+TEST(RangeIndexTest, ManyRanges) {
+    // Enough inserts in order to force rebuilds
+    std::vector<struct maven_range*> ranges;
+    auto *index = mv_range_index_build(nullptr, nullptr, 0);
+    ASSERT_TRUE(index != nullptr);
+    for (int i = 0; i < 1000; ++i) {
+        std::string spec = "[" + std::to_string(i) + ","
+            + std::to_string(i + 10) + ")";
+        ranges.push_back(mv_range_parse(spec.c_str()));
+        ASSERT_TRUE(mv_range_index_insert(index, ranges.back(), tag(i)));
+    }
+
+    std::vector<intptr_t> want;
+    for (int i = 491; i <= 500; ++i) {
+        want.push_back(i);
+    }
+    ASSERT_EQ(want, query(index, "500"));
+
+    // The count covers matches that did not fit
+    auto *v = mv_parse("500");
+    void *values[4];
+    ASSERT_EQ(10u, mv_range_index_query(index, v, values, 4));
+    mv_free(v);
+
+    mv_range_index_free(index);
+    for (auto *range : ranges) {
+        mv_range_free(range);
+    }
+}
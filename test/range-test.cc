@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "c-maven-utils/maven-range.h"
+#include "c-maven-utils/maven-version.h"
+
+namespace {
+
+bool contains(const char *spec, const char *version) {
+    auto *range = mv_range_parse(spec);
+    auto *v = mv_parse(version);
+    bool ret = mv_range_contains(range, v);
+    mv_free(v);
+    mv_range_free(range);
+    return ret;
+}
+
+} // namespace
+
+TEST(RangeTest, Recommendation) {
+    auto *range = mv_range_parse("1.0");
+    ASSERT_TRUE(range != nullptr);
+    ASSERT_EQ(1, mv_major(
+        const_cast<struct maven_version*>(mv_range_recommended(range))));
+    ASSERT_EQ(1u, mv_range_count(range));
+    ASSERT_EQ(nullptr, mv_range_lower(range, 0));
+    ASSERT_EQ(nullptr, mv_range_upper(range, 0));
+    mv_range_free(range);
+
+    ASSERT_TRUE(contains("1.0", "0.1"));
+    ASSERT_TRUE(contains("1.0", "1.0"));
+    ASSERT_TRUE(contains("1.0", "7-SNAPSHOT"));
+}
+
+TEST(RangeTest, Parsing) {
+    auto *range = mv_range_parse("(,1.0],[1.2,)");
+    ASSERT_TRUE(range != nullptr);
+    ASSERT_EQ(nullptr, mv_range_recommended(range));
+    ASSERT_EQ(2u, mv_range_count(range));
+    ASSERT_EQ(nullptr, mv_range_lower(range, 0));
+    ASSERT_FALSE(mv_range_lower_inclusive(range, 0));
+    ASSERT_EQ(1, mv_major(const_cast<struct maven_version*>(
+        mv_range_upper(range, 0))));
+    ASSERT_TRUE(mv_range_upper_inclusive(range, 0));
+    ASSERT_EQ(2, mv_minor(const_cast<struct maven_version*>(
+        mv_range_lower(range, 1))));
+    ASSERT_TRUE(mv_range_lower_inclusive(range, 1));
+    ASSERT_EQ(nullptr, mv_range_upper(range, 1));
+    mv_range_free(range);
+
+    range = mv_range_parse(" [ 1.0 , 2.0 ) , [3.0] ");
+    ASSERT_TRUE(range != nullptr);
+    ASSERT_EQ(2u, mv_range_count(range));
+    ASSERT_EQ(mv_range_lower(range, 1), mv_range_upper(range, 1));
+    mv_range_free(range);
+
+    // Adjacent intervals may share a bound
+    range = mv_range_parse("[1.0,2.0],[2.0,3.0]");
+    ASSERT_TRUE(range != nullptr);
+    mv_range_free(range);
+}
+
+TEST(RangeTest, InvalidRanges) {
+    const char *specs[] = {
+        "",
+        "  ",
+        "[1.0,2.0",
+        "(1.0)",
+        "[1.0)",
+        "[]",
+        "[,]",
+        "[1.0,1.0]",
+        "[2.0,1.0]",
+        "[1.0,1.5],[1.4,2.0]",
+        "[1.5,2.0],[1.0,1.2]",
+        "[1.0,),[2.0,3.0]",
+        "[1.0],1.5",
+    };
+    for (auto *spec : specs) {
+        EXPECT_EQ(nullptr, mv_range_parse(spec)) << spec;
+    }
+}
+
+TEST(RangeTest, Contains) {
+    ASSERT_TRUE(contains("[1.0]", "1.0"));
+    ASSERT_TRUE(contains("[1.0]", "1.0.0"));
+    ASSERT_FALSE(contains("[1.0]", "1.0.1"));
+
+    ASSERT_TRUE(contains("[1.0,2.0)", "1.0"));
+    ASSERT_TRUE(contains("[1.0,2.0)", "1.5-SNAPSHOT"));
+    ASSERT_TRUE(contains("[1.0,2.0)", "2.0-SNAPSHOT"));
+    ASSERT_FALSE(contains("[1.0,2.0)", "2.0"));
+    ASSERT_FALSE(contains("[1.0,2.0)", "1.0-alpha-1"));
+    ASSERT_FALSE(contains("(1.0,2.0]", "1.0"));
+    ASSERT_TRUE(contains("(1.0,2.0]", "2.0"));
+
+    ASSERT_TRUE(contains("(,1.0],[1.2,)", "0.9"));
+    ASSERT_TRUE(contains("(,1.0],[1.2,)", "1.0"));
+    ASSERT_FALSE(contains("(,1.0],[1.2,)", "1.1"));
+    ASSERT_TRUE(contains("(,1.0],[1.2,)", "1.2"));
+    ASSERT_TRUE(contains("(,1.0],[1.2,)", "20.1"));
+}
+
+TEST(RangeTest, Highest) {
+    const char *strs[] = {
+        "0.9", "1.0", "1.1", "1.5", "2.0-SNAPSHOT", "2.0", "2.1", "3.0",
+    };
+    size_t n = sizeof(strs) / sizeof(strs[0]);
+    std::vector<const struct maven_version*> versions;
+    for (auto *str : strs) {
+        versions.push_back(mv_parse(str));
+    }
+
+    struct {
+        const char *spec;
+        size_t expected;
+    } cases[] = {
+        { "[1.0,2.0)", 4 },
+        { "[1.0,2.0]", 5 },
+        { "[1.0,1.5)", 2 },
+        { "(,1.0],[1.2,1.3]", 1 },
+        { "(,1.0],[1.2,1.5]", 3 },
+        { "[2.0]", 5 },
+        { "(2.0,)", 7 },
+        { "(3.0,)", n },
+        { "(,0.9)", n },
+        { "[0.1,0.5],[1.2,1.3],[4.0,)", n },
+        { "1.0", 7 },
+    };
+    for (auto const& c : cases) {
+        auto *range = mv_range_parse(c.spec);
+        ASSERT_TRUE(range != nullptr) << c.spec;
+        EXPECT_EQ(c.expected, mv_range_highest(range, versions.data(), n))
+            << c.spec;
+        EXPECT_EQ(0u, mv_range_highest(range, versions.data(), 0)) << c.spec;
+        mv_range_free(range);
+    }
+
+    for (auto *version : versions) {
+        mv_free(const_cast<struct maven_version*>(version));
+    }
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/catalog.h"
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/scan.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+class ScanTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root_ = fs::path(testing::TempDir()) / ("scan-test-" + std::to_string(
+            ::testing::UnitTest::GetInstance()->random_seed()));
+        fs::remove_all(root_);
+        fs::create_directories(root_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(root_);
+    }
+
+    // Creates `file` (and its directories) under the root
+    void touch(std::string const& file) {
+        auto path = root_ / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << "x";
+    }
+
+    static std::string key(const struct maven_version *version) {
+        std::string ret(mv_sort_key(version, nullptr, 0), '\0');
+        mv_sort_key(version, reinterpret_cast<unsigned char*>(&ret[0]),
+            ret.size());
+        return ret;
+    }
+
+    // Every artifact's versions as "group:artifact:version" lines
+    static std::vector<std::string> lines(struct maven_scan *scan) {
+        std::vector<std::string> ret;
+        struct mv_scan_artifact artifact;
+        for (size_t i = 0; mv_scan_artifact_at(scan, i, &artifact); ++i) {
+            std::string name(artifact.name, artifact.len);
+            for (size_t j = 0; j < artifact.count; ++j) {
+                ret.push_back(name + ":" + artifact.strs[j]);
+                if (j > 0) {
+                    EXPECT_LE(key(artifact.versions[j - 1]),
+                        key(artifact.versions[j])) << ret.back();
+                }
+            }
+        }
+        return ret;
+    }
+
+    fs::path root_;
+};
+
+}
+
+TEST_F(ScanTest, Layout) {
+    touch("org/apache/maven/maven-core/3.9.6/maven-core-3.9.6.pom");
+    touch("org/apache/maven/maven-core/3.9.6/maven-core-3.9.6.jar");
+    touch("org/apache/maven/maven-core/3.10.0/maven-core-3.10.0.pom");
+    touch("org/apache/maven/maven-core/4.0.0-beta-3/"
+        "maven-core-4.0.0-beta-3.pom");
+    touch("org/apache/maven/maven-core/4.0.0-SNAPSHOT/"
+        "maven-core-4.0.0-20240102.030405-7.jar");
+    touch("org/apache/maven/maven-core/maven-metadata-central.xml");
+    touch("org/apache/maven/plugins/maven-compiler-plugin/3.11.0/"
+        "maven-compiler-plugin-3.11.0.pom");
+    touch("com/example/lib/1.0-SNAPSHOT/lib-1.0-SNAPSHOT.jar");
+    touch("com/example/lib/1.0-SNAPSHOT/_remote.repositories");
+    touch("com/example/lib/1.0/lib-1.0.pom");
+
+    // Not versions: no file named for them, no group, or hidden
+    touch("com/example/lib/notes/readme.txt");
+    touch("com/example/lib/2.0/other-2.0.pom");
+    touch("toplevel/1.0/toplevel-1.0.pom");
+    touch(".cache/org/hidden/1.0/hidden-1.0.pom");
+    fs::create_directories(root_ / "com/example/empty/1.0");
+
+    std::vector<std::string> expected = {
+        "com.example:lib:1.0-SNAPSHOT",
+        "com.example:lib:1.0",
+        "org.apache.maven.plugins:maven-compiler-plugin:3.11.0",
+        "org.apache.maven:maven-core:3.9.6",
+        "org.apache.maven:maven-core:3.10.0",
+        "org.apache.maven:maven-core:4.0.0-beta-3",
+        "org.apache.maven:maven-core:4.0.0-SNAPSHOT",
+    };
+    for (unsigned threads : { 1, 4 }) {
+        struct maven_scan *scan = mv_scan(root_.c_str(), threads);
+        ASSERT_TRUE(scan);
+        EXPECT_EQ(3u, mv_scan_size(scan));
+        EXPECT_EQ(0u, mv_scan_skipped(scan));
+        EXPECT_EQ(expected, lines(scan));
+
+        struct mv_scan_artifact artifact;
+        ASSERT_TRUE(mv_scan_artifact_at(scan, 2, &artifact));
+        EXPECT_EQ(10, mv_minor(artifact.versions[1]));
+        EXPECT_FALSE(mv_scan_artifact_at(scan, 3, &artifact));
+        mv_scan_free(scan);
+    }
+}
+
+TEST_F(ScanTest, Catalog) {
+    touch("g/a/1.0/a-1.0.pom");
+    touch("g/a/1.0.1/a-1.0.1.pom");
+    touch("g/b/2/b-2.pom");
+    // mv_compare orders these the other way around (see `mv_sort_key`)
+    touch("g/c/9.0-SNAPSHOT/c-9.0-SNAPSHOT.pom");
+    touch("g/c/9.RELEASE/c-9.RELEASE.pom");
+
+    struct maven_scan *scan = mv_scan(root_.c_str(), 2);
+    ASSERT_TRUE(scan);
+    auto path = (root_ / "versions.cat").string();
+    ASSERT_TRUE(mv_scan_write_catalog(scan, path.c_str()));
+    auto scanned = lines(scan);
+    mv_scan_free(scan);
+
+    struct maven_catalog *catalog = mv_catalog_open(path.c_str());
+    ASSERT_TRUE(catalog);
+    EXPECT_EQ(3u, mv_catalog_size(catalog));
+    struct mv_catalog_artifact artifact;
+    ASSERT_TRUE(mv_catalog_find(catalog, "g:a", 3, &artifact));
+    size_t len;
+    EXPECT_STREQ("1.0.1", mv_catalog_latest(&artifact, &len));
+
+    // The scan lists versions in the order the catalog stores them
+    std::vector<std::string> cataloged;
+    for (size_t i = 0; mv_catalog_artifact_at(catalog, i, &artifact); ++i) {
+        std::string name(artifact.name, artifact.len);
+        for (size_t j = 0; j < artifact.count; ++j) {
+            cataloged.push_back(name + ":"
+                + mv_catalog_version(&artifact, j, &len));
+        }
+    }
+    EXPECT_EQ(scanned, cataloged);
+    mv_catalog_close(catalog);
+}
+
+TEST_F(ScanTest, Many) {
+    // Enough directories to keep every thread busy
+    for (int g = 0; g < 5; ++g) {
+        for (int a = 0; a < 10; ++a) {
+            std::string group = "g" + std::to_string(g);
+            std::string artifact = "a" + std::to_string(a);
+            for (int v = 0; v < 8; ++v) {
+                std::string version = "1." + std::to_string(v);
+                touch("org/" + group + "/" + artifact + "/" + version + "/"
+                    + artifact + "-" + version + ".pom");
+            }
+        }
+    }
+
+    struct maven_scan *one = mv_scan(root_.c_str(), 1);
+    struct maven_scan *many = mv_scan(root_.c_str(), 8);
+    ASSERT_TRUE(one);
+    ASSERT_TRUE(many);
+    EXPECT_EQ(50u, mv_scan_size(many));
+    auto got = lines(many);
+    EXPECT_EQ(400u, got.size());
+    EXPECT_EQ(lines(one), got);
+    mv_scan_free(one);
+    mv_scan_free(many);
+}
+
+TEST_F(ScanTest, Errors) {
+    errno = 0;
+    EXPECT_FALSE(mv_scan((root_ / "missing").c_str(), 1));
+    EXPECT_EQ(ENOENT, errno);
+
+    struct maven_scan *scan = mv_scan(root_.c_str(), 0);
+    ASSERT_TRUE(scan);
+    EXPECT_EQ(0u, mv_scan_size(scan));
+    mv_scan_free(scan);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/serialize.h"
+
+namespace {
+
+const char *kVersions[] = {
+    "", "1", "1.0", "1.2.3", "1.2.3-4", "1.0.0.0-ga", "2.0-SNAPSHOT",
+    "1-alpha-1", "1a1", "1.0-rc1", "1.0.RELEASE", "1.1.Final", "1.sp",
+    "1.0.0.x", "1-1.foo-bar1baz-.1", "1.99999999999999999999",
+    "1.0-20200101.123456-1", "3.2.1-SNAPSHOT-ce44f2", "1.2147483648",
+    "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot1",
+};
+
+std::vector<unsigned char> serialize(struct maven_version *v) {
+    std::vector<unsigned char> buf(mv_serialize(v, NULL, 0));
+    EXPECT_EQ(buf.size(), mv_serialize(v, buf.data(), buf.size()));
+    return buf;
+}
+
+} // anonymous namespace
+
+TEST(SerializeTest, RoundTrip) {
+    for (auto const *str : kVersions) {
+        auto *v = mv_parse(str);
+        auto buf = serialize(v);
+        ASSERT_EQ(0u, buf.size() % 8);
+
+        auto *copy = mv_deserialize(buf.data(), buf.size());
+        ASSERT_TRUE(copy) << str;
+        ASSERT_EQ(mv_major(v), mv_major(copy));
+        ASSERT_EQ(mv_minor(v), mv_minor(copy));
+        ASSERT_EQ(mv_incremental(v), mv_incremental(copy));
+        ASSERT_EQ(mv_build(v), mv_build(copy));
+        ASSERT_STREQ(mv_qualifier(v), mv_qualifier(copy));
+        ASSERT_EQ(0, mv_compare(v, copy));
+        ASSERT_EQ(mv_hash(v), mv_hash(copy));
+        ASSERT_EQ(buf, serialize(copy));
+        mv_free(copy);
+        mv_free(v);
+    }
+}
+
+TEST(SerializeTest, Views) {
+    // A table of records, 8-byte aligned
+    std::vector<uint64_t> table;
+    std::vector<struct maven_version*> versions;
+    for (auto const *str : kVersions) {
+        versions.push_back(mv_parse(str));
+        auto buf = serialize(versions.back());
+        size_t offset = table.size();
+        table.resize(offset + buf.size() / 8);
+        memcpy(&table[offset], buf.data(), buf.size());
+    }
+
+    std::vector<struct mv_version_view> views;
+    const char *cur = reinterpret_cast<const char*>(table.data());
+    size_t left = table.size() * 8;
+    while (left > 0) {
+        struct mv_version_view view;
+        size_t size = mv_view_init(&view, cur, left);
+        ASSERT_GT(size, 0u);
+        views.push_back(view);
+        cur += size;
+        left -= size;
+    }
+    ASSERT_EQ(versions.size(), views.size());
+
+    for (size_t i = 0; i < views.size(); ++i) {
+        ASSERT_EQ(kVersions[i], std::string(views[i].version, views[i].len));
+        ASSERT_STREQ(mv_qualifier(versions[i]), views[i].qualifier);
+        ASSERT_EQ(mv_major(versions[i]), views[i].major);
+        ASSERT_EQ(mv_build(versions[i]), views[i].build);
+        for (size_t j = 0; j < views.size(); ++j) {
+            ASSERT_EQ(mv_compare(versions[i], versions[j]),
+                mv_view_compare(&views[i], &views[j]))
+                << kVersions[i] << " " << kVersions[j];
+        }
+    }
+
+    // Views need aligned records
+    std::vector<unsigned char> unaligned(9 + mv_serialize(versions[1], NULL,
+        0));
+    size_t size = mv_serialize(versions[1], &unaligned[1], unaligned.size());
+    struct mv_version_view view;
+    ASSERT_EQ(0u, mv_view_init(&view, &unaligned[1], size));
+    auto *copy = mv_deserialize(&unaligned[1], size);
+    ASSERT_TRUE(copy);
+    mv_free(copy);
+
+    for (auto *v : versions) {
+        mv_free(v);
+    }
+}
+
+TEST(SerializeTest, Malformed) {
+    auto *v = mv_parse("1.0-alpha-2.99999999999999999999-x");
+    auto buf = serialize(v);
+    mv_free(v);
+
+    // Truncated records
+    for (size_t len = 0; len < buf.size(); ++len) {
+        ASSERT_FALSE(mv_deserialize(buf.data(), len)) << len;
+    }
+
+    // Corrupted records are either rejected or still readable
+    for (size_t i = 0; i < buf.size(); ++i) {
+        for (unsigned char bits : { 0x01, 0x80, 0xff }) {
+            auto corrupt = buf;
+            corrupt[i] ^= bits;
+            auto *copy = mv_deserialize(corrupt.data(), corrupt.size());
+            if (copy) {
+                unsigned char key[256];
+                mv_sort_key(copy, key, sizeof(key));
+                mv_free(copy);
+            }
+        }
+    }
+
+    // Unknown formats
+    auto future = buf;
+    future[3] = 2;
+    ASSERT_FALSE(mv_deserialize(future.data(), future.size()));
+}
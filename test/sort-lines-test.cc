@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/maven-version.h"
+#include "sort-lines.h"
+
+namespace {
+
+// Versions with deep common prefixes, many equal spellings and a few lines
+// longer than the output buffer
+std::vector<std::string> corpus() {
+    static const char *qualifiers[] = { "", "-alpha-1", "-beta", "-rc2",
+        "-SNAPSHOT", "-ga", "-final", "-20200101.120000-3" };
+    std::mt19937 rng(7);
+    std::vector<std::string> ret;
+    for (int i = 0; i < 12000; ++i) {
+        std::string v = std::to_string(rng() % 4) + "." +
+            std::to_string(rng() % 12);
+        if (rng() % 2) {
+            v += "." + std::to_string(rng() % 3);
+        }
+        ret.push_back(v + qualifiers[rng() % 8]);
+    }
+    for (int i = 0; i < 6000; ++i) {
+        std::string v = "1.2.3.4.5.6.7";
+        for (int j = 0; j < 1 + static_cast<int>(rng() % 3); ++j) {
+            v += "." + std::to_string(rng() % 40);
+        }
+        ret.push_back(v);
+    }
+    for (char c : { 'b', 'a', 'b' }) {
+        ret.push_back("1-" + std::string(70000, 'x') + c);
+    }
+    std::shuffle(ret.begin(), ret.end(), rng);
+    return ret;
+}
+
+std::string key(std::string const& version) {
+    std::string ret(mv_sort_key_n(version.data(), version.size(), nullptr, 0),
+        '\0');
+    mv_sort_key_n(version.data(), version.size(),
+        reinterpret_cast<unsigned char*>(&ret[0]), ret.size());
+    return ret;
+}
+
+std::vector<std::string> sorted(std::vector<std::string> const& versions,
+        struct sort_options const& options) {
+    std::vector<struct sort_line> lines;
+    for (auto const& v : versions) {
+        struct sort_line line = { v.data(), static_cast<uint32_t>(v.size()),
+            0, nullptr, 0 };
+        lines.push_back(line);
+    }
+    FILE *out = tmpfile();
+    EXPECT_TRUE(out);
+    EXPECT_TRUE(sort_lines(lines.data(), lines.size(), &options, out));
+    rewind(out);
+
+    std::vector<std::string> ret;
+    std::string line;
+    int c;
+    while ((c = fgetc(out)) != EOF) {
+        if (c == '\n') {
+            ret.push_back(line);
+            line.clear();
+        } else {
+            line += static_cast<char>(c);
+        }
+    }
+    fclose(out);
+    EXPECT_TRUE(line.empty());
+    return ret;
+}
+
+// Equal versions, by key, in input order
+std::vector<std::string> expected(std::vector<std::string> const& versions) {
+    std::vector<std::pair<std::string, std::string>> keyed;
+    for (auto const& v : versions) {
+        keyed.emplace_back(key(v), v);
+    }
+    std::stable_sort(keyed.begin(), keyed.end(),
+        [](auto const& a, auto const& b) { return a.first < b.first; });
+    std::vector<std::string> ret;
+    for (auto const& k : keyed) {
+        ret.push_back(k.second);
+    }
+    return ret;
+}
+
+std::vector<std::string> unique(std::vector<std::string> const& versions) {
+    std::vector<std::string> ret;
+    for (auto const& v : versions) {
+        if (ret.empty() || key(ret.back()) != key(v)) {
+            ret.push_back(v);
+        }
+    }
+    return ret;
+}
+
+TEST(SortLinesTest, Threads) {
+    auto versions = corpus();
+    auto want = expected(versions);
+    for (size_t i = 1; i < want.size(); ++i) {
+        ASSERT_LE(mv_compare_str(want[i - 1].c_str(), want[i].c_str()), 0)
+            << want[i - 1] << " " << want[i];
+    }
+    auto reversed = want;
+    std::reverse(reversed.begin(), reversed.end());
+
+    for (unsigned threads : { 1u, 2u, 3u, 4u }) {
+        SCOPED_TRACE(threads);
+        struct sort_options options = { 0, 0, 0, threads };
+        EXPECT_TRUE(sorted(versions, options) == want);
+
+        options.reverse = 1;
+        EXPECT_TRUE(sorted(versions, options) == reversed);
+
+        options.unique = 1;
+        EXPECT_TRUE(sorted(versions, options) == unique(reversed));
+
+        options.reverse = 0;
+        EXPECT_TRUE(sorted(versions, options) == unique(want));
+
+        options.unique = 0;
+        options.select = 1;
+        EXPECT_EQ(std::vector<std::string>({ want.back() }),
+            sorted(versions, options));
+
+        options.select = -1;
+        EXPECT_EQ(std::vector<std::string>({ want.front() }),
+            sorted(versions, options));
+    }
+}
+
+TEST(SortLinesTest, Small) {
+    struct sort_options options = { 1, 0, 0, 4 };
+    EXPECT_TRUE(sorted({}, options).empty());
+    EXPECT_EQ(std::vector<std::string>({ "1.0-beta", "1.0", "1.10" }),
+        sorted({ "1.10", "1.0", "1.0-beta", "1.0.0", "1-ga" }, options));
+}
+
+} // namespace
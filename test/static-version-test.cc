@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+#include "c-maven-utils/maven-version.h"
+#include "c-maven-utils/cpp/static-version.h"
+
+using mvn::StaticVersion;
+using namespace mvn::literals;
+
+namespace {
+
+constexpr bool equal(std::string_view a, std::string_view b) {
+    return StaticVersion(a) == StaticVersion(b)
+        && StaticVersion(b) == StaticVersion(a);
+}
+
+constexpr bool ordered(std::string_view a, std::string_view b) {
+    return StaticVersion(a) < StaticVersion(b)
+        && StaticVersion(b) > StaticVersion(a)
+        && StaticVersion(a) != StaticVersion(b);
+}
+
+std::string sortKey(const char *version) {
+    std::string key(mv_sort_key_str(version, NULL, 0), '\0');
+    mv_sort_key_str(version, reinterpret_cast<unsigned char*>(&key[0]),
+        key.size());
+    return key;
+}
+
+} // anonymous namespace
+
+// The orders of VersionTest, decided by the compiler
+static_assert(equal("1", "1.0.0"), "");
+static_assert(equal("1", "1-0"), "");
+static_assert(equal("1.0", "1.0-0"), "");
+static_assert(equal("1a", "1.0-a"), "");
+static_assert(equal("1.0.0x", "1-x"), "");
+static_assert(equal("1ga", "1"), "");
+static_assert(equal("1final", "1"), "");
+static_assert(equal("1cr", "1rc"), "");
+static_assert(equal("1a1", "1-alpha-1"), "");
+static_assert(equal("1b2", "1-beta-2"), "");
+static_assert(equal("1m3", "1-milestone-3"), "");
+static_assert(equal("1X", "1x"), "");
+static_assert(equal("1FinaL", "1"), "");
+static_assert(equal("1cR", "1rC"), "");
+static_assert(equal("1m3", "1MILESTONE3"), "");
+static_assert(ordered("1-sp", "1-a"), "");
+static_assert(ordered("1-sp", "1-rcx"), "");
+
+static_assert(ordered("1", "2"), "");
+static_assert(ordered("1.5", "2"), "");
+static_assert(ordered("1.0.1", "1.1"), "");
+static_assert(ordered("1.0-alpha-1", "1.0"), "");
+static_assert(ordered("1.0-alpha-1", "1.0-beta-1"), "");
+static_assert(ordered("1.0-beta-1", "1.0-SNAPSHOT"), "");
+static_assert(ordered("1.0-SNAPSHOT", "1.0"), "");
+static_assert(ordered("1.0-alpha-1-SNAPSHOT", "1.0-alpha-1"), "");
+static_assert(ordered("1.0", "1.0-1"), "");
+static_assert(ordered("1.0.0", "1.0-1"), "");
+static_assert(ordered("2.0-1", "2.0.1"), "");
+static_assert(ordered("2.0.1-klm", "2.0.1-lmn"), "");
+static_assert(ordered("2.0.1", "2.0.1-xyz"), "");
+static_assert(ordered("2.0.1-xyz", "2.0.1-123"), "");
+static_assert(ordered("1.1", "1.1.0.0.1"), "");
+static_assert(ordered("1", "1-fin"), "");
+static_assert(ordered("1-rc", "1-c"), "");
+
+static_assert(equal("01.002", "1.2"), "");
+static_assert(equal("0-1", "0.0.0-1"), "");
+static_assert(ordered("1.2-4", "1.2.1"), "");
+static_assert(ordered("0", "0-1"), "");
+static_assert(ordered("1.2-1", "1.2.0.1"), "");
+
+static_assert(ordered("1-20150101123456", "1-20150101123457"), "");
+static_assert(ordered("1.999999999999999999", "1.1000000000000000000"), "");
+static_assert(ordered("1.123456789012345678901", "1.123456789012345678902"),
+    "");
+static_assert(equal("1.000000000000000000000000001", "1.1"), "");
+static_assert(equal("1.0000123456789012345678901", "1.123456789012345678901"),
+    "");
+
+static_assert(ordered("1.0.alpha", "1"), "");
+static_assert(ordered("1", "1.ga.1"), "");
+static_assert(ordered("1-alpha", "1-1"), "");
+static_assert(ordered("1.0.0.x", "1.0.0.xa"), "");
+static_assert(ordered("1.sp", "1.1"), "");
+
+static_assert("3.6.0"_mvn == "3.6"_mvn, "");
+static_assert("3.6.0-rc1"_mvn < "3.6.0"_mvn, "");
+
+TEST(StaticVersionTest, MatchesSortKeys) {
+    for (auto const *str : { "", "1", "1.0.0", "3.2.1-SNAPSHOT", "-", "..",
+            "1-", "1.", "-1", "a", "A.b.C", "1a1", "1-m", "1m", "1.0-sp-1",
+            "1.0.0-ga", "2.0.1-xyz-123", "1.0.alpha", "1.ga.alpha",
+            "0.0.0.0", "1-0-0.0-alpha", "1.1000000000000000000",
+            "1.00000000000000000000000000000000001-final",
+            "9223372036854775807", "1.0-20150101.123456-7",
+            "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot1",
+            "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20.0.0"
+            "-snapshot-alpha-1-beta-2-c-3" }) {
+        ASSERT_EQ(sortKey(str), StaticVersion(str).key()) << str;
+    }
+}
+
+TEST(StaticVersionTest, RuntimeVersions) {
+    mvn::Version v("3.5.4");
+    ASSERT_LT(v, "3.6.0"_mvn);
+    ASSERT_GT("3.6.0"_mvn, v);
+    ASSERT_LE(v, "3.5.4.0"_mvn);
+    ASSERT_EQ(v, "3.5.4-final"_mvn);
+    ASSERT_NE(v, "3.5.4-SNAPSHOT"_mvn);
+    ASSERT_GE(mvn::Version("3.6.0-SNAPSHOT"), "3.6.0-rc1"_mvn);
+}
+
+TEST(StaticVersionTest, TooLong) {
+    ASSERT_THROW(StaticVersion(std::string(200, '1')), std::length_error);
+
+    // Short enough, but with too long a key
+    std::string many;
+    while (many.size() < 120) {
+        many += "1.";
+    }
+    ASSERT_THROW(StaticVersion(many + "1"), std::length_error);
+}
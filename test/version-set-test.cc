@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015 Nathan Rosenblum <flander@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "c-maven-utils/cpp/version-set.h"
+
+namespace {
+
+std::vector<std::string> strings(mvn::VersionSet::const_iterator first,
+        mvn::VersionSet::const_iterator last) {
+    std::vector<std::string> ret;
+    for (; first != last; ++first) {
+        ret.emplace_back(first->original());
+    }
+    return ret;
+}
+
+std::vector<std::string> within(mvn::VersionSet const& set,
+        const char *spec) {
+    std::vector<std::string> ret;
+    for (auto const& run : set.within(spec)) {
+        auto strs = strings(run.first, run.second);
+        ret.insert(ret.end(), strs.begin(), strs.end());
+    }
+    return ret;
+}
+
+} // namespace
+
+TEST(VersionSetTest, BulkBuild) {
+    mvn::VersionSet set({ "1.10", "1.2", "1.0", "1.2-SNAPSHOT", "1",
+        "1.2.0", "1.1-rc1" });
+    ASSERT_EQ(5u, set.size());
+    // The first of equal versions is kept
+    ASSERT_EQ(std::vector<std::string>({ "1.0", "1.1-rc1", "1.2-SNAPSHOT",
+        "1.2", "1.10" }), strings(set.begin(), set.end()));
+
+    std::vector<std::string> strs = { "3", "2", "3.0" };
+    mvn::VersionSet from_strings(strs.begin(), strs.end());
+    ASSERT_EQ(std::vector<std::string>({ "2", "3" }),
+        strings(from_strings.begin(), from_strings.end()));
+
+    mvn::VersionSet empty;
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQ(empty.end(), empty.latest());
+    ASSERT_EQ(empty.end(), empty.latestRelease());
+    ASSERT_TRUE(empty.within("[1,2]").empty());
+}
+
+TEST(VersionSetTest, Lookup) {
+    mvn::VersionSet set({ "1.0", "1.1", "1.2-beta", "1.2", "2.0" });
+    ASSERT_TRUE(set.contains(mvn::Version("1.2.0")));
+    ASSERT_FALSE(set.contains(mvn::Version("1.3")));
+    ASSERT_EQ("1.2", set.find(mvn::Version("1.2-ga"))->original());
+    ASSERT_EQ(set.end(), set.find(mvn::Version("0.9")));
+
+    ASSERT_EQ("1.2-beta", set.lower_bound(mvn::Version("1.1.1"))->original());
+    ASSERT_EQ("1.1", set.lower_bound(mvn::Version("1.1"))->original());
+    ASSERT_EQ("1.2-beta", set.upper_bound(mvn::Version("1.1"))->original());
+    ASSERT_EQ(set.end(), set.upper_bound(mvn::Version("2")));
+
+    auto inserted = set.insert(mvn::Version("1.5"));
+    ASSERT_TRUE(inserted.second);
+    ASSERT_EQ("1.5", inserted.first->original());
+    inserted = set.insert(mvn::Version("1.5.0"));
+    ASSERT_FALSE(inserted.second);
+    ASSERT_EQ("1.5", inserted.first->original());
+    ASSERT_EQ(6u, set.size());
+
+    ASSERT_TRUE(set.erase(mvn::Version("1.5.0")));
+    ASSERT_FALSE(set.erase(mvn::Version("1.5")));
+    ASSERT_EQ(5u, set.size());
+}
+
+TEST(VersionSetTest, Latest) {
+    mvn::VersionSet set({ "1.0", "1.1.Final", "1.2-rc1", "1.3-SNAPSHOT",
+        "1.3-20200101.123456-1" });
+    ASSERT_EQ("1.3-20200101.123456-1", set.latest()->original());
+    ASSERT_EQ("1.1.Final", set.latestRelease()->original());
+
+    mvn::VersionSet snapshots({ "1.0-SNAPSHOT", "2.0-alpha" });
+    ASSERT_EQ(snapshots.end(), snapshots.latestRelease());
+}
+
+TEST(VersionSetTest, Within) {
+    mvn::VersionSet set({ "0.9", "1.0", "1.1", "1.5", "2.0-alpha", "2.0",
+        "2.1", "3.0" });
+    ASSERT_EQ(std::vector<std::string>({ "1.0", "1.1", "1.5", "2.0-alpha" }),
+        within(set, "[1.0,2.0)"));
+    ASSERT_EQ(std::vector<std::string>({ "1.1", "1.5", "2.0-alpha", "2.0" }),
+        within(set, "(1.0,2.0]"));
+    ASSERT_EQ(std::vector<std::string>({ "0.9", "1.0", "2.1", "3.0" }),
+        within(set, "(,1.0],[2.1,)"));
+    ASSERT_EQ(std::vector<std::string>({ "1.5" }), within(set, "[1.5]"));
+    ASSERT_TRUE(within(set, "[1.2,1.4]").empty());
+    ASSERT_EQ(8u, within(set, "1.0").size());
+    ASSERT_THROW(set.within("[2.0,1.0]"), std::invalid_argument);
+}
@@ -22,6 +22,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "c-maven-utils/cpp/maven-version.h"
 #include "c-maven-utils/maven-version.h"
 
@@ -43,6 +49,213 @@ TEST(VersionTest, BasicParsing) {
     mv_free(v1);
 }
 
+TEST(VersionTest, ParsingFallback) {
+    // Components that are not plain digits make the whole version a qualifier
+    const char *fallbacks[] = { ".1", "1..2", "1.2.", "1.+2", "1.99999999999" };
+    for (auto *str : fallbacks) {
+        auto *v1 = mv_parse(str);
+        ASSERT_EQ(-1, mv_major(v1)) << str;
+        ASSERT_EQ(-1, mv_minor(v1)) << str;
+        ASSERT_STREQ(str, mv_qualifier(v1));
+        mv_free(v1);
+    }
+
+    auto *v1 = mv_parse("1.2.3.foo-bar");
+    ASSERT_EQ(3, mv_incremental(v1));
+    ASSERT_STREQ("foo", mv_qualifier(v1));
+    mv_free(v1);
+
+    v1 = mv_parse("1--2");
+    ASSERT_EQ(1, mv_major(v1));
+    ASSERT_EQ(-1, mv_build(v1));
+    ASSERT_STREQ("-2", mv_qualifier(v1));
+    mv_free(v1);
+}
+
+TEST(VersionTest, LengthDelimitedParsing) {
+    const char buf[] = "3.2.1-SNAPSHOT\n3.2.1-7";
+
+    auto *v1 = mv_parse_n(buf, 14);
+    ASSERT_EQ(3, mv_major(v1));
+    ASSERT_EQ(1, mv_incremental(v1));
+    ASSERT_STREQ("SNAPSHOT", mv_qualifier(v1));
+
+    auto *v2 = mv_parse_n(buf + 15, 7);
+    ASSERT_EQ(7, mv_build(v2));
+    ASSERT_STREQ("", mv_qualifier(v2));
+    ASSERT_EQ(-1, mv_compare(v1, v2));
+
+    auto *v3 = mv_parse("3.2.1-snapshot");
+    ASSERT_EQ(0, mv_compare(v1, v3));
+
+    // A slice that ends in the middle of a component
+    auto *v4 = mv_parse_n(buf + 15, 6);
+    ASSERT_EQ(-1, mv_build(v4));
+    ASSERT_STREQ("", mv_qualifier(v4));
+    ASSERT_EQ(1, mv_compare(v4, v1));
+
+    mv_free(v1);
+    mv_free(v2);
+    mv_free(v3);
+    mv_free(v4);
+}
+
+TEST(VersionTest, BatchParsing) {
+    const char *strs[] = { "3.2.1-7", "3.2.1-SNAPSHOT", "1.0", "1.0.0" };
+    struct maven_version *versions[4];
+    auto *batch = mv_parse_batch(strs, 4, versions);
+    ASSERT_TRUE(batch != NULL);
+
+    ASSERT_EQ(3, mv_major(versions[0]));
+    ASSERT_EQ(7, mv_build(versions[0]));
+    ASSERT_STREQ("SNAPSHOT", mv_qualifier(versions[1]));
+    ASSERT_EQ(1, mv_compare(versions[0], versions[1]));
+    ASSERT_EQ(0, mv_compare(versions[2], versions[3]));
+
+    auto *v = mv_parse("3.2.1");
+    ASSERT_EQ(-1, mv_compare(versions[1], v));
+    ASSERT_EQ(1, mv_compare(versions[0], v));
+    mv_free(v);
+
+    mv_batch_free(batch);
+}
+
+TEST(VersionTest, LargeBatch) {
+    std::vector<std::string> strs;
+    for (int i = 0; i < 10000; ++i) {
+        strs.push_back(std::to_string(i / 100) + "." + std::to_string(i % 100)
+            + "-SNAPSHOT");
+    }
+    std::vector<const char*> ptrs;
+    for (auto const& str : strs) {
+        ptrs.push_back(str.c_str());
+    }
+    std::vector<struct maven_version*> versions(strs.size());
+
+    auto *batch = mv_parse_batch(ptrs.data(), ptrs.size(), versions.data());
+    ASSERT_TRUE(batch != NULL);
+    for (size_t i = 1; i < versions.size(); ++i) {
+        ASSERT_EQ(-1, mv_compare(versions[i - 1], versions[i]));
+    }
+    mv_batch_free(batch);
+}
+
+struct CountingAllocator {
+    size_t allocs = 0;
+    size_t frees = 0;
+    size_t outstanding = 0;
+
+    static void* alloc(void *ctx, size_t size) {
+        auto *self = static_cast<CountingAllocator*>(ctx);
+        ++self->allocs;
+        self->outstanding += size;
+        return malloc(size);
+    }
+
+    static void free(void *ctx, void *ptr, size_t size) {
+        auto *self = static_cast<CountingAllocator*>(ctx);
+        ++self->frees;
+        self->outstanding -= size;
+        ::free(ptr);
+    }
+
+    struct mv_allocator allocator() {
+        struct mv_allocator ret = { alloc, free, this };
+        return ret;
+    }
+};
+
+TEST(VersionTest, AllocatorHooks) {
+    CountingAllocator global;
+    auto allocator = global.allocator();
+    mv_set_allocator(&allocator);
+
+    const char *long_version =
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20.21.22.23.24.25.26."
+        "27.28.29.30.31.32.33.34.35.36.37.38.39.40.41.42.43.44.45-SNAPSHOT";
+    auto *v1 = mv_parse("3.2.1-SNAPSHOT");
+    auto *v2 = mv_parse(long_version);
+    ASSERT_EQ(-1, mv_compare(v2, v1));
+    ASSERT_GT(global.allocs, 0u);
+    mv_free(v1);
+    mv_free(v2);
+    ASSERT_EQ(global.allocs, global.frees);
+    ASSERT_EQ(0u, global.outstanding);
+
+    const char *strs[] = { "1.0", "2.0" };
+    struct maven_version *versions[2];
+    auto *batch = mv_parse_batch(strs, 2, versions);
+    mv_batch_free(batch);
+    ASSERT_EQ(global.allocs, global.frees);
+    ASSERT_EQ(0u, global.outstanding);
+
+    // Explicit allocators bypass the installed one
+    CountingAllocator local;
+    auto local_allocator = local.allocator();
+    size_t global_allocs = global.allocs;
+    v1 = mv_parse_with(long_version, strlen(long_version), &local_allocator);
+    ASSERT_STREQ(long_version, mv_qualifier(v1));
+    mv_free(v1);
+    ASSERT_EQ(global_allocs, global.allocs);
+    ASSERT_GT(local.allocs, 0u);
+    ASSERT_EQ(local.allocs, local.frees);
+    ASSERT_EQ(0u, local.outstanding);
+
+    // Frees are sized as allocated, even when the qualifier holds a NUL
+    v1 = mv_parse_with("1-a\0bcdef", 9, &local_allocator);
+    ASSERT_TRUE(v1 != NULL);
+    ASSERT_STREQ("a", mv_qualifier(v1));
+    mv_free(v1);
+    ASSERT_EQ(local.allocs, local.frees);
+    ASSERT_EQ(0u, local.outstanding);
+
+    mv_set_allocator(NULL);
+}
+
+TEST(VersionTest, LazyComparison) {
+    CountingAllocator local;
+    auto allocator = local.allocator();
+    const char *str = "1.2.3-beta-2";
+
+    // Field extraction does not build the comparable form
+    auto *v1 = mv_parse_with(str, strlen(str), &allocator);
+    ASSERT_EQ(1u, local.allocs);
+    ASSERT_EQ(1, mv_major(v1));
+    ASSERT_STREQ("beta-2", mv_qualifier(v1));
+    ASSERT_EQ(1u, local.allocs);
+
+    auto *v2 = mv_parse_with("1.2.3", 5, &allocator);
+    ASSERT_EQ(-1, mv_compare(v1, v2));
+    size_t allocs = local.allocs;
+    ASSERT_GT(allocs, 2u);
+    ASSERT_EQ(-1, mv_compare(v1, v2));
+    ASSERT_EQ(allocs, local.allocs);
+
+    mv_free(v1);
+    mv_free(v2);
+    ASSERT_EQ(local.allocs, local.frees);
+    ASSERT_EQ(0u, local.outstanding);
+
+    // Concurrent first comparisons agree
+    v1 = mv_parse("1.0-alpha-1");
+    v2 = mv_parse("1.0-alpha-1.1");
+    std::vector<std::thread> threads;
+    std::atomic<int> failures(0);
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+            if (mv_compare(v1, v2) != -1 || mv_compare(v2, v1) != 1) {
+                ++failures;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0, failures.load());
+    mv_free(v1);
+    mv_free(v2);
+}
+
 TEST(VersionTest, BasicComparison) {
     auto *v1 = mv_parse("1.0.0");
     auto *v2 = mv_parse("1.1.0");
@@ -65,6 +278,12 @@ TEST(VersionTest, BasicComparison) {
     mv_free(v3);
 }
 
+std::string sortKey(const char *str) {
+    unsigned char buf[256];
+    size_t len = mv_sort_key_str(str, buf, sizeof(buf));
+    return std::string(reinterpret_cast<char*>(buf), len);
+}
+
 ::testing::AssertionResult assertVersionsEqual(const char* m_expr,
         const char* n_expr, const char *v1str, const char *v2str) {
     auto *v1 = mv_parse(v1str);
@@ -73,11 +292,22 @@ TEST(VersionTest, BasicComparison) {
     mv_free(v1);
     mv_free(v2);
 
-    if (!cmp) {
-        return ::testing::AssertionSuccess();
+    if (cmp) {
+        return ::testing::AssertionFailure() << v1str << " != " << v2str;
+    }
+
+    if (mv_compare_str(v1str, v2str) != 0
+            || mv_compare_str(v2str, v1str) != 0) {
+        return ::testing::AssertionFailure() << "str: " << v1str << " != "
+            << v2str;
+    }
+
+    if (sortKey(v1str) != sortKey(v2str)) {
+        return ::testing::AssertionFailure() << "key(" << v1str << ") != key("
+            << v2str << ")";
     }
 
-    return ::testing::AssertionFailure() << v1str << " != " << v2str;
+    return ::testing::AssertionSuccess();
 }
 
 ::testing::AssertionResult assertVersionsOrder(const char* m_expr,
@@ -88,11 +318,23 @@ TEST(VersionTest, BasicComparison) {
     mv_free(v1);
     mv_free(v2);
 
-    if (cmp < 0) {
-        return ::testing::AssertionSuccess();
+    if (cmp >= 0) {
+        return ::testing::AssertionFailure() <<  "! " << v1str << " < "
+            << v2str;
     }
 
-    return ::testing::AssertionFailure() <<  "! " << v1str << " < " << v2str;
+    if (mv_compare_str(v1str, v2str) != -1
+            || mv_compare_str(v2str, v1str) != 1) {
+        return ::testing::AssertionFailure() << "! str: " << v1str << " < "
+            << v2str;
+    }
+
+    if (!(sortKey(v1str) < sortKey(v2str))) {
+        return ::testing::AssertionFailure() << "! key(" << v1str
+            << ") < key(" << v2str << ")";
+    }
+
+    return ::testing::AssertionSuccess();
 }
 
 void checkVersionsEqual(const char *v1str, const char *v2str) {
@@ -148,6 +390,12 @@ TEST(VersionTest, Equality) {
     checkVersionsEqual( "1m3", "1Milestone3" );
     checkVersionsEqual( "1m3", "1MileStone3" );
     checkVersionsEqual( "1m3", "1MILESTONE3" );
+
+    // aliases and look-alikes are not qualifiers
+    checkVersionsOrder( "1-sp", "1-a" );
+    checkVersionsOrder( "1-sp", "1-bk" );
+    checkVersionsOrder( "1-sp", "1-ad" );
+    checkVersionsOrder( "1-sp", "1-rcx" );
 }
 
 TEST(VersionTest, Comparison) {
@@ -178,6 +426,208 @@ TEST(VersionTest, Comparison) {
 
     checkVersionsOrder( "2.0.1", "2.0.1-123" );
     checkVersionsOrder( "2.0.1-xyz", "2.0.1-123" );
+
+    // trailing components of the longer version compare against nothing
+    checkVersionsOrder( "1", "1.0.1" );
+    checkVersionsOrder( "1.0", "1.0.0.1" );
+    checkVersionsOrder( "1.1", "1.1.0.0.1" );
+
+    // aliases only match whole qualifiers
+    checkVersionsOrder( "1", "1-g" );
+    checkVersionsOrder( "1", "1-fin" );
+    checkVersionsOrder( "1-rc", "1-c" );
+}
+
+TEST(VersionTest, LongVersions) {
+    checkVersionsEqual(
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20-SNAPSHOT-a1b2c3",
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20.0.0-snapshot-alpha-1-beta-2-c-3" );
+    checkVersionsOrder(
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20-SNAPSHOT-a1b2c3",
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19.20-SNAPSHOT-a1b2c4" );
+
+    // Items that straddle the 64-byte blocks the lexer works in
+    checkVersionsEqual(
+        "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot2.Q-Z",
+        "1.0-BUILD-METADATA-FROM-THE-CI-SERVER-FOR-THIS-ARTIFACT-SNAPSHOT-2.q-z" );
+    checkVersionsOrder(
+        "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot123",
+        "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot1234" );
+    checkVersionsOrder(
+        "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot1.alpha",
+        "1.0-build-metadata-from-the-ci-server-for-this-artifact-snapshot1" );
+}
+
+TEST(VersionTest, NumericVersions) {
+    checkVersionsEqual( "1.0-1", "1.0.0-1" );
+    checkVersionsEqual( "1-0", "1.0.0" );
+    checkVersionsEqual( "0-1", "0.0.0-1" );
+    checkVersionsEqual( "01.002", "1.2" );
+    checkVersionsOrder( "1.2-4", "1.2.1" );
+    checkVersionsOrder( "1.2.3-4", "1.2.4" );
+    checkVersionsOrder( "1.2.3", "1.2.3-4" );
+    checkVersionsOrder( "0", "0-1" );
+    checkVersionsOrder( "1.2147483646", "1.2147483647" );
+    checkVersionsOrder( "2147483647", "2147483647-1" );
+
+    // Numeric and non-numeric versions still compare with each other
+    checkVersionsOrder( "1.2.3-SNAPSHOT", "1.2.3" );
+    checkVersionsOrder( "1.2.3", "1.2.3.1" );
+    checkVersionsOrder( "1.2.3-1", "1.2.3.1" );
+    checkVersionsOrder( "1.2-1", "1.2.0.1" );
+}
+
+TEST(VersionTest, BigNumbers) {
+    checkVersionsOrder( "1.2147483647", "1.2147483648" );
+    checkVersionsOrder( "1-20150101123456", "1-20150101123457" );
+    checkVersionsOrder( "1.999999999999999999", "1.1000000000000000000" );
+    checkVersionsOrder( "1.9223372036854775807", "1.9223372036854775808" );
+    checkVersionsOrder( "1.99999999999999999999", "1.100000000000000000000" );
+    checkVersionsOrder( "1.123456789012345678901", "1.123456789012345678902" );
+    checkVersionsEqual( "1.000000000000000000000000001", "1.1" );
+    checkVersionsEqual( "1.00000000000000000000000000000000000000000000000000",
+        "1" );
+    checkVersionsEqual( "1.0000123456789012345678901",
+        "1.123456789012345678901" );
+
+    // Components that do not fit an int are not version fields
+    auto *v = mv_parse("1.20150101123456");
+    ASSERT_EQ(-1, mv_major(v));
+    ASSERT_STREQ("1.20150101123456", mv_qualifier(v));
+    mv_free(v);
+}
+
+TEST(VersionTest, SortKey) {
+    auto *v1 = mv_parse("3.2.1-SNAPSHOT");
+    unsigned char buf[64];
+    size_t len = mv_sort_key(v1, buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+    ASSERT_LT(len, sizeof(buf));
+    ASSERT_EQ(sortKey("3.2.1-SNAPSHOT"),
+        std::string(reinterpret_cast<char*>(buf), len));
+
+    // Truncated output still reports the full length
+    unsigned char small[2] = { 0, 0 };
+    ASSERT_EQ(len, mv_sort_key(v1, small, sizeof(small)));
+    ASSERT_EQ(0, memcmp(buf, small, sizeof(small)));
+    ASSERT_EQ(len, mv_sort_key(v1, NULL, 0));
+    mv_free(v1);
+
+    // Keys of unterminated strings
+    unsigned char other[64];
+    ASSERT_EQ(len, mv_sort_key_n("3.2.1-SNAPSHOT-1", 14, other,
+        sizeof(other)));
+    ASSERT_EQ(0, memcmp(buf, other, len));
+
+    // Null components defer to what follows them
+    checkVersionsOrder( "1.0.alpha", "1" );
+    checkVersionsOrder( "1", "1.0.1" );
+    checkVersionsOrder( "1.ga.alpha", "1" );
+    checkVersionsOrder( "1", "1.ga.1" );
+    checkVersionsOrder( "1-alpha", "1" );
+    checkVersionsOrder( "1", "1-1" );
+    checkVersionsOrder( "1-alpha", "1-1" );
+    checkVersionsOrder( "1.0.0", "1.0.0.x" );
+    checkVersionsOrder( "1.0.0.x", "1.0.0.y" );
+    checkVersionsOrder( "1.0.0.x", "1.0.0.xa" );
+    checkVersionsOrder( "1.sp", "1.1" );
+}
+
+TEST(VersionTest, Releases) {
+    for (auto const *str : { "1", "1.2.3", "2.0-1", "1.0-ga", "1.1.Final",
+            "1.0.FINAL-2", "20200101.123456-1" }) {
+        auto *v = mv_parse(str);
+        ASSERT_TRUE(mv_is_release(v)) << str;
+        mv_free(v);
+    }
+    for (auto const *str : { "1.0-SNAPSHOT", "1-alpha-1", "2.0-rc1",
+            "1.0-sp1", "1.0.RELEASE", "1.0-20200101.123456-1" }) {
+        auto *v = mv_parse(str);
+        ASSERT_FALSE(mv_is_release(v)) << str;
+        mv_free(v);
+    }
+}
+
+TEST(VersionTest, Snapshots) {
+    for (auto const *str : { "1.0-SNAPSHOT", "1.0.snapshot", "SNAPSHOT",
+            "1.0-20200101.123456-1", "2-alpha-20200101.123456-12" }) {
+        auto *v = mv_parse(str);
+        ASSERT_TRUE(mv_is_snapshot(v)) << str;
+        mv_free(v);
+    }
+    for (auto const *str : { "1", "1.0-SNAPSHOT-1", "1.0-snap",
+            "20200101.123456-1", "1.0-20200101.12345-1",
+            "1.0-20200101-123456-1" }) {
+        auto *v = mv_parse(str);
+        ASSERT_FALSE(mv_is_snapshot(v)) << str;
+        mv_free(v);
+    }
+}
+
+static std::string canonical(const char *str) {
+    auto *v = mv_parse(str);
+    char buf[128];
+    size_t len = mv_canonical(v, buf, sizeof(buf));
+    mv_free(v);
+    EXPECT_LT(len, sizeof(buf));
+    EXPECT_EQ(len, strlen(buf));
+    return buf;
+}
+
+TEST(VersionTest, Canonical) {
+    ASSERT_EQ("1", canonical("1.0.0-GA"));
+    ASSERT_EQ("1", canonical("1.0.0.0-final"));
+    ASSERT_EQ("1.2", canonical("01.002"));
+    ASSERT_EQ("1-alpha-1", canonical("1-A1"));
+    ASSERT_EQ("1-rc", canonical("1cr"));
+    ASSERT_EQ("1-snapshot", canonical("1.0-SNAPSHOT"));
+    ASSERT_EQ("2.0.1-xyz-123", canonical("2.0.1-xyz-123"));
+    ASSERT_EQ("1.0.1", canonical("1..1"));
+    ASSERT_EQ("1-1.foo-bar-1-baz-0.1", canonical("1-1.foo-bar1baz-.1"));
+    ASSERT_EQ("1.123456789012345678901",
+        canonical("1.0000123456789012345678901"));
+    ASSERT_EQ("", canonical(""));
+
+    // Truncated output is terminated and still reports the full length
+    auto *v = mv_parse("1.2-beta-3");
+    char small[4];
+    ASSERT_EQ(10u, mv_canonical(v, small, sizeof(small)));
+    ASSERT_STREQ("1.2", small);
+    ASSERT_EQ(10u, mv_canonical(v, NULL, 0));
+    mv_free(v);
+
+    mvn::Version cpp("1.0-M3");
+    ASSERT_EQ("1-milestone-3", cpp.canonical());
+}
+
+TEST(VersionTest, Hash) {
+    const char *equal[][2] = {
+        { "1.0", "1.0.0.0-ga" },
+        { "1a1", "1-alpha-1" },
+        { "1.0-SNAPSHOT", "1-snapshot" },
+        { "1.000000000000000000000000001", "1.1" },
+    };
+    for (auto const& pair : equal) {
+        auto *a = mv_parse(pair[0]);
+        auto *b = mv_parse(pair[1]);
+        ASSERT_EQ(mv_hash(a), mv_hash(b)) << pair[0];
+        mv_free(a);
+        mv_free(b);
+    }
+
+    // Distinct versions (almost always) hash apart, even in the low bits
+    std::vector<uint64_t> hashes;
+    for (auto const *str : { "1", "1.1", "1.0.1", "1-1", "1-alpha", "1-beta",
+            "1-x", "1-y", "2", "10", "1.99999999999999999999" }) {
+        auto *v = mv_parse(str);
+        hashes.push_back(mv_hash(v));
+        mv_free(v);
+    }
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        for (size_t j = i + 1; j < hashes.size(); ++j) {
+            ASSERT_NE(hashes[i] & 0xffff, hashes[j] & 0xffff);
+        }
+    }
 }
 
 TEST(VersionTest, CppComparison) {
@@ -0,0 +1,384 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "c-maven-utils/latest.h"
+
+/*
+ * Reduces lines of `groupId:artifactId:version` to the newest version of
+ * each artifact in one pass. Files are mapped and split between threads,
+ * each filling its own aggregation, which are merged in input order so the
+ * result does not depend on the number of threads. Pipes, and files read
+ * by one thread, are read through a fixed buffer.
+ */
+
+/* Parts of a file smaller than this are not worth a thread */
+#define kMinSlice (1 << 20)
+
+/* Size of the buffer pipes are read through, unless a line is longer */
+#define kReadSize (1 << 16)
+
+enum mode { kLatest, kRelease, kSnapshot, kAll };
+
+struct worker {
+    pthread_t thread;
+    const char *buf;
+    size_t size;
+    struct maven_latest *latest;
+    size_t malformed;
+    int failed;
+};
+
+static void die(const char *what) {
+    fprintf(stderr, "mvn-latest: %s: %s\n", what, strerror(errno));
+    exit(2);
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* Adds a line: 1, or 0 if it is not artifact:version, or -1 on failure */
+static int add_line(struct maven_latest *latest, const char *str, size_t len) {
+    while (len && is_space(*str)) {
+        ++str;
+        --len;
+    }
+    while (len && is_space(str[len - 1])) {
+        --len;
+    }
+    size_t sep = len;
+    while (sep && str[sep - 1] != ':') {
+        --sep;
+    }
+    if (sep <= 1 || sep == len) {
+        return 0;
+    }
+    return mv_latest_add(latest, str, sep - 1, str + sep, len - sep) ? 1 : -1;
+}
+
+/* Adds every complete line; returns where the last, partial, line starts */
+static const char* add_lines(struct maven_latest *latest, const char *buf,
+        const char *end, size_t *malformed, int *failed) {
+    while (buf < end) {
+        const char *nl = (const char*) memchr(buf, '\n', end - buf);
+        if (!nl) {
+            break;
+        }
+        if (nl != buf) {
+            int ret = add_line(latest, buf, nl - buf);
+            if (ret < 0) {
+                *failed = 1;
+                return end;
+            }
+            *malformed += !ret;
+        }
+        buf = nl + 1;
+    }
+    return buf;
+}
+
+static void* run_worker(void *arg) {
+    struct worker *w = (struct worker*) arg;
+    const char *end = w->buf + w->size;
+    const char *rest = add_lines(w->latest, w->buf, end, &w->malformed,
+        &w->failed);
+    if (!w->failed && rest != end) {
+        int ret = add_line(w->latest, rest, end - rest);
+        w->failed = ret < 0;
+        w->malformed += !ret;
+    }
+    return NULL;
+}
+
+static void read_file(struct maven_latest *latest, const char *path,
+        const char *buf, size_t size, unsigned threads, size_t *malformed) {
+    if (threads > size / kMinSlice) {
+        threads = (unsigned) (size / kMinSlice);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    struct worker *workers = (struct worker*) calloc(threads,
+        sizeof(struct worker));
+    if (!workers) {
+        die(path);
+    }
+
+    /* Parts end after a newline, so no line is split between threads */
+    size_t start = 0;
+    unsigned i;
+    for (i = 0; i < threads; ++i) {
+        size_t end = i + 1 == threads ? size : size / threads * (i + 1);
+        if (end < start) {
+            end = start;
+        }
+        const char *nl = (const char*) memchr(buf + end, '\n', size - end);
+        if (end != size) {
+            end = nl ? (size_t) (nl - buf) + 1 : size;
+        }
+        workers[i].buf = buf + start;
+        workers[i].size = end - start;
+        workers[i].latest = i ? mv_latest_create() : latest;
+        if (!workers[i].latest) {
+            die(path);
+        }
+        start = end;
+    }
+    for (i = 1; i < threads; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, run_worker,
+                &workers[i])) {
+            die("starting threads");
+        }
+    }
+    run_worker(&workers[0]);
+    for (i = 1; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    int failed = 0;
+    for (i = 0; i < threads; ++i) {
+        failed |= workers[i].failed;
+        *malformed += workers[i].malformed;
+        if (i) {
+            failed |= !failed && !mv_latest_merge(latest, workers[i].latest);
+            mv_latest_free(workers[i].latest);
+        }
+    }
+    free(workers);
+    if (failed) {
+        errno = ENOMEM;
+        die(path);
+    }
+}
+
+static void read_stream(struct maven_latest *latest, int fd,
+        const char *path, size_t *malformed) {
+    size_t capacity = kReadSize;
+    size_t size = 0;
+    char *buf = (char*) malloc(capacity);
+    int failed = 0;
+    for (;;) {
+        if (!buf) {
+            die(path);
+        }
+        ssize_t n = read(fd, buf + size, capacity - size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            die(path);
+        }
+        if (n == 0) {
+            break;
+        }
+        size += n;
+        const char *rest = add_lines(latest, buf, buf + size, malformed,
+            &failed);
+        if (failed) {
+            break;
+        }
+        size -= rest - buf;
+        memmove(buf, rest, size);
+        if (size == capacity) {
+            capacity *= 2;
+            buf = (char*) realloc(buf, capacity);
+        }
+    }
+    if (!failed && size) {
+        int ret = add_line(latest, buf, size);
+        failed = ret < 0;
+        *malformed += !ret;
+    }
+    free(buf);
+    if (failed) {
+        errno = ENOMEM;
+        die(path);
+    }
+}
+
+static void read_input(struct maven_latest *latest, const char *path,
+        unsigned threads, size_t *malformed) {
+    if (strcmp(path, "-") == 0) {
+        read_stream(latest, STDIN_FILENO, path, malformed);
+        return;
+    }
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        die(path);
+    }
+    /* Reading is cheaper than faulting in a mapping, unless it is split */
+    if (!S_ISREG(st.st_mode) || threads < 2
+            || (size_t) st.st_size < 2 * kMinSlice) {
+        read_stream(latest, fd, path, malformed);
+    } else if (st.st_size > 0) {
+        void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (buf == MAP_FAILED) {
+            die(path);
+        }
+        madvise(buf, st.st_size, MADV_SEQUENTIAL);
+        read_file(latest, path, (const char*) buf, st.st_size, threads,
+            malformed);
+        munmap(buf, st.st_size);
+    }
+    close(fd);
+}
+
+static int compare_entries(const void *pa, const void *pb) {
+    const struct mv_latest_entry *a = (const struct mv_latest_entry*) pa;
+    const struct mv_latest_entry *b = (const struct mv_latest_entry*) pb;
+    size_t len = a->artifact_len < b->artifact_len ? a->artifact_len
+        : b->artifact_len;
+    int cmp = memcmp(a->artifact, b->artifact, len);
+    if (cmp) {
+        return cmp;
+    }
+    return a->artifact_len < b->artifact_len ? -1
+        : a->artifact_len > b->artifact_len;
+}
+
+static void print(const struct mv_latest_entry *e, enum mode mode) {
+    switch (mode) {
+    case kLatest:
+        printf("%s:%s\n", e->artifact, e->latest);
+        break;
+    case kRelease:
+        if (e->release) {
+            printf("%s:%s\n", e->artifact, e->release);
+        }
+        break;
+    case kSnapshot:
+        if (e->snapshot) {
+            printf("%s:%s\n", e->artifact, e->snapshot);
+        }
+        break;
+    case kAll:
+        printf("%s\t%s\t%s\t%s\n", e->artifact, e->latest,
+            e->release ? e->release : "-", e->snapshot ? e->snapshot : "-");
+        break;
+    }
+}
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: mvn-latest [options] [file...]\n"
+        "\n"
+        "Reads groupId:artifactId:version lines from the files (or standard\n"
+        "input) and prints the latest version of each artifact, sorted by\n"
+        "artifact.\n"
+        "\n"
+        "  -r, --release    print the latest release instead\n"
+        "  -s, --snapshot   print the latest snapshot instead\n"
+        "  -a, --all        print each artifact with its latest version,\n"
+        "                   release and snapshot (or -), separated by tabs\n"
+        "  -j, --threads N  read files with N threads (default: one per\n"
+        "                   CPU)\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        { "release", no_argument, NULL, 'r' },
+        { "snapshot", no_argument, NULL, 's' },
+        { "all", no_argument, NULL, 'a' },
+        { "threads", required_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    enum mode mode = kLatest;
+    long threads = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "rsaj:h", options, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            mode = kRelease;
+            break;
+        case 's':
+            mode = kSnapshot;
+            break;
+        case 'a':
+            mode = kAll;
+            break;
+        case 'j':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    struct maven_latest *latest = mv_latest_create();
+    if (!latest) {
+        die("reading input");
+    }
+    size_t malformed = 0;
+    if (optind == argc) {
+        read_input(latest, "-", (unsigned) threads, &malformed);
+    }
+    for (; optind < argc; ++optind) {
+        read_input(latest, argv[optind], (unsigned) threads, &malformed);
+    }
+
+    size_t n = mv_latest_size(latest);
+    struct mv_latest_entry *entries = (struct mv_latest_entry*) malloc(
+        n * sizeof(struct mv_latest_entry));
+    if (n && !entries) {
+        die("writing output");
+    }
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        mv_latest_at(latest, i, &entries[i]);
+    }
+    qsort(entries, n, sizeof(struct mv_latest_entry), compare_entries);
+    for (i = 0; i < n; ++i) {
+        print(&entries[i], mode);
+    }
+    if (fflush(stdout)) {
+        die("writing output");
+    }
+    if (malformed) {
+        fprintf(stderr, "mvn-latest: skipped %zu malformed line%s\n",
+            malformed, malformed == 1 ? "" : "s");
+    }
+
+    free(entries);
+    mv_latest_free(latest);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "c-maven-utils/scan.h"
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: mvn-scan [-j threads] [-o catalog] <repository>\n"
+        "\n"
+        "Lists the versions of every artifact in a Maven repository as\n"
+        "groupId:artifactId:version lines, each artifact's in ascending\n"
+        "order, or writes them to a catalog file.\n");
+}
+
+int main(int argc, char **argv) {
+    unsigned threads = 0;
+    const char *catalog = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:o:h")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = (unsigned) strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            catalog = optarg;
+            break;
+        default:
+            usage();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 1;
+    }
+
+    const char *root = argv[optind];
+    struct maven_scan *scan = mv_scan(root, threads);
+    if (!scan) {
+        fprintf(stderr, "mvn-scan: %s: %s\n", root, strerror(errno));
+        return 1;
+    }
+    if (mv_scan_skipped(scan)) {
+        fprintf(stderr, "mvn-scan: skipped %zu unreadable directories\n",
+            mv_scan_skipped(scan));
+    }
+
+    int ret = 0;
+    if (catalog) {
+        if (!mv_scan_write_catalog(scan, catalog)) {
+            fprintf(stderr, "mvn-scan: %s: %s\n", catalog, strerror(errno));
+            ret = 1;
+        }
+    } else {
+        struct mv_scan_artifact artifact;
+        size_t i, j;
+        for (i = 0; mv_scan_artifact_at(scan, i, &artifact); ++i) {
+            for (j = 0; j < artifact.count; ++j) {
+                fwrite(artifact.name, 1, artifact.len, stdout);
+                putchar(':');
+                fputs(artifact.strs[j], stdout);
+                putchar('\n');
+            }
+        }
+        if (fflush(stdout)) {
+            fprintf(stderr, "mvn-scan: %s\n", strerror(errno));
+            ret = 1;
+        }
+    }
+
+    mv_scan_free(scan);
+    return ret;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sort-lines.h"
+
+/* Sorts lines of versions like sort(1); see sort-lines.h */
+
+static void die(const char *what) {
+    fprintf(stderr, "mvn-sort: %s: %s\n", what, strerror(errno));
+    exit(2);
+}
+
+/*
+ * Input.
+ */
+
+struct input {
+    struct sort_line *lines;
+    size_t n;
+    size_t capacity;
+    char **bufs;              /* What was read from pipes */
+    size_t nbufs;
+};
+
+static void add_lines(struct input *input, const char *buf, size_t size) {
+    const char *end = buf + size;
+    while (buf < end) {
+        const char *nl = (const char*) memchr(buf, '\n', end - buf);
+        const char *eol = nl ? nl : end;
+        size_t len = eol - buf;
+        if (len && buf[len - 1] == '\r') {
+            --len;
+        }
+        if (len > UINT32_MAX) {
+            errno = EFBIG;
+            die("line too long");
+        }
+        if (input->n == input->capacity) {
+            input->capacity = input->capacity ? 2 * input->capacity : 4096;
+            input->lines = (struct sort_line*) realloc(input->lines,
+                input->capacity * sizeof(struct sort_line));
+            if (!input->lines) {
+                die("reading input");
+            }
+        }
+        struct sort_line *line = &input->lines[input->n++];
+        line->str = buf;
+        line->len = (uint32_t) len;
+        buf = eol + 1;
+    }
+}
+
+/* Maps a file, or reads standard input; mappings are never released */
+static void read_input(struct input *input, const char *path) {
+    if (strcmp(path, "-") != 0) {
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st)) {
+            die(path);
+        }
+        if (S_ISREG(st.st_mode)) {
+            if (st.st_size > 0) {
+                void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                    fd, 0);
+                if (buf == MAP_FAILED) {
+                    die(path);
+                }
+                madvise(buf, st.st_size, MADV_SEQUENTIAL);
+                add_lines(input, (const char*) buf, st.st_size);
+            }
+            close(fd);
+            return;
+        }
+        if (dup2(fd, STDIN_FILENO) < 0) {
+            die(path);
+        }
+        close(fd);
+    }
+
+    size_t size = 0;
+    size_t capacity = 1 << 16;
+    char *buf = (char*) malloc(capacity);
+    for (;;) {
+        if (!buf) {
+            die("reading input");
+        }
+        ssize_t n = read(STDIN_FILENO, buf + size, capacity - size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            die(path);
+        }
+        if (n == 0) {
+            break;
+        }
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            buf = (char*) realloc(buf, capacity);
+        }
+    }
+    char **bufs = (char**) realloc(input->bufs,
+        (input->nbufs + 1) * sizeof(char*));
+    if (!bufs) {
+        die("reading input");
+    }
+    input->bufs = bufs;
+    input->bufs[input->nbufs++] = buf;
+    add_lines(input, buf, size);
+}
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: mvn-sort [options] [file...]\n"
+        "\n"
+        "Writes the versions in the files (or standard input), one per line,\n"
+        "in Maven order.\n"
+        "\n"
+        "  -u, --unique     print only the first of equal versions\n"
+        "  -r, --reverse    sort in descending order\n"
+        "      --max        print only the greatest version\n"
+        "      --min        print only the least version\n"
+        "  -j, --threads N  sort with N threads (default: one per CPU)\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        { "unique", no_argument, NULL, 'u' },
+        { "reverse", no_argument, NULL, 'r' },
+        { "max", no_argument, NULL, 'M' },
+        { "min", no_argument, NULL, 'm' },
+        { "threads", required_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct sort_options sort = { 0, 0, 0, 1 };
+    long threads = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "urj:h", options, NULL)) != -1) {
+        switch (opt) {
+        case 'u':
+            sort.unique = 1;
+            break;
+        case 'r':
+            sort.reverse = 1;
+            break;
+        case 'M':
+            sort.select = 1;
+            break;
+        case 'm':
+            sort.select = -1;
+            break;
+        case 'j':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+
+    struct input input = { NULL, 0, 0, NULL, 0 };
+    if (optind == argc) {
+        read_input(&input, "-");
+    }
+    for (; optind < argc; ++optind) {
+        read_input(&input, argv[optind]);
+    }
+
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    sort.threads = (unsigned) threads;
+    if (!sort_lines(input.lines, input.n, &sort, stdout)) {
+        die("sorting");
+    }
+    if (fflush(stdout)) {
+        die("writing output");
+    }
+
+    free(input.lines);
+    size_t i;
+    for (i = 0; i < input.nbufs; ++i) {
+        free(input.bufs[i]);
+    }
+    free(input.bufs);
+    return 0;
+}
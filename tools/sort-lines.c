@@ -0,0 +1,463 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sort-lines.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c-maven-utils/maven-version.h"
+
+/* Slices smaller than this are not worth a thread */
+#define kMinSlice 4096
+
+/* Key bytes allocated at once */
+#define kPoolChunkSize (1 << 20)
+
+/* What is sorted: a line and the first 8 bytes of its key, big endian */
+struct item {
+    uint64_t prefix;
+    const struct sort_line *line;
+};
+
+struct pool_chunk {
+    struct pool_chunk *next;
+};
+
+/* Keys, allocated in chunks and released together */
+struct pool {
+    struct pool_chunk *chunks;
+    unsigned char *cur;
+    unsigned char *end;
+};
+
+struct worker {
+    pthread_t thread;
+    struct sort_line *lines;
+    struct item *items;
+    size_t n;
+    struct pool pool;
+    int select;               /* Only find the least (-1) or greatest (1) */
+    const struct item *best;
+    int failed;
+};
+
+static unsigned char* pool_alloc(struct pool *pool, size_t size) {
+    if ((size_t) (pool->end - pool->cur) < size) {
+        size_t chunk_size = sizeof(struct pool_chunk) + (size > kPoolChunkSize
+            ? size : kPoolChunkSize);
+        struct pool_chunk *chunk = (struct pool_chunk*) malloc(chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->cur = (unsigned char*) (chunk + 1);
+        pool->end = (unsigned char*) chunk + chunk_size;
+    }
+    unsigned char *ret = pool->cur;
+    pool->cur += size;
+    return ret;
+}
+
+static void pool_release(struct pool *pool) {
+    while (pool->chunks) {
+        struct pool_chunk *next = pool->chunks->next;
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+}
+
+static int compare_keys(const struct item *a, const struct item *b) {
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    const struct sort_line *la = a->line;
+    const struct sort_line *lb = b->line;
+    size_t len = la->key_len < lb->key_len ? la->key_len : lb->key_len;
+    int cmp = memcmp(la->key, lb->key, len);
+    if (cmp) {
+        return cmp;
+    }
+    return la->key_len < lb->key_len ? -1 : la->key_len > lb->key_len;
+}
+
+static int compare_items(const void *pa, const void *pb) {
+    const struct item *a = (const struct item*) pa;
+    const struct item *b = (const struct item*) pb;
+    int cmp = compare_keys(a, b);
+    if (cmp) {
+        return cmp;
+    }
+    return a->line->index < b->line->index ? -1
+        : a->line->index > b->line->index;
+}
+
+/* The 8 key bytes from `depth` on, big endian and zero padded */
+static uint64_t key_prefix(const struct sort_line *line, size_t depth) {
+    uint64_t prefix = 0;
+    size_t i;
+    for (i = depth; i < depth + 8; ++i) {
+        prefix = prefix << 8 | (i < line->key_len ? line->key[i] : 0);
+    }
+    return prefix;
+}
+
+static int compute_key(struct sort_line *line, struct item *item,
+        struct pool *pool) {
+    unsigned char buf[64];
+    size_t len = mv_sort_key_n(line->str, line->len, buf, sizeof(buf));
+    unsigned char *key = pool_alloc(pool, len);
+    if (!len || !key || len > UINT32_MAX) {
+        return 0;
+    }
+    if (len <= sizeof(buf)) {
+        memcpy(key, buf, len);
+    } else {
+        mv_sort_key_n(line->str, line->len, key, len);
+    }
+
+    line->key = key;
+    line->key_len = (uint32_t) len;
+    item->prefix = key_prefix(line, 0);
+    item->line = line;
+    return 1;
+}
+
+/* Stable LSD radix sort by prefix, skipping bytes that are all the same */
+static void radix_sort(struct item *items, struct item *tmp, size_t n) {
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    size_t i;
+    int b;
+    for (i = 0; i < n; ++i) {
+        for (b = 0; b < 8; ++b) {
+            ++counts[b][(items[i].prefix >> (8 * b)) & 0xff];
+        }
+    }
+
+    struct item *src = items;
+    struct item *dst = tmp;
+    for (b = 0; b < 8; ++b) {
+        size_t *count = counts[b];
+        if (count[(src[0].prefix >> (8 * b)) & 0xff] == n) {
+            continue;
+        }
+        size_t offset = 0;
+        for (i = 0; i < 256; ++i) {
+            size_t c = count[i];
+            count[i] = offset;
+            offset += c;
+        }
+        for (i = 0; i < n; ++i) {
+            dst[count[(src[i].prefix >> (8 * b)) & 0xff]++] = src[i];
+        }
+        struct item *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != items) {
+        memcpy(items, src, n * sizeof(struct item));
+    }
+}
+
+/*
+ * Sorts items whose keys agree on their first `depth` bytes, 8 bytes at a
+ * time. Keys are never prefixes of other keys, so the padding of a key
+ * that ends is never what tells it apart; lines whose keys end together are
+ * equal, and stay in input order.
+ */
+static void sort_from(struct item *items, struct item *tmp, size_t n,
+        size_t depth) {
+    if (n < 32) {
+        qsort(items, n, sizeof(struct item), compare_items);
+        return;
+    }
+    size_t i, j;
+    for (i = 0; i < n; ++i) {
+        items[i].prefix = key_prefix(items[i].line, depth);
+    }
+    radix_sort(items, tmp, n);
+
+    for (i = 0; i < n; i = j) {
+        int more = 0;
+        for (j = i; j < n && items[j].prefix == items[i].prefix; ++j) {
+            more |= items[j].line->key_len > depth + 8;
+        }
+        if (j - i > 1 && more) {
+            sort_from(items + i, tmp, j - i, depth + 8);
+        }
+    }
+}
+
+static int sort_items(struct item *items, size_t n) {
+    struct item *tmp = (struct item*) malloc(n * sizeof(struct item));
+    if (n && !tmp) {
+        return 0;
+    }
+    sort_from(items, tmp, n, 0);
+    free(tmp);
+
+    /* Restore the leading prefixes that comparisons expect */
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        items[i].prefix = key_prefix(items[i].line, 0);
+    }
+    return 1;
+}
+
+static void* run_worker(void *arg) {
+    struct worker *w = (struct worker*) arg;
+    size_t i;
+    for (i = 0; i < w->n; ++i) {
+        if (!compute_key(&w->lines[i], &w->items[i], &w->pool)) {
+            w->failed = 1;
+            return NULL;
+        }
+        if (w->select && (!w->best
+                || w->select * compare_items(&w->items[i], w->best) > 0)) {
+            w->best = &w->items[i];
+        }
+    }
+    if (!w->select && !sort_items(w->items, w->n)) {
+        w->failed = 1;
+    }
+    return NULL;
+}
+
+/*
+ * Output.
+ */
+
+struct output {
+    FILE *file;
+    int unique;
+    int failed;
+    const struct item *last;
+    size_t used;
+    char buf[1 << 16];
+};
+
+static void flush(struct output *out) {
+    if (out->used && fwrite(out->buf, 1, out->used, out->file) != out->used) {
+        out->failed = 1;
+    }
+    out->used = 0;
+}
+
+static void emit(struct output *out, const struct item *item) {
+    if (out->unique && out->last && !compare_keys(out->last, item)) {
+        return;
+    }
+    out->last = item;
+
+    const struct sort_line *line = item->line;
+    if (sizeof(out->buf) - out->used <= line->len) {
+        flush(out);
+        if (sizeof(out->buf) <= line->len) {
+            if (fwrite(line->str, 1, line->len, out->file) != line->len) {
+                out->failed = 1;
+            }
+            out->buf[out->used++] = '\n';
+            return;
+        }
+    }
+    memcpy(out->buf + out->used, line->str, line->len);
+    out->used += line->len;
+    out->buf[out->used++] = '\n';
+}
+
+/* A run of sorted lines, read from the front or, in reverse, the back */
+struct run {
+    const struct item *cur;
+    const struct item *end;
+};
+
+/* Heap of runs by their next line */
+struct merge {
+    struct run *runs;
+    size_t n;
+    int dir;
+};
+
+static const struct item* head(const struct merge *m, size_t i) {
+    return m->dir > 0 ? m->runs[i].cur : m->runs[i].end - 1;
+}
+
+static int before(const struct merge *m, size_t i, size_t j) {
+    return m->dir * compare_items(head(m, i), head(m, j)) < 0;
+}
+
+static void sift_down(struct merge *m, size_t i) {
+    for (;;) {
+        size_t least = i;
+        size_t l = 2 * i + 1;
+        if (l < m->n && before(m, l, least)) {
+            least = l;
+        }
+        if (l + 1 < m->n && before(m, l + 1, least)) {
+            least = l + 1;
+        }
+        if (least == i) {
+            return;
+        }
+        struct run tmp = m->runs[i];
+        m->runs[i] = m->runs[least];
+        m->runs[least] = tmp;
+        i = least;
+    }
+}
+
+static int merge_runs(struct worker *workers, unsigned nworkers, int dir,
+        struct output *out) {
+    struct merge m;
+    m.runs = (struct run*) malloc(nworkers * sizeof(struct run));
+    m.n = 0;
+    m.dir = dir;
+    if (!m.runs) {
+        return 0;
+    }
+    unsigned i;
+    for (i = 0; i < nworkers; ++i) {
+        if (workers[i].n) {
+            m.runs[m.n].cur = workers[i].items;
+            m.runs[m.n].end = workers[i].items + workers[i].n;
+            ++m.n;
+        }
+    }
+    size_t j;
+    for (j = m.n; j-- > 0; ) {
+        sift_down(&m, j);
+    }
+    while (m.n) {
+        struct run *top = &m.runs[0];
+        emit(out, head(&m, 0));
+        if (dir > 0) {
+            ++top->cur;
+        } else {
+            --top->end;
+        }
+        if (top->cur == top->end) {
+            m.runs[0] = m.runs[--m.n];
+        }
+        sift_down(&m, 0);
+    }
+    free(m.runs);
+    return 1;
+}
+
+static int sort_and_write(struct worker *workers, unsigned nworkers,
+        const struct sort_options *options, struct output *out) {
+    unsigned i;
+    for (i = 1; i < nworkers; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, run_worker,
+                &workers[i])) {
+            break;
+        }
+    }
+    unsigned started = i;
+    run_worker(&workers[0]);
+    for (i = 1; i < started; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    if (started < nworkers) {
+        errno = EAGAIN;
+        return 0;
+    }
+    for (i = 0; i < nworkers; ++i) {
+        if (workers[i].failed) {
+            errno = ENOMEM;
+            return 0;
+        }
+    }
+
+    if (options->select) {
+        const struct item *best = NULL;
+        for (i = 0; i < nworkers; ++i) {
+            if (workers[i].best && (!best || options->select
+                    * compare_items(workers[i].best, best) > 0)) {
+                best = workers[i].best;
+            }
+        }
+        if (best) {
+            emit(out, best);
+        }
+    } else if (!merge_runs(workers, nworkers, options->reverse ? -1 : 1,
+            out)) {
+        errno = ENOMEM;
+        return 0;
+    }
+    flush(out);
+    return !out->failed;
+}
+
+int sort_lines(struct sort_line *lines, size_t n,
+        const struct sort_options *options, FILE *out) {
+    unsigned nworkers = options->threads;
+    if (nworkers > n / kMinSlice) {
+        nworkers = (unsigned) (n / kMinSlice);
+    }
+    if (nworkers < 1) {
+        nworkers = 1;
+    }
+
+    struct output *output = (struct output*) malloc(sizeof(struct output));
+    struct worker *workers = (struct worker*) calloc(nworkers,
+        sizeof(struct worker));
+    struct item *items = (struct item*) malloc(n * sizeof(struct item));
+    if (!output || !workers || (n && !items)) {
+        free(output);
+        free(workers);
+        free(items);
+        errno = ENOMEM;
+        return 0;
+    }
+    output->file = out;
+    output->unique = options->unique;
+    output->failed = 0;
+    output->last = NULL;
+    output->used = 0;
+
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        lines[i].index = i;
+    }
+    size_t start = 0;
+    unsigned w;
+    for (w = 0; w < nworkers; ++w) {
+        size_t end = n * (w + 1) / nworkers;
+        workers[w].lines = lines + start;
+        workers[w].items = items + start;
+        workers[w].n = end - start;
+        workers[w].select = options->select;
+        start = end;
+    }
+    int ret = sort_and_write(workers, nworkers, options, output);
+
+    for (w = 0; w < nworkers; ++w) {
+        pool_release(&workers[w].pool);
+    }
+    free(output);
+    free(workers);
+    free(items);
+    return ret;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (©) 2015 Nate Rosenblum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SORT_LINES_H_
+#define SORT_LINES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The sort behind mvn-sort. Each thread computes the sort keys of a slice
+ * of the lines and sorts it, and the sorted slices are merged as they are
+ * written out. Slices are radix sorted 8 key bytes at a time, so lines are
+ * rarely compared one with another.
+ */
+
+struct sort_line {
+    const char *str;          /* Need not be NUL-terminated */
+    uint32_t len;
+
+    /* Internal */
+    uint32_t key_len;
+    const unsigned char *key;
+    size_t index;             /* Position in the input, to sort stably */
+};
+
+struct sort_options {
+    int unique;               /* Write only the first of equal lines */
+    int reverse;              /* Write in descending order */
+    int select;               /* Write only the least (-1) or greatest (1) */
+    unsigned threads;         /* At least one */
+};
+
+/*
+ * Write `lines` to `out` in Maven order, each followed by a newline. Equal
+ * lines keep their input order, or the reverse of it with `reverse`.
+ *
+ * @return 1, or 0 with errno set if memory could not be allocated or the
+ *         output could not be written
+ */
+int sort_lines(struct sort_line *lines, size_t n,
+    const struct sort_options *options, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SORT_LINES_H_ */